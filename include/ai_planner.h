@@ -0,0 +1,101 @@
+#ifndef AI_PLANNER_H
+#define AI_PLANNER_H
+
+#include "obstacle_field.h"
+#include "simulation_types.h"
+#include <cstdint>
+#include <vector>
+
+class StateWriter;
+class StateReader;
+
+// Lookahead steering for the AI car: dynamic programming over a lattice of
+// lanes (positions one sideways move apart) by time layers (a few steps
+// each), against the obstacles the AI can see. The cheapest path avoids every
+// box the car would sweep through and changes lane as little as possible.
+//
+// The plan is kept and followed while it stays valid: no obstacle appeared
+// since it was made, the car is where following it should have put it and
+// enough of it is left. Each search is capped at a node budget derived from
+// a microsecond budget, charging the obstacle tests of each layer as well as
+// its nodes. The cap is a count rather than a clock so races and replays
+// stay deterministic, which makes the time only an estimate: the mean plan
+// stays within budget, single plans can overrun it.
+class AiPlanner {
+public:
+    static const int LANE_WIDTH = 10;       // Sideways distance of one Car::moveLeft / moveRight
+    static const int STEPS_PER_LAYER = 8;   // Simulation steps per time layer
+    static const int MAX_LANE_SHIFT = 3;    // Lanes the car may cross in one layer
+    static const int MAX_LAYERS = 32;
+    static const int MAX_LANES = 32;
+    static const int DEFAULT_BUDGET_MICROS = 100;
+    static const int NODE_COST_NANOS = 40;  // Mean cost of one node in evador_sim races, to turn microseconds into nodes
+    static const int OVERLAP_TESTS_PER_NODE = 6;  // Obstacle tests charged as one node
+
+    static const int COLLISION_COST = 1000; // Per layer spent overlapping an obstacle
+    static const int LANE_CHANGE_COST = 3;  // Per lane crossed
+
+    // Lanes are the x positions reachable from originX in LANE_WIDTH moves
+    // that keep the car within [minX, maxX]
+    AiPlanner(int originX, int minX, int maxX);
+
+    // Spend about this long per search on average (at least two layers are always planned)
+    void setBudgetMicros(int micros);
+    int getBudgetMicros() const { return budgetMicros; }
+    int getNodeBudget() const { return nodeBudget; }
+
+    // Forget the plan, e.g. when the race restarts
+    void reset();
+
+    // Sideways move for the next step of a car at (carX, carY), moving up at
+    // speed and gaining acceleration per second up to maxSpeed. Obstacles are
+    // the visible ones on `road`; nearby is scratch space for the query.
+    AvoidDirection update(const ObstacleField& field, int road, int carX, int carY, int carWidth, int carHeight,
+                          float speed, float acceleration, float maxSpeed, float stepSeconds, std::vector<int>& nearby);
+
+    // Search counters since construction, plus the last search
+    const PlannerStats& getStats() const { return stats; }
+
+    // Write or restore the plan, so a restored keyframe steers exactly as the original did
+    void saveState(StateWriter& writer) const;
+    bool loadState(StateReader& reader);
+
+    int getLaneCount() const { return laneCount; }
+    int laneX(int lane) const { return firstLaneX + lane * LANE_WIDTH; }
+
+private:
+    struct KnownObstacle {
+        int x, y, width, height;
+    };
+
+    // Gather the obstacles ahead that the AI can see into `known`
+    void collectObstacles(const ObstacleField& field, int road, int carX, int carY, int carHeight, std::vector<int>& nearby);
+
+    // Whether the current plan can still be followed
+    bool planValid(int carX) const;
+
+    // Search a new plan from the car's lane
+    void plan(int carX, int carY, int carWidth, int carHeight, float speed, float acceleration, float maxSpeed, float stepSeconds);
+
+    int laneOf(int x) const;
+
+    int firstLaneX;
+    int laneCount;
+    int budgetMicros = DEFAULT_BUDGET_MICROS;
+    int nodeBudget = 0;
+
+    // The plan: lane per layer, layer 0 being the lane the car was in when it was made
+    std::vector<uint8_t> lanes;
+    int stepsFollowed = 0;                 // Steps since the plan was made
+    int expectedX = 0;                     // Where the last move should have put the car
+    std::vector<KnownObstacle> planned;    // Obstacles the plan accounts for
+
+    std::vector<KnownObstacle> known;
+    std::vector<uint8_t> hit;              // Whether each node's sweep overlaps an obstacle, layer-major
+    std::vector<int> cost;                 // Cost to go per node
+    std::vector<int8_t> choice;            // Best lane change out of each node
+    std::vector<float> layerTops;          // Predicted car y at the end of each layer
+    PlannerStats stats;
+};
+
+#endif // AI_PLANNER_H
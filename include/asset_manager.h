@@ -0,0 +1,125 @@
+#ifndef ASSET_MANAGER_H
+#define ASSET_MANAGER_H
+
+#include <SDL.h>
+#include "asset_pack.h"
+#include "text_cache.h"
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Handle of a requested asset; stays valid for the lifetime of the manager
+using AssetHandle = int;
+
+// Loads textures and fonts by path relative to the executable. Each path is
+// loaded once however often it is requested. Files are decoded on loader
+// threads of the manager's own (not the job system, whose waits would pick up
+// a long decode in the middle of a frame); the render thread then turns the
+// decoded pixels into textures in uploadPending(), so the first frames can be
+// drawn while assets are still streaming in.
+class AssetManager {
+public:
+    // Constructor: textures are created on renderer, fonts are added to textCache.
+    // loaderThreads 0 picks one per hardware thread, up to four.
+    AssetManager(SDL_Renderer* renderer, TextCache* textCache, unsigned loaderThreads = 0);
+
+    // Destructor: stops the loader threads and frees every texture
+    ~AssetManager();
+
+    AssetManager(const AssetManager&) = delete;
+    AssetManager& operator=(const AssetManager&) = delete;
+
+    // Map the pack baked at build time and upload its atlas. Later requests for
+    // sprites and fonts it contains are served from it without decoding.
+    // Returns false, leaving every request to the loaders, when the pack is
+    // missing or does not match the layout the game was compiled against.
+    bool loadPack(const std::string& relativePath);
+
+    // Queue a PNG (or any format SDL_image reads) for loading
+    AssetHandle requestTexture(const std::string& relativePath);
+
+    // Queue a font at a point size for loading and rasterizing
+    AssetHandle requestFont(const std::string& relativePath, int pointSize);
+
+    // Render thread, once per frame: create textures and register fonts for
+    // everything decoded since the last call
+    void uploadPending();
+
+    // Texture of a handle: null while loading, a placeholder if the load failed
+    SDL_Texture* getTexture(AssetHandle handle) const;
+
+    // Rectangle of a handle inside its texture, or null when it covers all of it
+    const SDL_Rect* getSourceRect(AssetHandle handle) const;
+
+    // TextCache font id of a handle, -1 while loading or on failure
+    int getFontId(AssetHandle handle) const;
+
+    // Fraction of requested assets that are ready or failed, 0 to 1
+    float getProgress() const;
+
+    // Whether every requested asset is ready or failed
+    bool isFinished() const;
+
+    // Print how long each asset waited, decoded and uploaded
+    void reportLoadTimes() const;
+
+    // Absolute path of a file shipped next to the executable, falling back to
+    // the working directory when it is not there
+    std::string resolvePath(const std::string& relativePath) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    enum class AssetKind { Texture, Font };
+    enum class AssetState { Queued, Decoding, Decoded, Ready, Failed };
+
+    struct Asset {
+        AssetKind kind;
+        std::string key;   // Relative path, plus the point size for fonts
+        std::string path;  // Resolved path
+        int pointSize = 0;
+        AssetState state = AssetState::Queued;
+
+        std::shared_ptr<SDL_Surface> surface;  // Decoded pixels, until uploaded
+        TextCache::Font font;                  // Rasterized font, until added to the cache
+        std::shared_ptr<SDL_Texture> texture;
+        int fontId = -1;
+        bool missing = false;  // Failed to load; set on the render thread, unlike state
+        bool packed = false;   // Served from the asset pack; source is its atlas rectangle
+        SDL_Rect source = {0, 0, 0, 0};
+
+        Clock::time_point requested, decodeStarted, decoded, uploaded;
+    };
+
+    AssetHandle request(AssetKind kind, const std::string& relativePath, int pointSize);
+    static std::string makeKey(AssetKind kind, const std::string& relativePath, int pointSize);
+    Asset& addReady(AssetKind kind, const std::string& relativePath, int pointSize);
+    void loaderLoop();
+    void decode(Asset& asset);
+    SDL_Texture* placeholder() const;
+
+    SDL_Renderer* renderer;
+    TextCache* textCache;
+    std::string basePath;
+    AssetPack pack;
+    double packMilliseconds = 0.0;  // Mapping and uploading the pack
+
+    // Owned by the render thread; loader threads only touch the asset they took from the queue
+    std::vector<std::unique_ptr<Asset>> assets;
+    mutable std::shared_ptr<SDL_Texture> missingTexture;
+
+    mutable std::mutex mutex;
+    std::condition_variable queueReady;
+    std::deque<Asset*> queue;      // Waiting for a loader thread
+    std::vector<Asset*> decoded;   // Waiting for uploadPending
+    int finishedCount = 0;
+    bool stopping = false;
+    std::vector<std::thread> loaders;
+};
+
+#endif // ASSET_MANAGER_H
@@ -0,0 +1,90 @@
+#ifndef ASSET_PACK_H
+#define ASSET_PACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// On-disk layout of evador.pack, written by the evador_pack build tool:
+//   PackHeader
+//   fontCount PackedFont records, at fontOffset
+//   atlas pixels, at atlasOffset: atlasHeight rows of atlasWidth RGBA32 pixels
+// Every field is little-endian and every offset is 64-byte aligned, so the
+// pixels can be handed to the GPU straight from the mapped file.
+struct PackHeader {
+    char magic[4];          // "EVPK"
+    uint32_t version;
+    uint32_t atlasWidth;
+    uint32_t atlasHeight;
+    uint32_t atlasOffset;
+    uint32_t fontCount;
+    uint32_t fontOffset;
+    uint32_t reserved;
+};
+
+// A glyph rectangle inside the atlas and its horizontal advance
+struct PackedGlyph {
+    int32_t x, y, w, h;
+    int32_t advance;
+};
+
+// One font size, rasterized for the printable ASCII range
+struct PackedFont {
+    static const int FIRST_GLYPH = 32;
+    static const int GLYPH_COUNT = 95;
+
+    uint32_t pointSize;
+    int32_t height;
+    PackedGlyph glyphs[GLYPH_COUNT];
+};
+
+// Entries of the header generated next to the pack (asset_pack_layout.h)
+struct PackedSprite {
+    const char* key;  // Path the sprite was packed from, relative to the project
+    int x, y, w, h;   // Rectangle inside the atlas
+};
+
+struct PackedFontKey {
+    const char* key;  // Font file, relative to the project
+    int pointSize;
+};
+
+// Read-only view of a pack file, memory-mapped for as long as the object lives
+class AssetPack {
+public:
+    static const uint32_t VERSION = 1;
+    static const size_t ALIGNMENT = 64;
+
+    AssetPack() = default;
+
+    // Destructor: unmaps the file
+    ~AssetPack();
+
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // Map and validate a pack; false (with a message on stderr) when it is missing or malformed
+    bool open(const std::string& path);
+
+    // Unmap the file; pointers handed out before become invalid
+    void close();
+
+    bool isOpen() const { return data != nullptr; }
+    uint32_t getAtlasWidth() const { return header()->atlasWidth; }
+    uint32_t getAtlasHeight() const { return header()->atlasHeight; }
+    int getAtlasPitch() const { return static_cast<int>(header()->atlasWidth * 4); }
+
+    // RGBA32 pixels of the atlas, inside the mapping
+    const void* getAtlasPixels() const { return data + header()->atlasOffset; }
+
+    int getFontCount() const { return static_cast<int>(header()->fontCount); }
+    const PackedFont& getFont(int index) const;
+
+private:
+    const PackHeader* header() const { return reinterpret_cast<const PackHeader*>(data); }
+
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+};
+
+#endif // ASSET_PACK_H
@@ -0,0 +1,57 @@
+#ifndef BACKGROUND_TILES_H
+#define BACKGROUND_TILES_H
+
+#include <SDL.h>
+#include "asset_manager.h"
+#include "sprite_batch.h"
+
+// The scrolling road behind the race. The band of the background picture that
+// the fully zoomed view shows is scaled to the screen once, followed by an
+// upside-down copy so the bottom of one copy meets the top of the next, and
+// kept in a render-target texture cut into rows. Each frame only the rows
+// the camera sees are queued, at 1:1, instead of stretching the whole picture.
+class BackgroundTiles {
+public:
+    static const int SCREEN_WIDTH = 1000;
+    static const int SCREEN_HEIGHT = 634;
+    static const int TILE_HEIGHT = 128;  // Screen pixels per row
+    static const int BAND_ROWS = 5;      // Rows per copy of the band; the cycle is twice as long
+
+    // Constructor: tiles are built from the asset once it has loaded, scaled
+    // by `scale` around the centre of the picture
+    BackgroundTiles(SDL_Renderer* renderer, AssetManager& assets, AssetHandle background, float scale);
+
+    // Destructor: frees the tile texture
+    ~BackgroundTiles();
+
+    BackgroundTiles(const BackgroundTiles&) = delete;
+    BackgroundTiles& operator=(const BackgroundTiles&) = delete;
+
+    // Queue the rows covering the screen when the camera is `scroll` pixels
+    // below where row 0 starts (negative going up the road); false while the
+    // picture is still loading
+    bool draw(SpriteBatch& batch, float scroll, int layer);
+
+    // Render targets lose their contents on some device resets; call on
+    // SDL_RENDER_TARGETS_RESET so the rows are drawn again
+    void invalidate() { built = false; }
+
+    // Pixels of one wrap-around cycle
+    static int cycleHeight() { return 2 * BAND_ROWS * TILE_HEIGHT; }
+
+private:
+    // Scale the band into the tile texture; false if the picture is not loaded
+    bool build();
+
+    SDL_Renderer* renderer;
+    AssetManager& assets;
+    AssetHandle background;
+    float scale;
+
+    SDL_Texture* tiles = nullptr;  // SCREEN_WIDTH x cycleHeight(), or null when targets are unsupported
+    bool built = false;
+    bool useSource = false;        // Fall back to sampling the picture per row
+    SDL_Rect band = {0, 0, 0, 0};  // Band inside the picture's texture
+};
+
+#endif // BACKGROUND_TILES_H
@@ -0,0 +1,131 @@
+#ifndef BATCH_ENV_H
+#define BATCH_ENV_H
+
+#include "job_system.h"
+#include "simulation.h"
+#include "track.h"
+#include <cstdint>
+#include <vector>
+
+// Rules and rewards of the races in a BatchEnv
+struct BatchEnvConfig {
+    int raceLength = Simulation::DEFAULT_RACE_LENGTH;
+    float stepSeconds = 1.0f / 120.0f;
+    int maxSteps = 0;             // Steps before an episode times out; 0 for never
+    bool endOnCollision = true;   // Otherwise hits are only penalized, as the game counts them
+    float collisionReward = -1.0f;
+    float finishReward = 1.0f;    // Besides the progress reward, which sums to 1 over a race
+};
+
+// Thousands of independent races for training a driving policy, stepped
+// together. Each environment is the AI car of Simulation alone on its road:
+// it gains speed on its own, reveals obstacles within
+// Simulation::VISIBILITY_RANGE and is steered one lane (10 px) left or right
+// per step by the action, exactly where the planner would steer it. Obstacles
+// follow Track's layout rules, drawn from a generator that never allocates.
+//
+// State is kept as structure-of-arrays across environments (obstacles
+// slot-major), and every phase of a step is a branch-free loop over
+// environments that the compiler vectorizes. step() never renders and never
+// allocates, on the job system too once its queues have grown (evador_bench
+// checks both); its outputs live in buffers sized once by the constructor.
+// Environments are independent, so results do not depend on the number of
+// threads.
+class BatchEnv {
+public:
+    // How an episode ended, per environment in dones(); Running (0) while it goes on
+    enum EpisodeEnd : uint8_t { Running = 0, Crashed = 1, Finished = 2, TimedOut = 3 };
+
+    // Steering per environment and step
+    enum Action : int8_t { Left = -1, Straight = 0, Right = 1 };
+
+    // Statistics since construction
+    struct Stats {
+        uint64_t steps = 0;     // Environment steps
+        uint64_t episodes = 0;  // Episodes ended
+        uint64_t crashes = 0;
+        uint64_t finishes = 0;
+        uint64_t timeouts = 0;
+    };
+
+    static const int WINDOW_CHUNKS = 3;  // Chunks kept per environment: behind, under and ahead of the car
+    static const int SLOTS = WINDOW_CHUNKS * TrackChunk::OBSTACLES;
+
+    // Observation of one environment: car x across the road (0..1), speed
+    // (0..1 of MAX_SPEED), remaining distance (0..1 of the race), then per
+    // obstacle slot, nearest chunk first: seen (1 when revealed and not yet
+    // passed), x offset from the car in road widths and distance ahead in
+    // VISIBILITY_RANGEs; the three are 0 for an unseen slot
+    static const int CAR_FEATURES = 3;
+    static const int SLOT_FEATURES = 3;
+    static const int OBSERVATION_SIZE = CAR_FEATURES + SLOTS * SLOT_FEATURES;
+
+    // Constructor: every buffer is allocated here. With a job system steps
+    // are split over its workers in ranges of environments; the range task
+    // fits std::function's inline storage, so queueing it does not allocate.
+    BatchEnv(int envCount, unsigned seed, const BatchEnvConfig& config = BatchEnvConfig(), JobSystem* jobs = nullptr);
+
+    // Put every environment back on the start line of its current track
+    void reset();
+
+    // Advance every environment by one step; actions holds one Action per
+    // environment. An environment whose episode ended reports it in dones()
+    // and rewards() and is already reset: its observation is the first of the next episode.
+    void step(const int8_t* actions);
+
+    // Outputs of the last step (or reset), valid until the next call
+    const float* observations() const { return observationBuffer.data(); }  // size() x OBSERVATION_SIZE
+    const float* rewards() const { return rewardBuffer.data(); }
+    const uint8_t* dones() const { return doneBuffer.data(); }
+
+    int size() const { return envCount; }
+    const BatchEnvConfig& getConfig() const { return config; }
+    Stats getStats() const;
+
+private:
+    // One step of environments [first, last)
+    void stepRange(int first, int last);
+
+    // New episode in one environment, with the next track of its seed sequence
+    void resetEnv(int env);
+
+    // Lay chunk `index` of the environment's current track into its ring position
+    void installChunk(int env, int index);
+
+    // Write the observations of environments [first, last)
+    void observe(int first, int last);
+
+    int envCount;
+    unsigned seed;
+    BatchEnvConfig config;
+    JobSystem* jobs;
+    float finishY;
+    const int8_t* pendingActions = nullptr;  // Actions of the step in progress
+
+    // Per environment
+    std::vector<float> carX, carY, speed;
+    std::vector<float> previousX, previousY;  // At the start of the step
+    std::vector<int32_t> stepsTaken;
+    std::vector<int32_t> windowChunk;   // Lowest chunk index in the window
+    std::vector<uint32_t> episodeIndex;
+    std::vector<uint8_t> hit;           // Scratch: the car hit an obstacle this step
+
+    // Per obstacle slot and environment, at [slot * envCount + env]. Chunk k
+    // of the road sits in slots (k % WINDOW_CHUNKS) * TrackChunk::OBSTACLES onwards.
+    std::vector<int32_t> obstacleX, obstacleY;
+    std::vector<uint8_t> visible;
+    std::vector<uint8_t> counted;       // Already hit this episode
+
+    std::vector<float> observationBuffer;
+    std::vector<float> rewardBuffer;
+    std::vector<uint8_t> doneBuffer;
+
+    // Per range of environments, so workers never share a counter; summed by getStats
+    struct alignas(64) RangeStats {
+        Stats stats;
+    };
+    std::vector<RangeStats> rangeStats;
+    int grain;  // Environments per range
+};
+
+#endif // BATCH_ENV_H
@@ -1,16 +1,16 @@
 #ifndef CAR_H
 #define CAR_H
 
-#include <SDL.h>
-#include <SDL_image.h>
-#include <memory>
-#include <mutex>
-#include <iostream>
+class StateWriter;
+class StateReader;
 
+// Simulation state of one car; drawing is left to the frontend so this
+// class has no SDL dependency. Not synchronized: only the simulation touches
+// cars, everyone else reads the published WorldSnapshot.
 class Car {
 public:
-    // Constructor: Initialize the car with initial position and texture
-    Car(int x, int y, const std::string& textureFilePath, SDL_Renderer* renderer);
+    // Constructor: Initialize the car with initial position
+    Car(int x, int y);
 
     // Copy constructor
     Car(const Car& other);
@@ -30,8 +30,19 @@ public:
     // Move the car based on elapsed time (deltaTime)
     void move(float deltaTime);
 
-    // Render the car on the given renderer
-    void render(SDL_Renderer* renderer);
+    // Remember the current position as the start of the next simulation step
+    void savePreviousState();
+
+    // Position blended between the previous and current simulation step
+    // by alpha (0 = previous, 1 = current), used for rendering
+    float getInterpolatedX(float alpha) const;
+    float getInterpolatedY(float alpha) const;
+
+    // Sub-pixel position now and at the start of the current step
+    float getPositionX() const { return x; }
+    float getPositionY() const { return y; }
+    float getPreviousX() const { return previousX; }
+    float getPreviousY() const { return previousY; }
 
     // Get the X position of the car
     int getX() const;
@@ -57,15 +68,30 @@ public:
     // Reset the car's position to the specified coordinates
     void reset(int x, int y);
 
+    // Whether the car has reached the finish line
+    bool hasFinished() const;
+
+    // Move the finish line the car is clamped to; world y decreases up the road
+    void setFinishLine(int finishY);
+    int getFinishLine() const { return finishLineY; }
+
     // Current speed of the car
-    float speed;
+    float getSpeed() const { return speed; }
+    void setSpeed(float newSpeed);
+
+    // Ground covered since the last reset
+    float getDistanceCovered() const { return distanceCovered; }
+    void addDistanceCovered(float distance);
+
+    // Write or restore the full dynamic state, for keyframes
+    void saveState(StateWriter& writer) const;
+    void loadState(StateReader& reader);
 
     // Car dynamics constants
     static const float ACCELERATION_RATE;
     static const float DECELERATION_RATE;
     static const float MAX_SPEED;
     static const int FINISH_LINE_X;
-    float distanceCovered = 0.0f;
 
     // Move the car to the right
     void moveRight();
@@ -73,22 +99,26 @@ public:
     // Move the car to the left
     void moveLeft();
 
+    // Move the car sideways by a fraction of a pixel or more; negative is left
+    void moveSideways(float distance);
+
     // Get the width of the car
-    int getWidth() {
+    int getWidth() const {
         return 39;
     };
 
     // Get the height of the car
-    int getHeight() {
+    int getHeight() const {
         return 65;
     };
 
 private:
-    int x, y;
-    std::shared_ptr<SDL_Texture> texture;
-    mutable std::mutex carMutex;  // Mutex to protect car attributes
-    std::shared_ptr<SDL_Texture> loadTexture(const std::string& path, SDL_Renderer* renderer);
-    static const int START_LINE_Y; // Adjust this value based on your desired starting position in the Y-axis.
+    float speed;
+    float distanceCovered = 0.0f;
+    float x, y;  // Sub-pixel position so small fixed steps still accumulate
+    float previousX, previousY;  // Position at the start of the current simulation step
+    static const int START_LINE_Y; // Default finish line: the top of the screen
+    int finishLineY = START_LINE_Y;  // Upper boundary of the road for this race
 
     int moveDistance = 10;  // Default move distance to the right
     int moveDistanceLeft = -10;  // Default move distance to the left
@@ -0,0 +1,54 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include "frame_pacer.h"
+#include <string>
+
+// Runtime settings of the game, filled from the command line
+struct GameConfig {
+    // Simulation steps per second; rendering runs independently of this
+    int tickRate = 120;
+
+    // Most simulation steps run for a single rendered frame before the
+    // remaining backlog is dropped (keeps one long hitch from spiralling)
+    int maxCatchUpSteps = 8;
+
+    // Distance in pixels from the start to the finish line
+    int raceLength = 6000;
+
+    // AI cars racing the player
+    int aiCars = 1;
+
+    // Microseconds each AI car may spend planning per simulation step
+    int aiBudgetMicros = 100;
+
+    // How the render loop is throttled, and the frame rate of PacingMode::Capped
+    PacingMode pacing = PacingMode::VSync;
+    int targetFps = 144;
+
+    // Record the session's seed, commands and keyframes to this file
+    std::string recordPath;
+
+    // Play this recording instead of taking input, replaySpeed times real time,
+    // starting replayStart simulation steps in
+    std::string replayPath;
+    int replaySpeed = 1;
+    int replayStart = 0;
+
+    // Race layout; 0 picks one from the clock
+    unsigned seed = 0;
+
+    // Race another player over UDP instead of the AI: "host" drives the
+    // player's car, "join" the rival. Both sides need the same seed and race
+    // length. The ports default to 7777 for the host and 7778 for the other
+    // side, and the peer to this machine.
+    std::string netplay;
+    int netPort = 0;
+    std::string netPeer;
+    int netDelay = 0;  // Simulated one-way latency in milliseconds, for trying rollback locally
+};
+
+// Parse command line flags such as --tick-rate 120; unknown flags are reported and ignored
+GameConfig parseCommandLine(int argc, char* args[]);
+
+#endif // CONFIG_H
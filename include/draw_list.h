@@ -0,0 +1,102 @@
+#ifndef DRAW_LIST_H
+#define DRAW_LIST_H
+
+#include "particle_system.h"
+#include "simulation_types.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Everything the renderer is asked to draw, recorded by the simulation thread
+// without any SDL calls and replayed on the render thread
+
+// Sprites the renderer maps to textures
+enum class SpriteId { Background, PlayerCar, AiCar, Obstacle };
+
+// Fonts the renderer maps to loaded font ids
+enum class FontId { Normal, Large };
+
+// ScrollingBackground fills the screen with the tiled road; its y is the
+// world y where the road's first row starts
+enum class DrawCommandType { Sprite, Rect, Text, ScrollingBackground };
+
+enum class TextAlign { Left, Center };
+
+// HUD groups whose text the renderer caches as one layer each; None is drawn every frame
+enum class HudPanel { None = -1, Player, Computer, Banner };
+const int HUD_PANEL_COUNT = 3;
+
+struct DrawColor {
+    uint8_t r, g, b, a;
+};
+
+// One recorded draw
+struct DrawCommand {
+    DrawCommandType type = DrawCommandType::Sprite;
+    int layer = 0;
+    bool screenSpace = false;  // HUD: not moved by the camera
+
+    // Position at the start and end of the step, blended by the renderer;
+    // the size stays constant over a step
+    float previousX = 0.0f, previousY = 0.0f;
+    float x = 0.0f, y = 0.0f;
+    float width = 0.0f, height = 0.0f;
+
+    SpriteId sprite = SpriteId::Background;  // Sprite only
+    DrawColor color = {255, 255, 255, 255};  // Rect fill, text and sprite tint
+
+    // Text only: characters are stored in DrawList::text
+    FontId font = FontId::Normal;
+    uint32_t textOffset = 0;
+    uint32_t textLength = 0;
+    TextAlign align = TextAlign::Left;
+    int line = 0;        // Lines below y, in the font's line spacing
+    bool blink = false;  // Drawn only during the visible half of the blink cycle
+    HudPanel panel = HudPanel::None;
+};
+
+// The commands of one simulation tick
+struct DrawList {
+    uint64_t tick = 0;
+    std::chrono::steady_clock::time_point stepTime;  // When the step ended
+    float stepSeconds = 0.0f;
+
+    // Camera y at the start and end of the step; world-space commands are drawn relative to it
+    float cameraPreviousY = 0.0f;
+    float cameraY = 0.0f;
+
+    uint32_t inputSequence = 0;  // Newest key press (SimulationCommand::inputSequence) this list shows
+    int obstacleCount = 0;  // Obstacle slots in the simulation, for reports
+    PlannerStats aiPlanner; // AI search counters, for reports
+    bool netplay = false;   // A remote player drives one of the cars
+    RollbackStats rollback; // Netplay counters, for reports
+    std::vector<DrawCommand> commands;
+    std::string text;
+    std::vector<ParticleEmitter> emitters;  // Effects of this state; bursts are meant to fire once per tick
+
+    // Empty the list, keeping its buffers
+    void clear() {
+        commands.clear();
+        text.clear();
+        emitters.clear();
+    }
+
+    // Append a text command; the string is copied into the list
+    DrawCommand& addText(const char* characters, FontId font, float x, float y) {
+        DrawCommand command;
+        command.type = DrawCommandType::Text;
+        command.screenSpace = true;
+        command.font = font;
+        command.x = command.previousX = x;
+        command.y = command.previousY = y;
+        command.textOffset = static_cast<uint32_t>(text.size());
+        text.append(characters);
+        command.textLength = static_cast<uint32_t>(text.size()) - command.textOffset;
+        text.push_back('\0');  // So the renderer can pass text.c_str() + textOffset straight on
+        commands.push_back(command);
+        return commands.back();
+    }
+};
+
+#endif // DRAW_LIST_H
@@ -0,0 +1,59 @@
+#ifndef DRAW_LIST_RENDERER_H
+#define DRAW_LIST_RENDERER_H
+
+#include "asset_manager.h"
+#include "background_tiles.h"
+#include "hud_layers.h"
+#include "draw_list.h"
+#include "sprite_batch.h"
+#include "text_cache.h"
+#include <array>
+
+// Replays recorded draw lists into a sprite batch and a text cache on the
+// render thread, mapping sprite and font ids to loaded assets
+class DrawListRenderer {
+public:
+    // Constructor: the batch, cache and assets must outlive the renderer
+    DrawListRenderer(SpriteBatch& batch, TextCache& textCache, AssetManager& assets);
+
+    // Asset drawn for a sprite id; sprites without one are skipped
+    void setSprite(SpriteId sprite, AssetHandle handle);
+
+    // Tiles drawn for ScrollingBackground commands; they are skipped without any
+    void setBackgroundTiles(BackgroundTiles* tiles) { backgroundTiles = tiles; }
+
+    // Cache for text commands that belong to a HudPanel; without one all text is drawn every frame
+    void setHudLayers(HudLayers* layers) { hudLayers = layers; }
+
+    // TextCache font ids for FontId::Normal and FontId::Large
+    void setFonts(int normalFont, int largeFont);
+
+    // Queue the list with moving objects alpha of the way from the start (0)
+    // to the end (1) of its step; blinking text only when textVisible
+    void render(const DrawList& list, float alpha, bool textVisible);
+
+    // Same, with alpha taken from how much real time has passed since the step
+    void render(const DrawList& list, bool textVisible);
+
+    // World y shown at the top of the screen in the last rendered list
+    float getCameraY() const { return cameraY; }
+
+    static constexpr float SCREEN_HEIGHT = 634.0f;
+
+private:
+    // Screen position of a text command's top-left corner
+    void placeText(const DrawCommand& command, int fontId, const char* text, float x, float y, int& textX, int& textY) const;
+
+    SpriteBatch& batch;
+    TextCache& textCache;
+    AssetManager& assets;
+    BackgroundTiles* backgroundTiles = nullptr;
+    HudLayers* hudLayers = nullptr;
+
+    std::array<AssetHandle, 4> sprites = {{-1, -1, -1, -1}};  // By SpriteId
+    int normalFont = -1;
+    int largeFont = -1;
+    float cameraY = 0.0f;
+};
+
+#endif // DRAW_LIST_RENDERER_H
@@ -0,0 +1,74 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// How the render loop is throttled
+enum class PacingMode {
+    VSync,     // Present blocks until the display refreshes; least CPU
+    Capped,    // Fixed target rate: sleep most of the wait, spin the last stretch
+    Uncapped,  // As fast as possible, for benchmarking
+};
+
+// Paces the render loop and measures how evenly frames are delivered. Capped
+// mode keeps an absolute schedule of deadlines (so errors do not accumulate),
+// sleeps until shortly before each one and spins the rest; the spin margin
+// follows how late the OS has been waking the thread, so it stays small on
+// systems with precise timers.
+class FramePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Frame time distribution of the frames since the last takeStats()
+    struct Stats {
+        int frames = 0;
+        double p50Millis = 0.0;        // Median frame time
+        double p99Millis = 0.0;
+        double maxMillis = 0.0;
+        double jitterP50Millis = 0.0;  // Distance of a frame time from the median
+        double jitterP99Millis = 0.0;
+        double spinMarginMillis = 0.0; // Capped mode: how early the sleep ends
+    };
+
+    // Constructor: targetFps is used by Capped mode
+    FramePacer(PacingMode mode, int targetFps);
+
+    // Switch mode or rate; the schedule restarts from the next frame
+    void setMode(PacingMode mode, int targetFps);
+    PacingMode getMode() const { return mode; }
+    int getTargetFps() const { return targetFps; }
+
+    // Call once per frame after presenting: waits until the next frame is due
+    // (Capped only) and records the frame time
+    void endFrame();
+
+    // Percentiles of the recorded frame times; clears them
+    Stats takeStats();
+
+    static const int MAX_SAMPLES = 4096;  // Frame times kept between reports
+
+private:
+    // Sleep, then spin, until the deadline
+    void waitUntil(Clock::time_point deadline);
+
+    PacingMode mode;
+    int targetFps;
+    Clock::duration period;
+    Clock::time_point nextDeadline;
+    Clock::time_point lastFrameEnd;
+    bool started = false;
+
+    double spinMarginSeconds;        // Sleeps end this long before the deadline
+    std::vector<float> frameMillis;  // Since the last report
+    std::vector<float> scratch;      // Sorting space for takeStats
+};
+
+// Mode named on the command line (vsync, cap or uncapped); false if unknown
+bool parsePacingMode(const char* name, PacingMode& mode);
+
+// Name of a mode, as accepted by parsePacingMode
+const char* pacingModeName(PacingMode mode);
+
+#endif // FRAME_PACER_H
@@ -4,29 +4,33 @@
 #include <SDL.h>
 #include <SDL_image.h>
 #include <SDL_ttf.h>
-#include "car.h"
-#include "obstacle.h"
+#include "asset_manager.h"
+#include "background_tiles.h"
+#include "config.h"
+#include "draw_list_renderer.h"
+#include "frame_pacer.h"
+#include "hud_layers.h"
+#include "input_sampler.h"
+#include "job_system.h"
+#include "particle_renderer.h"
+#include "particle_system.h"
+#include "profiler_overlay.h"
+#include "replay.h"
+#include "rollback_session.h"
+#include "simulation.h"
+#include "simulation_thread.h"
+#include "sprite_batch.h"
+#include "text_cache.h"
+#include "udp_link.h"
 #include <memory>
-#include <thread>
-
-// Enum representing the different states of the game
-enum class GameState {
-    STARTED,
-    STOPPED,
-    PAUSED,
-    RESET,
-    RUNNING,
-    QUIT,
-    GAMEOVER
-};
-
-// Enum representing directions to avoid obstacles
-enum class AvoidDirection { None, Left, Right };
+#include <string>
 
+// SDL frontend: owns the window, renderer and assets, turns input events into
+// commands for the simulation thread and draws the lists it records
 class Game {
 public:
     // Constructor
-    Game();
+    explicit Game(const GameConfig& config = GameConfig());
 
     // Destructor
     ~Game();
@@ -43,6 +47,12 @@ private:
     // Initialize the game
     void initGame();
 
+    // Set up playback of config.replayPath
+    void initReplay();
+
+    // Set up a race against the peer named by config.netplay and its flags
+    void initNetplay(unsigned seed);
+
     // Initialize SDL
     void initSDL();
 
@@ -52,73 +62,83 @@ private:
     // Initialize obstacles
     void initObstacles();
 
-    // Update obstacle visibility
-    void updateObstacleVisibility(int carX, int carY, int startIndex, int endIndex);
-
-    // Check for imminent collision
-    AvoidDirection checkImminentCollision(int carX, int carY, int carWidth, int carHeight, const Obstacle& obstacle);
-
-    // Detect collision
-    bool detectCollision(int carX, int carY, int carWidth, int carHeight, const Obstacle& obstacle);
-
-    // Render game over message
-    void renderGameOverMessage();
+    // Add the counters of a flushed frame to the next timing report
+    void accumulateDrawStats(const SpriteBatch::FrameStats& stats);
 
-    // Reset obstacle visibility
-    void resetObstaclesVisibility();
-
-    // Load a texture from the given path
-    SDL_Texture* loadTexture(const std::string &path);
-
-    // Render statistics on the screen
-    void renderStatistics(int x, int y, const std::string &carName, float carSpeed, float carDistance);
+    // Upload finished assets; called once per frame on the render thread
+    void updateAssets();
 
     // Handle user input events
     void handleEvents(SDL_Event& e);
 
-    // Update game state and logic
-    void update();
+    // Spawn the effects of the newest draw list and move every particle by deltaTime
+    void updateParticles(const DrawList* list, float deltaTime);
 
-    // Render the game
-    void render();
+    // Render the game from the newest draw list (null before the first one)
+    void render(const DrawList* list);
 
-    // Variables
-    GameState gameState; // Current game state
 
-    AvoidDirection avoidDirection; // Direction to avoid obstacles
+    // Print the per-task timings of the job system
+    void reportTaskTimings();
+
+    // Variables
+    GameConfig config; // Settings such as the simulation tick rate
+    FramePacer framePacer; // Throttles the render loop and measures frame times
+    InputSampler inputSampler; // Held driving keys, and press-to-present latency
+
+    std::unique_ptr<JobSystem> jobs; // Worker pool shared by all per-frame tasks
+    std::unique_ptr<Simulation> simulation; // Cars, obstacles and game rules
+    std::unique_ptr<ReplayRecorder> recorder; // Set with --record
+    std::unique_ptr<ReplayFile> replayFile; // Set with --replay
+    std::unique_ptr<ReplayPlayer> replayPlayer;
+    std::unique_ptr<UdpLink> netLink; // Set with --netplay
+    std::unique_ptr<RollbackSession> netSession;
+    std::unique_ptr<SimulationThread> simulationThread; // Steps the simulation and records draw lists
 
     std::shared_ptr<SDL_Window> window; // SDL window
     std::shared_ptr<SDL_Renderer> renderer; // SDL renderer
 
-    std::shared_ptr<SDL_Texture> backgroundTexture;  // The background texture
-
+    std::unique_ptr<AssetManager> assets; // Textures and fonts, loaded in the background
+    AssetHandle backgroundAsset = -1; // The background texture
+    AssetHandle car1Asset = -1; // Player's car texture
+    AssetHandle car2Asset = -1; // AI's car texture
+    AssetHandle obstacleAsset = -1; // Texture for obstacles
+    AssetHandle fontAsset = -1;
+    AssetHandle largeFontAsset = -1;
+    bool assetsReported = false; // Load times are printed once everything is in
 
-    Uint32 currentFrameTime;
-    Uint32 lastFrameTime;
-    float deltaTime;
+    Uint64 lastFrameCounter = 0; // High-resolution counter value of the previous frame
+    bool quitRequested = false; // Set when the window is closed
+    int lastObstacleCount = 0; // Obstacle slots in the last draw list, for reports
+    PlannerStats lastPlannerStats; // AI planner counters of the last draw list, for reports
+    RollbackStats lastRollbackStats; // Netplay counters of the last draw list, for reports
 
-    float accumulatedTime; // Accumulated time
+    float timeSinceTimingReport = 0.0f;
+    const float TIMING_REPORT_INTERVAL = 5.0f; // Seconds between task timing reports
 
-    float scaleFactor; // Scale factor for the game
 
-    bool scalingEnabled = false; // Scaling enabled flag
+    ProfilerOverlay profilerOverlay; // Frame graph and busiest zones, toggled with F2
 
-    std::shared_ptr<Car> car1; // Player's car
-    std::shared_ptr<Car> car2; // AI's car
+    std::unique_ptr<SpriteBatch> spriteBatch; // Background, track and car quads, grouped by texture
+    SpriteBatch::FrameStats drawStatsTotal; // Batch counters summed since the last timing report
+    int drawStatsFrames = 0;
 
-    int car1_initial_x = 380;
-    int car1_initial_y = 550;
-    int car2_initial_x = 580;
-    int car2_initial_y = 550;
+    std::unique_ptr<DrawListRenderer> drawListRenderer; // Replays the simulation thread's lists
+    std::unique_ptr<BackgroundTiles> backgroundTiles; // Pre-scaled rows of the scrolling road
+    std::unique_ptr<HudLayers> hudLayers; // HUD panels, re-rendered only when their text changes
+    HudLayers::Stats lastHudStats; // Counters at the previous timing report
 
-    TTF_Font* font; // Font for text
-    TTF_Font* largeFont; // Larger font for text
+    ParticleSystem particles; // Crash debris, exhaust and tire dust; visual only
+    std::unique_ptr<ParticleRenderer> particleRenderer; // One draw call per particle kind
+    uint64_t lastBurstTick = UINT64_MAX; // Tick of the list whose bursts were last spawned
 
-    std::vector<Obstacle> obstacles; // Vector to store obstacles
-    SDL_Texture* obstacleTexture; // Texture for obstacles
+    std::unique_ptr<TextCache> textCache; // Glyph atlas used for all on-screen text
+    int font = -1; // Font id for text
+    int largeFont = -1; // Larger font id for text
 
     float timeSinceLastBlink = 0.0f;
     const float BLINK_INTERVAL = 0.5f; // Interval for text blinking
+    const float MAX_PARTICLE_STEP = 0.1f; // Longest frame the particles are moved by at once, so a hitch does not flood the pools
     bool isTextVisible = true; // Flag to control text visibility
 };
 
@@ -0,0 +1,83 @@
+#ifndef HUD_LAYERS_H
+#define HUD_LAYERS_H
+
+#include <SDL.h>
+#include "draw_list.h"
+#include "sprite_batch.h"
+#include "text_cache.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Retained HUD: the text of each HudPanel is rendered into a target texture of
+// its own and only rendered again when what it shows changes (the formatted
+// strings, so a value that moves less than its last printed digit is a hit).
+// Every frame each panel then costs one quad in the sprite batch.
+class HudLayers {
+public:
+    // Counters since construction
+    struct Stats {
+        uint64_t hits = 0;     // Panels composited from their cached texture
+        uint64_t misses = 0;   // Panels rendered again because their text changed
+    };
+
+    // Constructor: textures are created on renderer, text comes from textCache
+    HudLayers(SDL_Renderer* renderer, TextCache& textCache);
+
+    // Destructor: frees the panel textures
+    ~HudLayers();
+
+    HudLayers(const HudLayers&) = delete;
+    HudLayers& operator=(const HudLayers&) = delete;
+
+    // Start collecting this frame's panel text
+    void beginFrame();
+
+    // Add a line to a panel, at its final screen position
+    void addText(HudPanel panel, int fontId, int x, int y, const char* text, SDL_Color color);
+
+    // Render the panels whose text changed, then queue one quad per panel that
+    // has text this frame. Panels are rendered through the text cache, so call
+    // this before queuing any other text in the frame. False when render
+    // targets are unsupported; the caller then draws the text itself.
+    bool compose(SpriteBatch& batch, int layer);
+
+    // Render targets lose their contents on some device resets; call on
+    // SDL_RENDER_TARGETS_RESET so every panel is rendered again
+    void invalidate();
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Line {
+        int fontId;
+        int x, y;
+        SDL_Color color;
+        std::string text;
+    };
+
+    struct Panel {
+        std::vector<Line> lines;   // This frame
+        size_t lineCount = 0;
+        std::vector<Line> cached;  // What the texture shows
+        bool valid = false;
+        SDL_Texture* texture = nullptr;
+        int textureWidth = 0, textureHeight = 0;
+        SDL_Rect bounds = {0, 0, 0, 0};  // Screen area the texture covers
+    };
+
+    // Whether the panel's lines are the ones its texture was rendered from
+    bool upToDate(const Panel& panel) const;
+
+    // Render the panel's lines into its texture; false if that is impossible
+    bool render(Panel& panel, SpriteBatch& batch);
+
+    SDL_Renderer* renderer;
+    TextCache& textCache;
+    bool supported;
+    std::array<Panel, HUD_PANEL_COUNT> panels;
+    Stats stats;
+};
+
+#endif // HUD_LAYERS_H
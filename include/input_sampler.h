@@ -0,0 +1,60 @@
+#ifndef INPUT_SAMPLER_H
+#define INPUT_SAMPLER_H
+
+#include <SDL.h>
+#include "simulation_types.h"
+#include <cstdint>
+#include <vector>
+
+// Reads the driving keys (W, S, A, D by position) as held-down state after
+// each event pump, for SimulationCommandType::Controls, and measures how long
+// a key press takes to reach the screen: from when SDL queued the key event
+// to the present of the first frame drawn from a list that a simulation step
+// with the press produced.
+class InputSampler {
+public:
+    // Latency of the presses since the last takeStats()
+    struct Stats {
+        int presses = 0;
+        double p50Millis = 0.0;
+        double p99Millis = 0.0;
+        double maxMillis = 0.0;
+    };
+
+    InputSampler();
+
+    // Main thread, for every SDL_KEYDOWN: remember presses of the driving
+    // keys, so a tap released before the next sample still counts
+    void keyPressed(const SDL_KeyboardEvent& event);
+
+    // Main thread, after the event pump: the controls held now, plus the
+    // keys pressed since the last sample as the command's taps. True (and
+    // `command` filled) when they changed since the last sample.
+    bool sample(SimulationCommand& command);
+
+    // Main thread, right after presenting a frame drawn from a list that
+    // shows inputSequence
+    void framePresented(uint32_t inputSequence);
+
+    // Percentiles of the measured latencies; clears them
+    Stats takeStats();
+
+    static const int MAX_SAMPLES = 1024;
+
+private:
+    struct PendingPress {
+        uint32_t sequence;
+        Uint64 pressedAt;  // High-resolution counter
+    };
+
+    PlayerInput held;          // As last sent
+    PlayerInput tapped;        // Pressed since the last sample
+    bool pressed = false;      // A driving key went down since the last sample
+    Uint64 firstPressAt = 0;   // Earliest of those presses
+    uint32_t nextSequence = 1;
+    std::vector<PendingPress> pending;
+    std::vector<float> latencyMillis;
+    double counterFrequency;
+};
+
+#endif // INPUT_SAMPLER_H
@@ -0,0 +1,138 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Counts the outstanding tasks of one fork/join section
+class TaskGroup {
+public:
+    // The name is used to report the wall time of the whole group
+    explicit TaskGroup(const char* name = "group") : name(name) {}
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+private:
+    friend class JobSystem;
+    const char* name;
+    std::atomic<int> pending{0};
+    std::chrono::steady_clock::time_point forkTime;
+};
+
+// Timing accumulated for every task (or group) sharing a name
+struct TaskTiming {
+    std::string name;
+    unsigned long count = 0;
+    double totalMicros = 0.0;
+    double maxMicros = 0.0;
+};
+
+// Long-lived pool of worker threads with per-worker work-stealing deques
+class JobSystem {
+public:
+    using Task = std::function<void()>;
+
+    // Constructor: 0 workers means one per hardware thread, minus the caller's
+    explicit JobSystem(unsigned workerCount = 0);
+
+    // Destructor: wakes and joins all workers
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Number of worker threads (the thread calling wait() helps as well)
+    unsigned workerCount() const { return static_cast<unsigned>(workers.size()); }
+
+    // Fork a task into the group
+    void run(TaskGroup& group, const char* name, Task task);
+
+    // Join: execute pending tasks on the calling thread until the group is done
+    void wait(TaskGroup& group);
+
+    // Run body(first, last) over [begin, end) in chunks of at most grain items
+    template <typename Body>
+    void parallelFor(const char* name, int begin, int end, int grain, Body body) {
+        if (grain < 1) grain = 1;
+        TaskGroup group(name);
+        for (int first = begin; first < end; first += grain) {
+            int last = first + grain < end ? first + grain : end;
+            run(group, name, [=]() { body(first, last); });
+        }
+        wait(group);
+    }
+
+    // Copy out and reset the per-task timings collected since the last call
+    std::vector<TaskTiming> takeTimings();
+
+private:
+    struct Job {
+        Task task;
+        TaskGroup* group;
+        const char* name;
+    };
+
+    // A deque owned by one thread: the owner pushes and pops at the back,
+    // thieves take from the front. Stored as a ring that only grows, so a
+    // warmed-up pool queues jobs without allocating.
+    struct WorkQueue {
+        std::mutex mutex;
+        std::vector<Job> ring;
+        size_t head = 0;   // Oldest job
+        size_t count = 0;
+
+        void pushBack(Job&& job);
+        void popBack(Job& job);
+        void popFront(Job& job);
+    };
+
+    void workerLoop(unsigned index);
+    bool popOrSteal(unsigned home, Job& job);
+    void execute(Job& job);
+    void recordTiming(const char* name, bool wall, std::chrono::steady_clock::duration elapsed);
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkQueue>> queues; // One per worker, plus one shared by outside threads
+    std::atomic<unsigned> nextQueue{0};
+
+    std::mutex sleepMutex;
+    std::condition_variable wakeCondition;
+    std::atomic<int> queuedJobs{0};
+    bool stopping = false;
+
+    // Running totals of one task or group name on one thread. The name is
+    // claimed once and kept; takeTimings() swaps the counters out, so
+    // recording never locks or allocates.
+    struct TimingSlot {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> count{0};
+        std::atomic<uint64_t> totalNanos{0};
+        std::atomic<uint64_t> maxNanos{0};
+    };
+
+    // Slots keyed by name pointer, tasks apart from the wall time of whole
+    // groups; names past the last slot go uncounted
+    static const size_t TIMING_SLOTS = 64;
+    struct TimingTable {
+        std::array<TimingSlot, TIMING_SLOTS> tasks;
+        std::array<TimingSlot, TIMING_SLOTS> walls;
+    };
+
+    static void mergeTimings(std::array<TimingSlot, TIMING_SLOTS>& slots, const char* suffix,
+                             std::map<std::string, TaskTiming>& merged);
+
+    std::vector<std::unique_ptr<TimingTable>> timingTables; // One per queue, like queues
+};
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,104 @@
+#ifndef OBSTACLE_FIELD_H
+#define OBSTACLE_FIELD_H
+
+#include "obstacle.h"
+#include "spatial_hash.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class StateWriter;
+class StateReader;
+enum class SimdLevel;
+
+// All obstacles of a race stored as structure-of-arrays: contiguous edge and
+// flag arrays, so one SIMD instruction can test a box against 8 obstacles,
+// plus a spatial hash so queries on large fields only visit nearby cells.
+// Distinct obstacles' flags may be written from different threads and queries
+// may run concurrently; adding or moving obstacles needs exclusive access.
+class ObstacleField {
+public:
+    // Append an obstacle on the given road and return its index
+    size_t add(int x, int y, int width, int height, int road = 0);
+
+    // Remove every obstacle
+    void clear();
+
+    // Number of obstacles
+    size_t size() const { return lefts.size(); }
+
+    // Copy of one obstacle
+    Obstacle get(size_t index) const;
+
+    // Per-obstacle accessors
+    int getX(size_t index) const { return lefts[index]; }
+    int getY(size_t index) const { return tops[index]; }
+    int getWidth(size_t index) const { return rights[index] - lefts[index]; }
+    int getHeight(size_t index) const { return bottoms[index] - tops[index]; }
+    bool isVisible(size_t index) const { return (flags[index] & VISIBLE) != 0; }
+    int getRoad(size_t index) const { return roads[index]; }
+
+    // Set the visibility of one obstacle
+    void setVisible(size_t index, bool visibility);
+
+    // Set the position of one obstacle
+    void setPosition(size_t index, int x, int y);
+
+    // Hide every obstacle
+    void resetVisibility();
+
+    // Write or restore positions and visibility, for keyframes. Restoring
+    // needs a field with the same obstacles (count, sizes and roads).
+    void saveState(StateWriter& writer) const;
+    bool loadState(StateReader& reader);
+
+    // Whether one obstacle overlaps the box at (x, y) of the given size
+    bool overlaps(size_t index, int x, int y, int width, int height) const;
+
+    // Index of the first obstacle in [begin, end) overlapping the box, or -1.
+    // Uses AVX2 or SSE2 when the CPU has them, plain C++ otherwise.
+    int findFirstOverlap(int x, int y, int width, int height, size_t begin, size_t end) const;
+
+    // The same with the kernel of a given instruction set, which the CPU must
+    // support (simdLevelSupported); lets the kernels be checked against each other
+    int findFirstOverlap(SimdLevel kernel, int x, int y, int width, int height, size_t begin, size_t end) const;
+
+    // Same test over every obstacle. Small fields are scanned with SIMD,
+    // large ones go through the spatial hash.
+    int findFirstOverlap(int x, int y, int width, int height) const;
+
+    // Fill out with the obstacles overlapping the box, in index order
+    void queryOverlap(int x, int y, int width, int height, std::vector<int>& out) const;
+
+    // Fraction (0..1) of the straight move of a box from (x0, y0) to (x1, y1)
+    // at which it first overlaps one obstacle, or -1 if it never does; 0 when
+    // it already overlaps at the start
+    float sweptTimeOfImpact(size_t index, int x0, int y0, int x1, int y1, int width, int height) const;
+
+    // Continuous version of findFirstOverlap: the obstacle the moving box hits
+    // first (lowest index on ties) and when, or -1. Nothing is skipped however
+    // far the box moves in one call. When nothing is inside the bounds of the
+    // move it costs one findFirstOverlap of those bounds.
+    int findFirstSweptHit(int x0, int y0, int x1, int y1, int width, int height, float& timeOfImpact) const;
+
+    // Fill out with every obstacle the moving box touches, in index order
+    void querySwept(int x0, int y0, int x1, int y1, int width, int height, std::vector<int>& out) const;
+
+    // Fill out with the obstacles that have a point closer than radius to (x, y), in index order
+    void queryRange(int x, int y, int radius, std::vector<int>& out) const;
+
+    // Fields smaller than this are cheaper to scan linearly than to query
+    // through the spatial hash
+    static const size_t BROADPHASE_MIN_OBSTACLES = 512;
+
+private:
+    static const uint8_t VISIBLE = 1;
+
+    // Edges are stored instead of sizes so the overlap test is four compares
+    std::vector<int32_t> lefts, tops, rights, bottoms;
+    std::vector<uint8_t> flags;
+    std::vector<uint8_t> roads;
+    SpatialHash grid{64};
+};
+
+#endif // OBSTACLE_FIELD_H
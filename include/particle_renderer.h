@@ -0,0 +1,45 @@
+#ifndef PARTICLE_RENDERER_H
+#define PARTICLE_RENDERER_H
+
+#include <SDL.h>
+#include "particle_system.h"
+#include "sprite_batch.h"
+#include <array>
+#include <vector>
+
+// Draws a ParticleSystem: one small texture per ParticleKind, made at
+// construction (a hard chip for debris, soft round puffs for exhaust and
+// dust) and tinted by the vertex colors, and one sprite batch entry per kind,
+// so every kind costs a single draw call however many particles are alive.
+// Vertex buffers are sized to the system's capacity up front.
+class ParticleRenderer {
+public:
+    // Constructor: textures are created on renderer; vertices are sized for system
+    ParticleRenderer(SDL_Renderer* renderer, const ParticleSystem& system);
+
+    // Destructor: frees the textures
+    ~ParticleRenderer();
+
+    ParticleRenderer(const ParticleRenderer&) = delete;
+    ParticleRenderer& operator=(const ParticleRenderer&) = delete;
+
+    // Build the quads of every kind seen from cameraY and queue them on
+    // batch. The vertices stay valid until the next call, past the flush.
+    void draw(SpriteBatch& batch, float cameraY, float viewHeight);
+
+    // Quads queued by the last draw
+    int getQuadCount() const { return quadCount; }
+
+    // Textures, so the batch can forget them before they are destroyed
+    SDL_Texture* getTexture(ParticleKind kind) const { return textures[static_cast<size_t>(kind)]; }
+
+private:
+    static const int TEXTURE_SIZE = 8;
+
+    const ParticleSystem& system;
+    std::array<SDL_Texture*, PARTICLE_KIND_COUNT> textures{};
+    std::array<std::vector<ParticleVertex>, PARTICLE_KIND_COUNT> vertices;
+    int quadCount = 0;
+};
+
+#endif // PARTICLE_RENDERER_H
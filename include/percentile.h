@@ -0,0 +1,16 @@
+#ifndef PERCENTILE_H
+#define PERCENTILE_H
+
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+// Value at fraction q (0 to 1) of samples sorted in ascending order, taking
+// the nearest rank; used by the frame time and input latency reports. The
+// samples must not be empty.
+inline double percentile(const std::vector<float>& sorted, double q) {
+    size_t index = static_cast<size_t>(std::lround(q * (sorted.size() - 1)));
+    return sorted[index];
+}
+
+#endif // PERCENTILE_H
@@ -0,0 +1,102 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Frame profiler: PROFILE_ZONE marks a scope whose start and end times go into
+// a ring buffer owned by the calling thread, so recording never takes a lock.
+// The rings keep the most recent events of every thread for the on-screen
+// overlay and for Chrome / Perfetto trace export (chrome://tracing, ui.perfetto.dev).
+//
+// Zones are compiled in only when EVADOR_PROFILING is 1 (the CMake option of
+// the same name); otherwise the macros expand to nothing.
+
+// One finished zone
+struct ProfileEvent {
+    const char* name;     // Must outlive the profiler, e.g. a string literal
+    uint64_t startNanos;  // Since the profiler's epoch
+    uint64_t endNanos;
+    uint32_t thread;      // Index into Profiler::threadNames()
+};
+
+// Time spent in all zones sharing a name
+struct ZoneSummary {
+    const char* name = nullptr;
+    unsigned long count = 0;
+    double totalMillis = 0.0;
+    double maxMillis = 0.0;
+};
+
+class Profiler {
+public:
+    // Events kept per thread; older ones are overwritten
+    static const size_t RING_CAPACITY = 1 << 15;
+
+    // Frame times kept for the overlay graph
+    static const size_t FRAME_HISTORY = 240;
+
+    // Nanoseconds since the profiler's epoch (process start)
+    static uint64_t now();
+
+    // Append a finished zone to the calling thread's ring
+    static void record(const char* name, uint64_t startNanos, uint64_t endNanos);
+
+    // Name the calling thread in traces and summaries
+    static void setThreadName(const std::string& name);
+
+    // End the current frame of the calling thread, which should be the only
+    // one marking frames; also records the frame itself as a "Frame" zone
+    static void markFrame();
+
+    // Durations of the most recent frames in milliseconds, oldest first.
+    // Call from the thread that marks frames.
+    static std::vector<float> recentFrameTimes();
+
+    // Copy out every event that ended after sinceNanos, from all threads
+    static std::vector<ProfileEvent> collect(uint64_t sinceNanos = 0);
+
+    // Per-name totals of the events that ended after sinceNanos, largest total first
+    static std::vector<ZoneSummary> summarize(uint64_t sinceNanos);
+
+    // Names of the threads that have recorded, by ProfileEvent::thread
+    static std::vector<std::string> threadNames();
+
+    // Write every buffered event as Chrome trace event JSON; false on I/O failure
+    static bool writeChromeTrace(const std::string& path);
+};
+
+// Records its own lifetime as one zone
+class ProfileZone {
+public:
+    explicit ProfileZone(const char* name) : name(name), start(Profiler::now()) {}
+    ~ProfileZone() { Profiler::record(name, start, Profiler::now()); }
+
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#ifndef EVADOR_PROFILING
+#define EVADOR_PROFILING 0
+#endif
+
+#if EVADOR_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Time the rest of the enclosing scope under name (a string with static lifetime)
+#define PROFILE_ZONE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_FRAME() Profiler::markFrame()
+#define PROFILE_THREAD(name) Profiler::setThreadName(name)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FRAME() ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
+
+#endif // PROFILER_H
@@ -0,0 +1,37 @@
+#ifndef PROFILER_OVERLAY_H
+#define PROFILER_OVERLAY_H
+
+#include "profiler.h"
+#include "sprite_batch.h"
+#include "text_cache.h"
+#include <cstdint>
+#include <vector>
+
+// On-screen view of the profiler: a graph of recent frame times and the zones
+// that took the most time per frame over the last second
+class ProfilerOverlay {
+public:
+    // Show or hide the overlay
+    void toggle() { visible = !visible; }
+    bool isVisible() const { return visible; }
+
+    // Queue the panel; call on the thread that marks frames
+    void draw(SpriteBatch& batch, TextCache& text, int fontId);
+
+private:
+    // Zones listed below the graph
+    static const int TOP_ZONES = 7;
+
+    // The zone table is rebuilt at most this often, to keep the overlay itself cheap
+    static const uint64_t SUMMARY_INTERVAL_NANOS = 500000000;
+
+    // Events older than this are left out of the zone table
+    static const uint64_t SUMMARY_WINDOW_NANOS = 1000000000;
+
+    bool visible = false;
+    uint64_t lastSummaryNanos = 0;
+    std::vector<ZoneSummary> topZones;
+    unsigned long summaryFrames = 0;
+};
+
+#endif // PROFILER_OVERLAY_H
@@ -0,0 +1,147 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "simulation.h"
+#include "simulation_types.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Deterministic recordings of a session: the seed plus every command stamped
+// with the simulation step it was applied before, and a keyframe of the whole
+// simulation state every keyframeInterval steps. Replaying the commands on a
+// simulation built from the same seed reproduces the session exactly; the
+// keyframes let a player jump to any step by restoring the keyframe at or
+// before it and re-simulating less than one interval.
+//
+// File layout (little-endian): "EVRP", version u16, reserved u16, seed u32,
+// tick rate u32, step seconds f32, race length u32, AI cars u32, keyframe interval u32,
+// then records of a tag byte and a varint tick delta:
+//   'C' command: type u8, input bits u8 (held controls low nibble, taps high)
+//   'K' keyframe: varint commands before it, varint size, state bytes
+//   'E' end of recording
+
+struct ReplayHeader {
+    uint32_t seed = 0;
+    uint32_t tickRate = 120;
+    float stepSeconds = 1.0f / 120;  // The exact step the session ran with
+    uint32_t raceLength = Simulation::DEFAULT_RACE_LENGTH;
+    uint32_t aiCars = 1;
+    uint32_t keyframeInterval = 240;
+};
+
+// A command and the step it was applied before
+struct ReplayEvent {
+    uint64_t tick;
+    SimulationCommand command;
+};
+
+// The simulation state after `tick` steps, before the commands stamped `tick`
+struct ReplayKeyframe {
+    uint64_t tick;
+    size_t eventIndex;  // Events recorded before the keyframe
+    std::vector<uint8_t> state;
+};
+
+// Writes a recording as the session runs; owned by the thread stepping the simulation
+class ReplayRecorder {
+public:
+    static const uint32_t DEFAULT_KEYFRAME_INTERVAL = 240;
+
+    ReplayRecorder() = default;
+
+    // Destructor: finishes the file
+    ~ReplayRecorder();
+
+    ReplayRecorder(const ReplayRecorder&) = delete;
+    ReplayRecorder& operator=(const ReplayRecorder&) = delete;
+
+    // Create the file and take the first keyframe of the simulation as it is now
+    bool open(const std::string& path, const Simulation& simulation, float stepSeconds,
+              uint32_t keyframeInterval = DEFAULT_KEYFRAME_INTERVAL);
+
+    // Log a command about to be applied to the simulation
+    void recordCommand(const SimulationCommand& command);
+
+    // Count a step that just ran; takes a keyframe every keyframeInterval steps
+    void recordStep(const Simulation& simulation);
+
+    // Write the end marker and close the file
+    void close();
+
+    bool isOpen() const { return file != nullptr; }
+    uint64_t getTicks() const { return tick; }
+    uint64_t getBytesWritten() const { return bytesWritten; }
+
+private:
+    void writeKeyframe(const Simulation& simulation);
+
+    // Tag and tick delta of a record
+    void beginRecord(std::vector<uint8_t>& out, uint8_t tag);
+    void write(const std::vector<uint8_t>& bytes);
+
+    std::FILE* file = nullptr;
+    uint32_t keyframeInterval = DEFAULT_KEYFRAME_INTERVAL;
+    uint64_t tick = 0;        // Steps since the recording started
+    uint64_t recordTick = 0;  // Tick of the last record, for deltas
+    uint64_t commandCount = 0;
+    uint64_t bytesWritten = 0;
+    std::vector<uint8_t> scratch;
+    std::vector<uint8_t> state;
+};
+
+// A recording read into memory
+struct ReplayFile {
+    ReplayHeader header;
+    std::vector<ReplayEvent> events;
+    std::vector<ReplayKeyframe> keyframes;  // keyframes[i].tick == i * keyframeInterval
+    uint64_t endTick = 0;                   // Last step recorded
+    bool complete = false;                  // Whether the end marker was reached
+
+    // Read a file; a recording cut short by a crash loads up to its last whole record
+    bool load(const std::string& path, std::string& error);
+};
+
+// Re-runs a recording on a simulation built from its header
+class ReplayPlayer {
+public:
+    // The simulation must have been constructed with the header's seed, race length and AI cars
+    ReplayPlayer(const ReplayFile& file, Simulation& simulation);
+
+    // Restore the state after `tick` steps: O(1) to find the keyframe, then
+    // fewer than keyframeInterval steps. A step past the end of the recording
+    // stops at the end and returns false, like one the race never reached.
+    bool seek(uint64_t tick);
+
+    // Apply the commands stamped with the current step, then run it; false
+    // once the recording has nothing left to play
+    bool advance();
+
+    // Advance until the given step or the end; returns the steps run
+    uint64_t runTo(uint64_t tick);
+
+    // Compare the state with the recorded keyframe whenever playback passes
+    // one; mismatches are counted, not fatal
+    void setVerify(bool enabled) { verify = enabled; }
+    int getMismatches() const { return mismatches; }
+    int getKeyframesChecked() const { return keyframesChecked; }
+
+    uint64_t getTick() const { return tick; }
+    bool isFinished() const;
+    Simulation& getSimulation() { return simulation; }
+
+private:
+    void checkKeyframe();
+
+    const ReplayFile& file;
+    Simulation& simulation;
+    uint64_t tick = 0;
+    size_t nextEvent = 0;
+    bool verify = false;
+    int mismatches = 0;
+    int keyframesChecked = 0;
+    std::vector<uint8_t> scratch;
+};
+
+#endif // REPLAY_H
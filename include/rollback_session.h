@@ -0,0 +1,130 @@
+#ifndef ROLLBACK_SESSION_H
+#define ROLLBACK_SESSION_H
+
+#include "simulation.h"
+#include "udp_link.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Head-to-head race between two processes with rollback netcode. Only
+// controls cross the network: every datagram carries the sender's controls
+// for each frame the peer has not acknowledged yet, so a lost datagram is
+// covered by the next one. Each tick applies the local controls at once and
+// predicts the remote player's (the last ones received, held on). When the
+// real ones arrive and differ, the world is restored from the snapshot taken
+// before the first mispredicted frame and every frame since is simulated
+// again inside the same tick. Snapshots are Simulation keyframes in a ring
+// of buffers that keep their capacity, and restoring moves obstacles between
+// spatial hash cells that are reused, so saving and restoring do not
+// allocate once warmed up. The simulation must have been built without a
+// job system, whose tasks may allocate; inline steps do not (evador_bench
+// checks both).
+//
+// Player 0 drives the player's car, player 1 the rival (Simulation's first
+// AI car). Both peers need the same race length. Player 1 joins player 0's
+// race: before its first frame it takes the seed from the host's datagrams,
+// so only the host needs to choose one.
+class RollbackSession {
+public:
+    static const int MAX_ROLLBACK_FRAMES = 32;  // Frames the local player may run ahead of the remote inputs received
+    static const int CHECKSUM_INTERVAL = 60;    // Frames between state checksums compared with the peer
+
+    // Constructor: switches the simulation to head-to-head
+    RollbackSession(Simulation& simulation, UdpLink& link, int localPlayer, float stepSeconds);
+
+    // Controls the local player holds now; used from the next frame on.
+    // Taps are held for the next frame even if released before it.
+    void setLocalControls(const PlayerInput& controls, const PlayerInput& tapped = PlayerInput()) {
+        localControls = controls;
+        localTaps = combineControls(localTaps, tapped);
+    }
+
+    // One tick: read the peer's datagrams, correct mispredictions, advance
+    // one frame unless too far ahead of the peer, then send. True when the
+    // world changed. Starts the race once the peer answers.
+    bool tick();
+
+    bool isConnected() const { return connected; }
+    bool hasFailed() const { return !error.empty(); }
+    const std::string& getError() const { return error; }
+    int getLocalPlayer() const { return localPlayer; }
+
+    // Frames simulated, and how many of them used only confirmed remote input
+    int getFrame() const { return frame; }
+    int getConfirmedFrame() const { return remoteConfirmed + 1 < frame ? remoteConfirmed + 1 : frame; }
+
+    const RollbackStats& getStats() const { return stats; }
+
+private:
+    static const int STATE_RING = MAX_ROLLBACK_FRAMES + 1;
+    static const int INPUT_RING = 256;
+    static const int MAX_INPUTS_PER_DATAGRAM = 64;
+    static const int CHECKSUM_RING = 8;
+
+    // Read every waiting datagram; the first frame whose prediction was wrong, or -1
+    int receive();
+    void readDatagram(const uint8_t* data, size_t size, int& firstWrong);
+
+    // Restore the snapshot of firstWrong and simulate up to the current frame again
+    void rollBack(int firstWrong);
+
+    // Snapshot the world (unless it was just restored), apply both players'
+    // controls for `index` and step
+    void simulateFrame(int index, bool snapshot);
+
+    // Remote controls for a frame: received, or predicted from the last received
+    uint8_t remoteInputFor(int index) const;
+
+    // Checksum the snapshots every peer now agrees on
+    void updateChecksums();
+
+    // Slow down when this peer runs further ahead than the other
+    bool shouldWaitForPeer();
+
+    void send();
+
+    Simulation& simulation;
+    UdpLink& link;
+    int localPlayer;
+    float stepSeconds;
+    bool connected = false;
+    std::string error;
+
+    PlayerInput localControls;
+    PlayerInput localTaps;        // Pressed since the last frame; added to it, then cleared
+    int frame = 0;                // Frames simulated; the world is at the start of this one
+    int remoteConfirmed = -1;     // Newest frame with every remote input up to it received
+    int acknowledged = -1;        // Newest local input the peer has confirmed
+
+    std::array<uint8_t, INPUT_RING> localInputs{};
+    std::array<uint8_t, INPUT_RING> remoteInputs{};
+    std::array<uint8_t, STATE_RING> usedRemoteInputs{};  // What each unconfirmed frame was simulated with
+    std::array<std::vector<uint8_t>, STATE_RING> states;  // World at the start of each recent frame
+
+    // Time synchronization, in frames
+    int remoteFrame = 0;          // The peer's frame when it sent its newest datagram
+    int remoteAdvantage = 0;      // How far the peer thinks it is ahead of us
+    float roundTrip = 0.0f;       // Smoothed
+    int waitFrames = 0;           // Ticks still to skip
+    int lastSyncFrame = 0;
+
+    // Own checksums of confirmed frames, and the next frame to checksum
+    struct Checksum {
+        int frame = -1;
+        uint32_t value = 0;
+    };
+    std::array<Checksum, CHECKSUM_RING> checksums;
+    int nextChecksumFrame = 0;
+    int remoteChecksumFrame = -1;
+    uint32_t remoteChecksum = 0;
+    int comparedChecksumFrame = -1;
+
+    std::vector<uint8_t> datagram;  // Outgoing datagram, reused
+    std::array<uint8_t, UdpLink::MAX_DATAGRAM> incoming{};
+
+    RollbackStats stats;
+};
+
+#endif // ROLLBACK_SESSION_H
@@ -0,0 +1,24 @@
+#ifndef SIMD_DISPATCH_H
+#define SIMD_DISPATCH_H
+
+// Vector kernels are compiled per function with target attributes and chosen
+// at run time, so one build runs on every x86 CPU and still uses AVX2 where
+// there is one. EVADOR_X86_SIMD is defined where such kernels can be built.
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define EVADOR_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+// Widest instruction set a kernel may use
+enum class SimdLevel { Scalar, Sse2, Avx2 };
+
+// What this CPU supports; queried once, then cached
+SimdLevel detectSimdLevel();
+
+// Whether kernels of a level can run here
+bool simdLevelSupported(SimdLevel level);
+
+// Short name, for reports
+const char* simdLevelName(SimdLevel level);
+
+#endif // SIMD_DISPATCH_H
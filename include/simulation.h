@@ -0,0 +1,250 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "ai_planner.h"
+#include "car.h"
+#include "job_system.h"
+#include "obstacle_field.h"
+#include "simulation_types.h"
+#include "track.h"
+#include "triple_buffer.h"
+#include "world_snapshot.h"
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// The game rules without any window, renderer or assets: cars, obstacles,
+// AI avoidance, collisions and game state transitions. Used both by the SDL
+// game and by headless tools. One player races any number of AI cars, which
+// share the AI road as ghosts (they do not collide with each other).
+class Simulation {
+public:
+    // Constructor: the seed decides the track. With a job system the per-step
+    // work is spread over its workers and track chunks are generated ahead of
+    // time on them, otherwise everything runs inline. raceLength is the
+    // distance in pixels from the start to the finish line. AI cars start in
+    // columns across their road, each with its own seeded acceleration.
+    explicit Simulation(unsigned seed, JobSystem* jobs = nullptr, int raceLength = DEFAULT_RACE_LENGTH,
+                        int aiCarCount = 1);
+
+    // Start (or resume) the race
+    void start();
+
+    // Stop the race; it can be resumed with start()
+    void stop();
+
+    // Put cars and obstacles back to the start; ignored while running
+    void reset();
+
+    // Switch to the track and AI cars of another seed, then reset(); ignored
+    // while running. Lets a netplay peer take the seed its host races.
+    void reseed(unsigned newSeed);
+
+    // Request the game to quit
+    void quit();
+
+    // Apply one set of player controls to the player's car
+    void applyInput(const PlayerInput& input);
+
+    // Replace the controls held down; each step then accelerates, brakes and
+    // steers the player's car at PLAYER_THROTTLE_RATE, PLAYER_BRAKE_RATE and PLAYER_STEER_SPEED
+    void setHeldControls(const PlayerInput& controls) { heldControls = controls; }
+    const PlayerInput& getHeldControls() const { return heldControls; }
+
+    // Hold these controls for the next step as well, even if they are
+    // released before it, so a tap shorter than a step still drives the car
+    void latchTappedControls(const PlayerInput& tapped) { tappedControls = combineControls(tappedControls, tapped); }
+
+    // Head-to-head: the first AI car is driven by a second player's held
+    // controls instead of its planner, with the same car physics as the
+    // player, and crashing loses the race for it too. Needs exactly one AI car.
+    void setHeadToHead(bool enabled) { headToHead = enabled && aiDrivers.size() == 1; }
+    bool isHeadToHead() const { return headToHead; }
+
+    // Controls held by the second player in head-to-head
+    void setRivalControls(const PlayerInput& controls) { rivalControls = controls; }
+    const PlayerInput& getRivalControls() const { return rivalControls; }
+
+    // Apply a race control or input command
+    void apply(const SimulationCommand& command);
+
+    // Advance the race by one step of deltaTime seconds
+    void step(float deltaTime);
+
+    // Detect collision: index of the first obstacle the car overlaps, or -1.
+    // Tests 8 obstacles per instruction on AVX2 hardware.
+    int detectCollision(int carX, int carY, int carWidth, int carHeight) const;
+
+    // Continuous collision for a car that moved from (fromX, fromY) to (toX, toY)
+    // this step: index of the obstacle it hit first, or -1, with the fraction of
+    // the move at contact in timeOfImpact. Catches obstacles jumped over
+    // entirely, so coarse steps and fast-forward miss nothing.
+    int detectSweptCollision(int fromX, int fromY, int toX, int toY, int carWidth, int carHeight,
+                             float& timeOfImpact) const;
+
+    // Reveal the obstacles of one road within VISIBILITY_RANGE of the car;
+    // nearby is scratch space owned by the calling task
+    static void updateObstacleVisibility(ObstacleField& field, int carX, int carY, int road, std::vector<int>& nearby);
+
+    // Same test without writing: append the hidden obstacles the car would reveal to `reveal`
+    static void findObstaclesToReveal(const ObstacleField& field, int carX, int carY, int road,
+                                      std::vector<int>& nearby, std::vector<int>& reveal);
+
+    // Microseconds each AI car's planner may search per step (AiPlanner::DEFAULT_BUDGET_MICROS by default)
+    void setAiBudgetMicros(int micros);
+
+    // Serialize the whole race (cars, obstacles, track streaming, rules) so
+    // it can be restored exactly; used for replay keyframes
+    void saveState(std::vector<uint8_t>& out) const;
+
+    // Restore a state saved by a simulation with the same seed and race
+    // length, then publish it; false (state unspecified) on a mismatch
+    bool loadState(const uint8_t* data, size_t size);
+
+    // Latest published world state. Lock-free; meant for one reader thread
+    // (the SimulationThread recording draw lists, or a renderer driving the
+    // simulation directly), while step() and the race controls run on another.
+    const WorldSnapshot& acquireSnapshot() { return snapshots.acquire(); }
+
+    // Accessors, for the thread that drives the simulation
+    GameState getState() const { return gameState; }
+    RaceWinner getWinner() const { return winner; }
+    bool playerCollided() const { return playerHit; }
+    int getAiCollisions() const { return aiCollisions; }
+    float getRaceTime() const { return raceTime; }
+    uint64_t getTick() const { return tick; }  // Steps taken while the race ran
+    unsigned getSeed() const { return seed; }
+    Car& player() { return *car1; }
+    const Car& player() const { return *car1; }
+    int getAiCarCount() const { return static_cast<int>(aiDrivers.size()); }
+    Car& ai(int index = 0) { return aiDrivers[index].car; }
+    const Car& ai(int index = 0) const { return aiDrivers[index].car; }
+    const ObstacleField& getObstacles() const { return obstacles; }
+    const Track& getTrack() const { return track; }
+    const AiPlanner& getAiPlanner(int index = 0) const { return aiDrivers[index].planner; }
+
+    // Planner counters summed over every AI car
+    PlannerStats getAiPlannerStats() const;
+    int getRaceLength() const { return raceLength; }
+    int getFinishLineY() const { return car1_initial_y - raceLength; }
+
+    // The player's car covers ground PLAYER_SPEED_SCALE times faster per unit of speed
+    static const float PLAYER_SPEED_SCALE;
+    static const float AI_ACCELERATION; // Speed gained by the AI car per second
+    static const float PLAYER_THROTTLE_RATE; // Speed gained per second with accelerate held
+    static const float PLAYER_BRAKE_RATE;    // Speed lost per second with decelerate held
+    static const float PLAYER_STEER_SPEED;   // Pixels per second sideways with a steering control held
+    static const int OBSTACLE_WIDTH;
+    static const int OBSTACLE_HEIGHT;
+
+    // Obstacles belong to one road; each car only reveals and avoids its own
+    static const int PLAYER_ROAD = 0;
+    static const int AI_ROAD = 1;
+
+    static const int VISIBILITY_RANGE = 200; // Obstacles closer than this to their car appear
+    static const int DEFAULT_RACE_LENGTH = 6000;
+    static const int MIN_RACE_LENGTH = 100;
+    static const int MAX_RACE_LENGTH = 1000000;
+    static const int MAX_AI_CARS = 4096;
+    static const int AI_COLUMNS = 4;          // AI cars start side by side in this many columns
+    static const int AI_COLUMN_SPACING = 40;
+
+private:
+    // One AI opponent: its car and planner, plus per-car state that lets the
+    // cars be stepped in parallel without sharing writes
+    struct AiDriver {
+        AiDriver(int x, int y, float acceleration, const AiPlanner& planner)
+            : car(x, y), planner(planner), startX(x), acceleration(acceleration) {}
+
+        Car car;
+        AiPlanner planner;
+        int startX;                        // Column on the start line
+        float acceleration;                // Speed gained per second
+        int collisions = 0;                // Obstacles hit this race
+        std::vector<uint8_t> hitObstacle;  // Obstacle slots already counted against this car
+        std::vector<int> nearby;           // Query scratch space
+        std::vector<int> reveal;           // Obstacles this car revealed during the current step
+    };
+
+    // Acceleration of an AI car, drawn from the seed and its index
+    static float aiAcceleration(unsigned seed, int index);
+
+    // One step of a human-driven car: held controls as rates, then the move
+    static void driveWithControls(Car& car, const PlayerInput& controls, float deltaTime);
+
+    // Run work on every AI car, in chunks spread over the job system, or
+    // in place without one
+    template <typename Work>
+    void runForAiCars(TaskGroup& group, const char* name, const Work& work) {
+        if (!jobs) {
+            for (AiDriver& driver : aiDrivers) {
+                work(driver);
+            }
+            return;
+        }
+        int count = static_cast<int>(aiDrivers.size());
+        int chunks = static_cast<int>(jobs->workerCount() + 1) * 4;
+        int grain = std::max(1, (count + chunks - 1) / chunks);
+        for (int first = 0; first < count; first += grain) {
+            int last = std::min(count, first + grain);
+            jobs->run(group, name, [this, &work, first, last]() {
+                for (int i = first; i < last; ++i) {
+                    work(aiDrivers[i]);
+                }
+            });
+        }
+    }
+
+    // Stream track chunks around the cars of each road
+    void updateTrack();
+
+    // Copy the world into the back snapshot and publish it
+    void publishSnapshot();
+
+    // Fork a task on the job system, or run it right away without one; only
+    // the job system wraps it in a JobSystem::Task, so inline steps do not allocate
+    template <typename Task>
+    void runTask(TaskGroup& group, const char* name, Task&& task) {
+        if (jobs) {
+            jobs->run(group, name, std::forward<Task>(task));
+        } else {
+            task();
+        }
+    }
+    void waitTasks(TaskGroup& group);
+
+    unsigned seed;
+    JobSystem* jobs;
+    int raceLength;
+
+    GameState gameState = GameState::STARTED;
+    RaceWinner winner = RaceWinner::None;
+    bool playerHit = false;
+    int aiCollisions = 0;
+    float raceTime = 0.0f;
+    PlayerInput heldControls;  // Applied continuously by every step
+    PlayerInput tappedControls; // Added to heldControls by the next step only, then cleared
+    bool headToHead = false;
+    PlayerInput rivalControls; // Held by the second player in head-to-head
+
+    std::unique_ptr<Car> car1; // Player's car
+    std::vector<AiDriver> aiDrivers; // The AI cars, each steered by its own planner
+
+    int car1_initial_x = 380;
+    int car1_initial_y = 550;
+    int car2_initial_x = 580;
+    int car2_initial_y = 550;
+
+    ObstacleField obstacles; // Obstacle positions, extents and flags as structure-of-arrays
+    Track track;             // Decides which road the obstacle slots currently hold
+    std::vector<int> recycledSlots;  // Slots the track moved during the last update
+
+    TripleBuffer<WorldSnapshot> snapshots; // Hand-over of the world to readers
+    uint64_t tick = 0;
+
+    // Per-task query results, kept to avoid allocating every step
+    std::vector<int> playerNearby;
+};
+
+#endif // SIMULATION_H
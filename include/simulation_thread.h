@@ -0,0 +1,123 @@
+#ifndef SIMULATION_THREAD_H
+#define SIMULATION_THREAD_H
+
+#include "draw_list.h"
+#include "replay.h"
+#include "rollback_session.h"
+#include "simulation.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+// Runs a Simulation on its own thread in fixed steps of 1 / tickRate seconds.
+// The main thread posts commands (race controls, player input) and takes the
+// newest recorded DrawList each frame; both directions go through bounded
+// lock-free queues, so a slow present never delays a step and a slow step
+// never blocks the window.
+class SimulationThread {
+public:
+    // Constructor: nothing runs until start()
+    SimulationThread(Simulation& simulation, int tickRate, int maxCatchUpSteps);
+
+    // Destructor: stops and joins the thread
+    ~SimulationThread();
+
+    SimulationThread(const SimulationThread&) = delete;
+    SimulationThread& operator=(const SimulationThread&) = delete;
+
+    // Log every applied command and step to recorder; call before start()
+    void setRecorder(ReplayRecorder* recorder) { this->recorder = recorder; }
+
+    // Play a recording instead of taking commands, speed times faster than
+    // real time; posted commands then only pause (Toggle) or quit. Call before start().
+    void setReplay(ReplayPlayer* player, float speed);
+
+    // Race a remote player: every step goes through session, which starts
+    // the race once the peer answers. Posted controls become the local
+    // player's and only Quit is honored otherwise. Call before start().
+    void setNetplay(RollbackSession* session) { netplay = session; }
+
+    // Spawn the thread
+    void start();
+
+    // Stop the loop (without quitting the simulation) and join the thread
+    void stop();
+
+    // Main thread: queue a command; false (and dropped) when the queue is full
+    bool post(const SimulationCommand& command);
+    bool post(SimulationCommandType type);
+
+    // Render thread: the newest recorded list, or null before the first one.
+    // Stays valid until the next call; older lists are released.
+    const DrawList* acquireDrawList();
+
+    // Statistics, readable from any thread
+    uint64_t getTicks() const { return ticks.load(std::memory_order_relaxed); }
+    uint64_t getDroppedLists() const { return droppedLists.load(std::memory_order_relaxed); }
+    bool hasQuit() const { return quit.load(std::memory_order_acquire); }
+
+    // Record the draw commands of one world state into list (cleared first),
+    // leaving the step timing to the caller. Until the background has zoomed
+    // to MAX_SCALE it is one stretched picture; from then on it is the tiled
+    // road scrolling with the camera, whose first row starts at roadOriginY.
+    // In a head-to-head race localPlayer 1 puts the camera and "You" on the rival's car.
+    static void recordWorld(const WorldSnapshot& world, float previousBackgroundScale,
+                            float backgroundScale, float roadOriginY, DrawList& list, int localPlayer = 0);
+
+    // Background zoom: grows at SCALE_RATE per second of racing, up to MAX_SCALE,
+    // where the picture gives way to BackgroundTiles built at that scale
+    static constexpr float SCALE_RATE = 1.2f;
+    static constexpr float MAX_SCALE = 5.2f;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    void loop();
+
+    // Apply queued commands; true if any changed what is drawn
+    bool applyCommands();
+
+    // Record the latest snapshot into the next free list; false when the
+    // renderer has fallen behind and every list is still queued
+    bool record();
+
+    // Add the netplay status line to list
+    void recordNetplayStatus(DrawList& list) const;
+
+    // The car the camera follows
+    const Car& viewedCar() const;
+
+    Simulation& simulation;
+    const double stepSeconds;
+    const int maxCatchUpSteps;
+
+    std::thread thread;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> quit{false};
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> droppedLists{0};
+
+    ReplayRecorder* recorder = nullptr;
+    ReplayPlayer* replay = nullptr;
+    float replaySpeed = 1.0f;
+    bool replayPaused = false;
+    RollbackSession* netplay = nullptr;
+
+    SpscQueue<SimulationCommand, 64> commands;
+    SpscQueue<DrawList, 4> drawLists;
+
+    // Presentation state advanced with the simulation, only touched by the thread
+    float backgroundScale = 1.0f;
+    float previousBackgroundScale = 1.0f;
+    float roadOriginY = 0.0f;  // Camera y when the zoom finished, so the road starts where the picture left off
+    bool scaling = false;
+    Clock::time_point lastStepTime;
+
+    // Key presses applied, and of those the newest a step has acted on (or
+    // all of them while the race is not running, when no step will)
+    uint32_t appliedInputSequence = 0;
+    uint32_t shownInputSequence = 0;
+};
+
+#endif // SIMULATION_THREAD_H
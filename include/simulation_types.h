@@ -0,0 +1,89 @@
+#ifndef SIMULATION_TYPES_H
+#define SIMULATION_TYPES_H
+
+#include <cstdint>
+
+// Enum representing the different states of the game
+enum class GameState {
+    STARTED,
+    STOPPED,
+    PAUSED,
+    RESET,
+    RUNNING,
+    QUIT,
+    GAMEOVER
+};
+
+// Enum representing directions to avoid obstacles
+enum class AvoidDirection { None, Left, Right };
+
+// Who won the race, once it is over
+enum class RaceWinner { None, Player, AI };
+
+// Player controls: one press each for an Input command, or the keys held
+// down for a Controls command
+struct PlayerInput {
+    bool accelerate = false;
+    bool decelerate = false;
+    bool steerLeft = false;
+    bool steerRight = false;
+};
+
+// Controls held in either
+inline PlayerInput combineControls(const PlayerInput& a, const PlayerInput& b) {
+    PlayerInput both;
+    both.accelerate = a.accelerate || b.accelerate;
+    both.decelerate = a.decelerate || b.decelerate;
+    both.steerLeft = a.steerLeft || b.steerLeft;
+    both.steerRight = a.steerRight || b.steerRight;
+    return both;
+}
+
+// Race controls and player input, as posted to the simulation thread and
+// stored in replays. Toggle starts a stopped race and stops a running one.
+// Input applies one step per control; Controls replaces the held controls,
+// which every step applies as continuous rates. Its taps are held for the
+// next step even when a later Controls has released them.
+enum class SimulationCommandType { Start, Stop, Toggle, Reset, Quit, Input, Controls };
+
+struct SimulationCommand {
+    SimulationCommandType type = SimulationCommandType::Input;
+    PlayerInput input;  // Input and Controls only
+    PlayerInput tapped; // Controls only: keys pressed since the previous Controls
+
+    // Frontend numbering of key presses, so the frame that first shows one can
+    // be matched to it; 0 for none. Not part of the simulation or replays.
+    uint32_t inputSequence = 0;
+};
+
+// Search counters of the AI planner
+struct PlannerStats {
+    uint64_t plans = 0;        // Searches run
+    uint64_t reuses = 0;       // Steps that followed an existing plan
+    uint64_t totalNodes = 0;   // Lattice nodes expanded by every search
+    int lastNodes = 0;         // Nodes expanded by the last search
+    int lastLayers = 0;        // Time layers the last search looked ahead
+    double lastMicros = 0.0;   // Wall time of the last search
+    double maxMicros = 0.0;
+    double totalMicros = 0.0;
+};
+
+// Netplay counters of a RollbackSession since it connected
+struct RollbackStats {
+    uint64_t frames = 0;             // Frames simulated forward
+    uint64_t rollbacks = 0;          // Mispredicted remote inputs corrected
+    uint64_t resimulatedFrames = 0;  // Frames simulated again by those corrections
+    uint64_t stalls = 0;             // Ticks spent waiting, too far ahead of the remote inputs
+    uint64_t syncWaits = 0;          // Ticks skipped to let a peer running behind catch up
+    uint64_t checksums = 0;          // Confirmed frames whose state both peers compared
+    uint64_t desyncs = 0;            // Of those, frames where the states differed
+    int lastRollbackFrames = 0;
+    int maxRollbackFrames = 0;
+    double lastResimMicros = 0.0;    // Wall time of the last correction, restore included
+    double maxResimMicros = 0.0;
+    double totalResimMicros = 0.0;
+    int roundTripFrames = 0;         // Measured in frames; half is how far the remote inputs lag
+    int frameAdvantage = 0;          // How many frames this peer runs ahead of the other
+};
+
+#endif // SIMULATION_TYPES_H
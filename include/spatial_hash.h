@@ -0,0 +1,76 @@
+#ifndef SPATIAL_HASH_H
+#define SPATIAL_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid broadphase: world space is cut into square cells and each
+// cell lists the ids of the boxes touching it. Queries only visit the cells
+// under the query area, so their cost follows the number of nearby boxes.
+// Const queries may run concurrently; updates need exclusive access.
+// Emptied cells are kept aside with their capacity and re-keyed for the next
+// new cell; with reserveFor() called for every box, moving boxes around
+// does not allocate.
+class SpatialHash {
+public:
+    // Constructor: cellSize should be about the size of the stored boxes
+    explicit SpatialHash(int cellSize = 64);
+
+    // Add a box
+    void insert(int id, int x, int y, int width, int height);
+
+    // Set aside spare cells for the most cells a box of this size can
+    // cover, so that it can later move anywhere without allocating
+    void reserveFor(int width, int height);
+
+    // Remove a box, given the bounds it was inserted with
+    void remove(int id, int x, int y, int width, int height);
+
+    // Move a box; only the cells it leaves or enters are touched
+    void update(int id, int oldX, int oldY, int newX, int newY, int width, int height);
+
+    // Remove everything
+    void clear();
+
+    // Append to out the ids of boxes in cells touched by the query box, each once.
+    // These are candidates; callers still run their exact test.
+    void query(int x, int y, int width, int height, std::vector<int>& out) const;
+
+    int getCellSize() const { return cellSize; }
+
+private:
+    // A box listed in a cell, with the first cell it covers for de-duplication
+    struct Entry {
+        int id;
+        int firstCellX, firstCellY;
+    };
+
+    struct CellRange {
+        int minX, minY, maxX, maxY;
+    };
+
+    using CellMap = std::unordered_map<uint64_t, std::vector<Entry>>;
+
+    static const size_t SPARE_ENTRIES = 4;  // Boxes a reserved cell holds before it grows
+
+    CellRange cellsOf(int x, int y, int width, int height) const;
+    int cellCoordinate(int value) const;
+    static uint64_t key(int cellX, int cellY);
+    void removeFromCell(int cellX, int cellY, int id);
+
+    // Entries of a cell, made from a spare cell if it is new and one is left
+    std::vector<Entry>& cellAt(uint64_t cellKey);
+
+    // Take an empty cell out of the map and keep it as a spare
+    void retire(CellMap::iterator cell);
+
+    int cellSize;
+    CellMap cells;
+    std::vector<CellMap::node_type> spareCells;
+    size_t reservedCells = 0;  // Cells asked for by reserveFor() since the last clear()
+    size_t ownedCells = 0;     // Cells made so far, live or spare
+};
+
+#endif // SPATIAL_HASH_H
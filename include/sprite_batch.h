@@ -0,0 +1,88 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <SDL.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#if !SDL_VERSION_ATLEAST(2, 0, 18)
+#error "SpriteBatch needs SDL 2.0.18 or newer for SDL_RenderGeometry"
+#endif
+
+// Collects the textured quads of a frame and submits them sorted by layer and
+// texture, with one SDL_RenderGeometry call per run of quads that share both.
+// Lower layers are drawn first; within a layer quads are grouped by texture,
+// so quads on the same layer should not rely on overlapping each other.
+class SpriteBatch {
+public:
+    // Draw order of the scene, back to front
+    enum Layer {
+        LAYER_BACKGROUND = 0,
+        LAYER_TRACK = 1,
+        LAYER_PARTICLES = 2,  // Exhaust, dust and debris, below the cars
+        LAYER_CARS = 3,
+        LAYER_HUD = 4,        // Cached HUD panels
+        LAYER_OVERLAY = 5,    // Debug panels above the scene
+    };
+
+    // Counters of one flushed frame
+    struct FrameStats {
+        int sprites = 0;
+        int drawCalls = 0;
+        int vertices = 0;
+    };
+
+    // Constructor: quads are submitted to this renderer
+    explicit SpriteBatch(SDL_Renderer* renderer);
+
+    SpriteBatch(const SpriteBatch&) = delete;
+    SpriteBatch& operator=(const SpriteBatch&) = delete;
+
+    // Queue a quad. source is a pixel rectangle of the texture, or null for all
+    // of it; a null texture draws a solid quad in the given color.
+    void draw(SDL_Texture* texture, const SDL_Rect* source, const SDL_FRect& destination, int layer,
+              SDL_Color color = {255, 255, 255, 255});
+
+    // Queue quadCount ready-made quads, four vertices each in the order
+    // top-left, top-right, bottom-right, bottom-left, submitted together in
+    // one draw call. The vertices are not copied and must stay valid until flush().
+    void drawQuads(SDL_Texture* texture, const SDL_Vertex* quadVertices, int quadCount, int layer);
+
+    // Drop what is known about a texture before it is destroyed, since a new
+    // texture may later be created at the same address
+    void forgetTexture(SDL_Texture* texture);
+
+    // Sort and submit every queued quad, then start a new frame
+    void flush();
+
+    // Counters of the most recent flush
+    const FrameStats& getStats() const { return stats; }
+
+private:
+    struct Sprite {
+        int layer;
+        SDL_Texture* texture;
+        uint32_t order;  // Submission order, keeps the sort deterministic
+        SDL_FRect destination;
+        float u0, v0, u1, v1;
+        SDL_Color color;
+        const SDL_Vertex* quadVertices;  // Set by drawQuads, which fills no other field but the first three
+        int quadCount;
+    };
+
+    // Size of a texture, looked up once per texture
+    std::pair<int, int> textureSize(SDL_Texture* texture);
+
+    SDL_Renderer* renderer;
+    FrameStats stats;
+
+    // Reused between frames so steady-state drawing never allocates
+    std::vector<Sprite> sprites;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+    std::vector<int> quadIndices;  // For drawQuads, grown to the largest batch seen
+    std::vector<std::pair<SDL_Texture*, std::pair<int, int>>> textureSizes;
+};
+
+#endif // SPRITE_BATCH_H
@@ -0,0 +1,69 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue between exactly one producer and one consumer
+// thread. Elements live in a fixed ring and are filled and read in place, so
+// element types that own buffers (vectors, strings) stop allocating once their
+// capacity settles.
+template <typename T, size_t Capacity>
+class SpscQueue {
+public:
+    SpscQueue() = default;
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer: the next free slot to fill, or null when the queue is full
+    T* beginPush() {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        if (tail - headIndex.load(std::memory_order_acquire) == Capacity) {
+            return nullptr;
+        }
+        return &slots[tail % Capacity];
+    }
+
+    // Producer: hand the slot from beginPush() to the consumer
+    void commitPush() {
+        tailIndex.store(tailIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Producer: copy a value in; false when the queue is full
+    bool push(const T& value) {
+        T* slot = beginPush();
+        if (!slot) return false;
+        *slot = value;
+        commitPush();
+        return true;
+    }
+
+    // Consumer: the oldest element, or null when the queue is empty
+    T* front() {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        if (head == tailIndex.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        return &slots[head % Capacity];
+    }
+
+    // Consumer: release the element returned by front()
+    void pop() {
+        headIndex.store(headIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // Either side: elements currently queued (a snapshot)
+    size_t size() const {
+        return tailIndex.load(std::memory_order_acquire) - headIndex.load(std::memory_order_acquire);
+    }
+
+private:
+    std::array<T, Capacity> slots;
+
+    // Monotonic counters, on separate cache lines so the two threads do not share one
+    alignas(64) std::atomic<size_t> headIndex{0};
+    alignas(64) std::atomic<size_t> tailIndex{0};
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,110 @@
+#ifndef STATE_BUFFER_H
+#define STATE_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+// Little-endian byte stream used for simulation keyframes and replay files,
+// so recordings read back the same on any machine
+
+// Appends values to a byte vector
+class StateWriter {
+public:
+    explicit StateWriter(std::vector<uint8_t>& bytes) : bytes(bytes) {}
+
+    void u8(uint8_t value) { bytes.push_back(value); }
+
+    void u32(uint32_t value) {
+        for (int i = 0; i < 4; ++i) bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void i32(int32_t value) { u32(static_cast<uint32_t>(value)); }
+
+    void f32(float value) {
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        u32(bits);
+    }
+
+    // 7 bits per byte, small values in one byte
+    void varint(uint64_t value) {
+        while (value >= 0x80) {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    void raw(const uint8_t* data, size_t size) { bytes.insert(bytes.end(), data, data + size); }
+
+private:
+    std::vector<uint8_t>& bytes;
+};
+
+// Reads values back; past the end every read returns 0 and ok() turns false
+class StateReader {
+public:
+    StateReader(const uint8_t* data, size_t size) : data(data), size(size) {}
+
+    bool ok() const { return !failed; }
+    bool atEnd() const { return position >= size; }
+    size_t getPosition() const { return position; }
+
+    uint8_t u8() {
+        if (!need(1)) return 0;
+        return data[position++];
+    }
+
+    uint32_t u32() {
+        if (!need(4)) return 0;
+        uint32_t value = 0;
+        for (int i = 0; i < 4; ++i) value |= static_cast<uint32_t>(data[position++]) << (8 * i);
+        return value;
+    }
+
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+
+    float f32() {
+        uint32_t bits = u32();
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    uint64_t varint() {
+        uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            uint8_t byte = u8();
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80) || failed) return value;
+        }
+        failed = true;
+        return 0;
+    }
+
+    // Pointer to the next size bytes, skipping them; null past the end
+    const uint8_t* raw(size_t count) {
+        if (!need(count)) return nullptr;
+        const uint8_t* start = data + position;
+        position += count;
+        return start;
+    }
+
+private:
+    bool need(size_t count) {
+        if (failed || size - position < count) {
+            failed = true;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+    bool failed = false;
+};
+
+#endif // STATE_BUFFER_H
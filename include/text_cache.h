@@ -0,0 +1,95 @@
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include "asset_pack.h"
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Rasterizes every printable ASCII glyph of each (font, size) pair once into a
+// shared atlas texture, then draws strings as batched quads from that atlas.
+class TextCache {
+public:
+    // Constructor: the atlas texture is created on this renderer
+    explicit TextCache(SDL_Renderer* renderer);
+
+    // Destructor: closes the fonts owned by the cache
+    ~TextCache();
+
+    TextCache(const TextCache&) = delete;
+    TextCache& operator=(const TextCache&) = delete;
+
+    static const int FIRST_GLYPH = 32;
+    static const int LAST_GLYPH = 126;
+
+    struct Glyph {
+        SDL_Rect source;  // Location of the glyph inside the atlas
+        int advance;
+    };
+
+    // A font with its glyphs rasterized, not yet part of the atlas
+    struct Font {
+        std::string path;
+        int pointSize;
+        std::shared_ptr<TTF_Font> handle;
+        int height;
+        std::array<Glyph, LAST_GLYPH - FIRST_GLYPH + 1> glyphs;
+        std::vector<std::shared_ptr<SDL_Surface>> surfaces; // Glyph bitmaps, kept so the atlas can be rebuilt when a font is added
+    };
+
+    // Open a font at the given point size and rasterize its glyphs.
+    // Loading the same (path, size) twice returns the same id; -1 on failure.
+    int loadFont(const std::string& path, int pointSize);
+
+    // Open and rasterize a font without touching the renderer, so it can run
+    // on a loader thread; SDL_ttf calls must still be serialized by the caller
+    static bool rasterizeFont(const std::string& path, int pointSize, Font& font);
+
+    // Add a font rasterized by rasterizeFont; returns its id
+    int addFont(Font font);
+
+    // Add a font baked by evador_pack whose glyphs live in packedAtlas (width x height).
+    // The cache then draws from that atlas and no longer accepts rasterized fonts.
+    int addPackedFont(const std::string& path, const PackedFont& packed,
+                      std::shared_ptr<SDL_Texture> packedAtlas, int width, int height);
+
+    // Id of an already added (path, size) pair, or -1
+    int findFont(const std::string& path, int pointSize) const;
+
+    // Queue a string for drawing with its top-left corner at (x, y)
+    void drawText(int fontId, int x, int y, const char* text, SDL_Color color);
+
+    // Width in pixels of the string when drawn with the given font
+    int measureText(int fontId, const char* text) const;
+
+    // Height in pixels of one line of the given font
+    int lineHeight(int fontId) const;
+
+    // Submit every queued quad in a single draw call
+    void flush();
+
+private:
+    static const int ATLAS_WIDTH = 512;
+
+    // Pack every font's glyphs into one surface and upload it as the atlas
+    bool buildAtlas();
+
+    const Glyph* findGlyph(const Font& font, char c) const;
+
+    SDL_Renderer* renderer;
+    std::shared_ptr<SDL_Texture> atlas;
+    int atlasWidth = ATLAS_WIDTH;
+    int atlasHeight = 0;
+    bool atlasDirty = false;
+    bool externalAtlas = false;  // Glyphs come from a prebuilt atlas that is never rebuilt
+    std::vector<Font> fonts;
+
+    // Reused between frames so steady-state drawing never allocates
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+};
+
+#endif // TEXT_CACHE_H
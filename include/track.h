@@ -0,0 +1,129 @@
+#ifndef TRACK_H
+#define TRACK_H
+
+#include "job_system.h"
+#include "obstacle_field.h"
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class StateWriter;
+class StateReader;
+
+// One generated strip of a road: where its obstacles go
+struct TrackChunk {
+    static const int OBSTACLES = 3;
+
+    int road = 0;
+    int index = -1;  // 0 is the chunk at the start line, then counting up the road
+    std::array<int, OBSTACLES> xs{};
+    std::array<int, OBSTACLES> ys{};
+};
+
+// Small counter-based random bit generator (SplitMix64). Unlike seeding a
+// std::mt19937 through std::seed_seq it never allocates, for callers that
+// lay out track on a hot path.
+struct SplitMix64 {
+    using result_type = uint64_t;
+    uint64_t state;
+
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT64_MAX; }
+    result_type operator()() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+};
+
+// Seeded, endless obstacle track streamed in chunks. Every road keeps a
+// fixed-size ring of chunks whose obstacles occupy fixed slots of the
+// ObstacleField: chunks the trailing car has left behind are recycled for
+// new road ahead of the leading car, so memory stays constant however long
+// the race runs. The next chunk of each road is generated on the job system
+// while the current one is in use.
+class Track {
+public:
+    static const int ROAD_COUNT = 2;
+    static const int RING_CAPACITY = 6;     // Live chunks per road
+    static const int CHUNK_LENGTH = 600;    // World pixels covered by one chunk
+    static const int ORIGIN_Y = 500;        // Bottom edge of chunk 0
+    static const int LOOKAHEAD = 2 * CHUNK_LENGTH; // Road kept generated ahead of the leading car
+    static const int RECYCLE_MARGIN = 150;  // How far behind the trailing car a chunk must be to recycle it
+
+    // Constructor: without a job system chunks are generated inline
+    Track(unsigned seed, JobSystem* jobs = nullptr);
+
+    // Destructor: waits for chunks still being generated
+    ~Track();
+
+    Track(const Track&) = delete;
+    Track& operator=(const Track&) = delete;
+
+    // Reserve the obstacle slots of every road at the end of the field and
+    // get ready to lay the first chunks
+    void init(ObstacleField& field, int obstacleWidth, int obstacleHeight);
+
+    // Clear the road and start over from chunk 0
+    void reset(ObstacleField& field);
+
+    // Lay another seed's track from the next reset() on
+    void reseed(unsigned newSeed);
+
+    // Stream one road: recycle chunks behind trailingY, install chunks up to
+    // LOOKAHEAD beyond leadingY. Indices of re-used obstacle slots are appended to recycled.
+    void update(ObstacleField& field, int road, int leadingY, int trailingY, std::vector<int>& recycled);
+
+    // Write or restore the streaming state, for keyframes; the obstacle
+    // positions themselves are saved with the field
+    void saveState(StateWriter& writer) const;
+    bool loadState(StateReader& reader);
+
+    // Deterministic contents of one chunk; depends only on the arguments
+    static TrackChunk generateChunk(unsigned seed, int road, int index);
+
+    // The layout rules behind generateChunk, drawing from any random bit
+    // generator (instantiated for std::mt19937 and SplitMix64)
+    template <typename Random>
+    static TrackChunk layoutChunk(int road, int index, Random& random);
+
+    // Range of obstacle x positions on a road
+    static int roadMinX(int road);
+    static int roadMaxX(int road);
+
+    // World y range [top, bottom) covered by a chunk
+    static int chunkTop(int index) { return ORIGIN_Y - (index + 1) * CHUNK_LENGTH; }
+    static int chunkBottom(int index) { return ORIGIN_Y - index * CHUNK_LENGTH; }
+
+    // Total chunks installed so far, including recycled ones
+    int getChunksGenerated() const { return chunksGenerated; }
+
+private:
+    // Streaming state of one road
+    struct RoadStream {
+        std::array<int, RING_CAPACITY> ring{};      // Chunk index held by each ring position, -1 when free
+        int nextChunk = 0;                          // Next chunk index to install
+        TrackChunk prefetched;                      // Chunk generated ahead of time
+        TaskGroup prefetchGroup{"track.prefetch"};  // Reused by every prefetch of the road
+        bool pending = false;                       // Set while the prefetch is running
+    };
+
+    // Take chunk `index` of a road, from the prefetch when it is ready
+    TrackChunk takeChunk(int road, int index);
+    void prefetch(int road, int index);
+
+    // Wait for the road's prefetch, if one is running
+    void waitPrefetch(RoadStream& stream);
+    void install(ObstacleField& field, int road, int position, const TrackChunk& chunk, std::vector<int>& recycled);
+    size_t slotOf(int road, int position, int obstacle) const;
+
+    unsigned seed;
+    JobSystem* jobs;
+    std::array<RoadStream, ROAD_COUNT> roads;
+    size_t firstSlot = 0;  // Field index of the first track obstacle
+    int chunksGenerated = 0;
+};
+
+#endif // TRACK_H
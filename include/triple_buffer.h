@@ -0,0 +1,51 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free hand-over of the latest value from one writer thread to one
+// reader thread. The writer fills back() and publish()es it with a single
+// atomic exchange; the reader's acquire() swaps in the newest published value
+// the same way. Neither side ever waits, and the reader always sees a value
+// that was completely written. Values are reused, so a T holding vectors stops
+// allocating once their capacity settles.
+template <typename T>
+class TripleBuffer {
+public:
+    TripleBuffer() = default;
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    // Writer: the value being prepared
+    T& back() { return buffers[backIndex]; }
+
+    // Writer: make back() the latest value and start on another one
+    void publish() {
+        uint8_t previous = middle.exchange(static_cast<uint8_t>(backIndex | FRESH), std::memory_order_acq_rel);
+        backIndex = previous & INDEX_MASK;
+    }
+
+    // Reader: the latest published value, valid until the next acquire()
+    const T& acquire() {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            uint8_t previous = middle.exchange(frontIndex, std::memory_order_acq_rel);
+            frontIndex = previous & INDEX_MASK;
+        }
+        return buffers[frontIndex];
+    }
+
+    // Reader: whether something was published since the last acquire()
+    bool hasNew() const { return (middle.load(std::memory_order_relaxed) & FRESH) != 0; }
+
+private:
+    static const uint8_t INDEX_MASK = 0x3;
+    static const uint8_t FRESH = 0x4;  // Set in middle when it holds an unread value
+
+    T buffers[3];
+    uint8_t backIndex = 0;   // Only touched by the writer
+    uint8_t frontIndex = 1;  // Only touched by the reader
+    std::atomic<uint8_t> middle{2};
+};
+
+#endif // TRIPLE_BUFFER_H
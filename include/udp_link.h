@@ -0,0 +1,84 @@
+#ifndef UDP_LINK_H
+#define UDP_LINK_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+// Non-blocking UDP socket exchanging datagrams with one peer (IPv4), for
+// netplay. Outgoing datagrams can be held back for a simulated delay, and a
+// share of them dropped, so rollback can be exercised over loopback. After
+// open() neither sending nor receiving blocks or allocates.
+class UdpLink {
+public:
+    static const size_t MAX_DATAGRAM = 512;
+    static const size_t DELAY_QUEUE = 256;  // Datagrams held back at most; more are dropped
+
+    // Traffic since open()
+    struct Stats {
+        uint64_t sent = 0;
+        uint64_t received = 0;
+        uint64_t dropped = 0;  // Simulated loss, or the delay queue was full
+        uint64_t bytesSent = 0;
+        uint64_t bytesReceived = 0;
+    };
+
+    UdpLink();
+    ~UdpLink();
+
+    UdpLink(const UdpLink&) = delete;
+    UdpLink& operator=(const UdpLink&) = delete;
+
+    // Bind localPort on every interface and talk to peerHost:peerPort; false with `error` set on failure
+    bool open(int localPort, const std::string& peerHost, int peerPort, std::string& error);
+    void close();
+    bool isOpen() const { return socketHandle >= 0; }
+
+    // Hold every outgoing datagram this long before it is sent
+    void setSimulatedDelay(int millis);
+
+    // Drop this share of outgoing datagrams, decided by a seeded generator
+    void setSimulatedLoss(int percent, unsigned seed);
+
+    // Queue or send one datagram of at most MAX_DATAGRAM bytes; false when it was dropped
+    bool send(const uint8_t* data, size_t size);
+
+    // Send the held-back datagrams that are due
+    void flush();
+
+    // Next datagram from the peer copied into buffer: its size, or 0 when nothing is waiting.
+    // Datagrams from any other address are discarded.
+    size_t receive(uint8_t* buffer, size_t capacity);
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Delayed {
+        Clock::time_point due;
+        size_t size = 0;
+        uint8_t data[MAX_DATAGRAM];
+    };
+
+    bool sendNow(const uint8_t* data, size_t size);
+
+    int socketHandle = -1;
+    uint32_t peerAddress = 0;  // Network byte order
+    uint16_t peerPort = 0;     // Network byte order
+
+    Clock::duration delay{0};
+    int lossPercent = 0;
+    std::minstd_rand lossRandom;
+
+    std::vector<Delayed> delayed;  // Ring of DELAY_QUEUE entries
+    size_t delayedHead = 0;
+    size_t delayedCount = 0;
+
+    Stats stats;
+};
+
+#endif // UDP_LINK_H
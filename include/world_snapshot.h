@@ -0,0 +1,44 @@
+#ifndef WORLD_SNAPSHOT_H
+#define WORLD_SNAPSHOT_H
+
+#include "simulation_types.h"
+#include <cstdint>
+#include <vector>
+
+// What a reader needs of one car at the end of a step
+struct CarSnapshot {
+    float x = 0.0f, y = 0.0f;
+    float previousX = 0.0f, previousY = 0.0f;  // Position at the start of the step
+    float speed = 0.0f;
+    float distanceCovered = 0.0f;
+    int width = 0, height = 0;
+
+    // Position blended between the start (0) and end (1) of the step
+    float interpolatedX(float alpha) const { return previousX + (x - previousX) * alpha; }
+    float interpolatedY(float alpha) const { return previousY + (y - previousY) * alpha; }
+};
+
+// A visible obstacle
+struct ObstacleSnapshot {
+    int x, y, width, height;
+    int road;
+};
+
+// The whole world after one simulation step, published as a unit so the
+// renderer and HUD never see half of one step and half of the next
+struct WorldSnapshot {
+    uint64_t tick = 0;  // Steps simulated since the start
+    GameState state = GameState::STARTED;
+    RaceWinner winner = RaceWinner::None;
+    bool playerCollided = false;
+    int aiCollisions = 0;
+    float raceTime = 0.0f;
+    bool headToHead = false;  // The AI car is a second player's
+    int finishLineY = 0;
+
+    CarSnapshot player;
+    std::vector<CarSnapshot> aiCars;
+    std::vector<ObstacleSnapshot> obstacles;  // Only the visible ones
+};
+
+#endif // WORLD_SNAPSHOT_H
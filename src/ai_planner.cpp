@@ -0,0 +1,270 @@
+#include "ai_planner.h"
+#include "state_buffer.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+
+// Bound to references by std::min, so they need a definition
+const int AiPlanner::MAX_LAYERS;
+const int AiPlanner::MAX_LANES;
+
+namespace {
+// Obstacles further than this from the car cannot matter within MAX_LAYERS
+const int QUERY_RADIUS = 400;
+}
+
+// Constructor
+AiPlanner::AiPlanner(int originX, int minX, int maxX) {
+    // Lanes sit on the grid of positions the car can reach from where it starts
+    int below = (originX - minX) / LANE_WIDTH;
+    firstLaneX = originX - below * LANE_WIDTH;
+    laneCount = std::min(MAX_LANES, std::max(1, (maxX - firstLaneX) / LANE_WIDTH + 1));
+    setBudgetMicros(DEFAULT_BUDGET_MICROS);
+    cost.resize(static_cast<size_t>(MAX_LAYERS + 1) * laneCount);
+    choice.resize(cost.size());
+    hit.resize(cost.size());
+    layerTops.resize(MAX_LAYERS + 1);
+}
+
+// Convert the time budget into lattice nodes
+void AiPlanner::setBudgetMicros(int micros) {
+    budgetMicros = std::max(0, micros);
+    nodeBudget = static_cast<int>(std::min<long long>(INT_MAX, budgetMicros * 1000LL / NODE_COST_NANOS));
+}
+
+// Forget the plan
+void AiPlanner::reset() {
+    lanes.clear();
+    planned.clear();
+    stepsFollowed = 0;
+}
+
+// Nearest lane to an x position
+int AiPlanner::laneOf(int x) const {
+    int lane = (x - firstLaneX + LANE_WIDTH / 2) / LANE_WIDTH;
+    if (x < firstLaneX) {
+        lane = 0;
+    }
+    return std::min(lane, laneCount - 1);
+}
+
+// Visible obstacles on the road that are not yet behind the car, in index order
+void AiPlanner::collectObstacles(const ObstacleField& field, int road, int carX, int carY, int carHeight,
+                                 std::vector<int>& nearby) {
+    known.clear();
+    field.queryRange(carX, carY, QUERY_RADIUS, nearby);
+    for (int i : nearby) {
+        if (field.getRoad(i) != road || !field.isVisible(i) || field.getY(i) >= carY + carHeight) {
+            continue;
+        }
+        known.push_back({field.getX(i), field.getY(i), field.getWidth(i), field.getHeight(i)});
+    }
+}
+
+// Valid while the car is on the plan, no new obstacle showed up and at least half of it is left
+bool AiPlanner::planValid(int carX) const {
+    if (lanes.empty()) {
+        return false;
+    }
+    int layers = static_cast<int>(lanes.size()) - 1;
+    int remaining = layers - stepsFollowed / STEPS_PER_LAYER;
+    if (remaining < std::max(2, layers / 2) || carX != expectedX) {
+        return false;
+    }
+    for (const KnownObstacle& obstacle : known) {
+        bool accounted = std::any_of(planned.begin(), planned.end(), [&](const KnownObstacle& other) {
+            return other.x == obstacle.x && other.y == obstacle.y &&
+                   other.width == obstacle.width && other.height == obstacle.height;
+        });
+        if (!accounted) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Backward dynamic programming over lanes x layers. A node is the car in a
+// lane at the end of a layer; moving to the next layer it may shift up to
+// MAX_LANE_SHIFT lanes (one lane per step, at the start of the layer), at
+// LANE_CHANGE_COST per lane, and costs COLLISION_COST if the box it sweeps
+// over the layer, across every lane it passes, overlaps a known obstacle.
+void AiPlanner::plan(int carX, int carY, int carWidth, int carHeight, float speed, float acceleration,
+                     float maxSpeed, float stepSeconds) {
+    auto node = [this](int layer, int lane) { return static_cast<size_t>(layer) * laneCount + lane; };
+
+    // Lay the layers one at a time: where the car will be at the end of each,
+    // stepped the way Simulation::step moves it, and which lanes overlap an
+    // obstacle while it covers that ground. A layer costs its nodes plus its
+    // overlap tests; the first one that no longer fits the budget is dropped.
+    float y = static_cast<float>(carY);
+    layerTops[0] = y;
+    int layers = 0;
+    int work = 0;
+    while (layers < MAX_LAYERS) {
+        int k = layers + 1;
+        for (int s = 0; s < STEPS_PER_LAYER; ++s) {
+            y -= speed * stepSeconds;
+            speed = std::min(speed + acceleration * stepSeconds, maxSpeed);
+        }
+        layerTops[k] = y;
+
+        int top = static_cast<int>(layerTops[k]) - 1;
+        int bottom = static_cast<int>(layerTops[k - 1]) + carHeight + 1;
+        int tests = static_cast<int>(known.size());
+        for (int j = 0; j < laneCount; ++j) {
+            hit[node(k, j)] = 0;
+        }
+        for (const KnownObstacle& obstacle : known) {
+            if (obstacle.y >= bottom || obstacle.y + obstacle.height <= top) {
+                continue;
+            }
+            tests += laneCount;
+            for (int j = 0; j < laneCount; ++j) {
+                int x = laneX(j);
+                if (obstacle.x < x + carWidth && obstacle.x + obstacle.width > x) {
+                    hit[node(k, j)] = 1;
+                }
+            }
+        }
+
+        int layerWork = laneCount + tests / OVERLAP_TESTS_PER_NODE;
+        if (k > 2 && work + layerWork > nodeBudget) {
+            break;
+        }
+        work += layerWork;
+        layers = k;
+    }
+
+    // Cheapest way from lane `lane` at the end of layer - 1 through layer
+    // `layer`; staying is preferred on ties, then the smaller shift
+    auto bestMove = [&](int layer, int lane, int& bestCost) {
+        int best = 0;
+        bestCost = INT_MAX;
+        for (int direction : {1, -1}) {
+            bool swept = false;
+            for (int shift = 0; shift <= MAX_LANE_SHIFT; ++shift) {
+                int next = lane + direction * shift;
+                if (next < 0 || next >= laneCount) {
+                    break;
+                }
+                swept = swept || hit[node(layer, next)];
+                if (shift == 0 && direction < 0) {
+                    continue; // Staying was costed going right
+                }
+                int total = cost[node(layer, next)] + (swept ? COLLISION_COST : 0) + shift * LANE_CHANGE_COST;
+                if (total < bestCost || (total == bestCost && shift < std::abs(best))) {
+                    bestCost = total;
+                    best = direction * shift;
+                }
+            }
+        }
+        return best;
+    };
+
+    // Cost to go, from the last layer back to the first
+    for (int j = 0; j < laneCount; ++j) {
+        cost[node(layers, j)] = 0;
+    }
+    for (int k = layers - 1; k >= 0; --k) {
+        for (int j = 0; j < laneCount; ++j) {
+            int total;
+            choice[node(k, j)] = static_cast<int8_t>(bestMove(k + 1, j, total));
+            cost[node(k, j)] = total;
+        }
+    }
+
+    // Walk the cheapest path from the car's lane
+    lanes.resize(layers + 1);
+    lanes[0] = static_cast<uint8_t>(laneOf(carX));
+    for (int k = 0; k < layers; ++k) {
+        lanes[k + 1] = static_cast<uint8_t>(lanes[k] + choice[node(k, lanes[k])]);
+    }
+    planned = known;
+    stepsFollowed = 0;
+    expectedX = carX;
+
+    stats.lastNodes = layers * laneCount;
+    stats.lastLayers = layers;
+    stats.totalNodes += stats.lastNodes;
+    stats.plans++;
+}
+
+// Replan when needed, then steer toward the plan's lane for the coming step
+AvoidDirection AiPlanner::update(const ObstacleField& field, int road, int carX, int carY, int carWidth, int carHeight,
+                                 float speed, float acceleration, float maxSpeed, float stepSeconds,
+                                 std::vector<int>& nearby) {
+    collectObstacles(field, road, carX, carY, carHeight, nearby);
+    if (planValid(carX)) {
+        stats.reuses++;
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        plan(carX, carY, carWidth, carHeight, speed, acceleration, maxSpeed, stepSeconds);
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        stats.lastMicros = micros;
+        stats.maxMicros = std::max(stats.maxMicros, micros);
+        stats.totalMicros += micros;
+    }
+
+    // One lane per step toward the lane of the coming layer
+    int target = laneX(lanes[stepsFollowed / STEPS_PER_LAYER + 1]);
+    stepsFollowed++;
+    if (carX < target) {
+        expectedX = carX + LANE_WIDTH;
+        return AvoidDirection::Right;
+    }
+    if (carX > target) {
+        expectedX = carX - LANE_WIDTH;
+        return AvoidDirection::Left;
+    }
+    expectedX = carX;
+    return AvoidDirection::None;
+}
+
+// Budget, plan and the obstacles it was made for
+void AiPlanner::saveState(StateWriter& writer) const {
+    writer.i32(budgetMicros);
+    writer.varint(lanes.size());
+    for (uint8_t lane : lanes) {
+        writer.u8(lane);
+    }
+    writer.varint(static_cast<uint64_t>(stepsFollowed));
+    writer.i32(expectedX);
+    writer.varint(planned.size());
+    for (const KnownObstacle& obstacle : planned) {
+        writer.i32(obstacle.x);
+        writer.i32(obstacle.y);
+        writer.i32(obstacle.width);
+        writer.i32(obstacle.height);
+    }
+}
+
+// Restore a keyframe; false if the plan does not fit this lattice
+bool AiPlanner::loadState(StateReader& reader) {
+    setBudgetMicros(reader.i32());
+    uint64_t laneEntries = reader.varint();
+    if (laneEntries > static_cast<uint64_t>(MAX_LAYERS) + 1) {
+        return false;
+    }
+    lanes.resize(static_cast<size_t>(laneEntries));
+    for (uint8_t& lane : lanes) {
+        lane = reader.u8();
+        if (lane >= laneCount) {
+            return false;
+        }
+    }
+    stepsFollowed = static_cast<int>(reader.varint());
+    expectedX = reader.i32();
+    uint64_t obstacleCount = reader.varint();
+    if (obstacleCount > 1024) {
+        return false;
+    }
+    planned.resize(static_cast<size_t>(obstacleCount));
+    for (KnownObstacle& obstacle : planned) {
+        obstacle.x = reader.i32();
+        obstacle.y = reader.i32();
+        obstacle.width = reader.i32();
+        obstacle.height = reader.i32();
+    }
+    return reader.ok();
+}
@@ -0,0 +1,324 @@
+#include "asset_manager.h"
+#include "profiler.h"
+#include "asset_pack_layout.h"
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+namespace {
+// SDL_ttf shares one FreeType library between all fonts, so fonts are opened one at a time
+std::mutex ttfMutex;
+
+double millisecondsBetween(std::chrono::steady_clock::time_point from, std::chrono::steady_clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+}
+
+// Constructor
+AssetManager::AssetManager(SDL_Renderer* renderer, TextCache* textCache, unsigned loaderThreads)
+    : renderer(renderer), textCache(textCache) {
+    char* executableDir = SDL_GetBasePath();
+    if (executableDir) {
+        basePath = executableDir;
+        SDL_free(executableDir);
+    }
+
+    if (loaderThreads == 0) {
+        loaderThreads = std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+    }
+    for (unsigned i = 0; i < loaderThreads; ++i) {
+        loaders.emplace_back(&AssetManager::loaderLoop, this);
+    }
+}
+
+// Destructor
+AssetManager::~AssetManager() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    queueReady.notify_all();
+    for (auto& loader : loaders) {
+        loader.join();
+    }
+}
+
+// Prefer the copy next to the executable, then the working directory
+std::string AssetManager::resolvePath(const std::string& relativePath) const {
+    if (!basePath.empty()) {
+        std::string candidate = basePath + relativePath;
+        if (FILE* file = std::fopen(candidate.c_str(), "rb")) {
+            std::fclose(file);
+            return candidate;
+        }
+    }
+    return relativePath;
+}
+
+// Serve the packed sprites and fonts from one mapped, GPU-ready atlas
+bool AssetManager::loadPack(const std::string& relativePath) {
+    Clock::time_point start = Clock::now();
+    if (!pack.open(resolvePath(relativePath))) {
+        return false;
+    }
+    if (pack.getAtlasWidth() != PackLayout::ATLAS_WIDTH || pack.getAtlasHeight() != PackLayout::ATLAS_HEIGHT
+        || pack.getFontCount() != static_cast<int>(sizeof(PackLayout::FONTS) / sizeof(PackLayout::FONTS[0]))) {
+        std::cerr << "Asset pack " << relativePath << " does not match the compiled layout; rebuild it" << std::endl;
+        pack.close();
+        return false;
+    }
+
+    // Straight from the mapping to the GPU, no decoding
+    SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC,
+                                             static_cast<int>(pack.getAtlasWidth()), static_cast<int>(pack.getAtlasHeight()));
+    if (!texture || SDL_UpdateTexture(texture, nullptr, pack.getAtlasPixels(), pack.getAtlasPitch()) != 0) {
+        std::cerr << "Asset pack upload failed: " << SDL_GetError() << std::endl;
+        if (texture) SDL_DestroyTexture(texture);
+        pack.close();
+        return false;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    std::shared_ptr<SDL_Texture> atlas(texture, SDL_DestroyTexture);
+
+    for (const PackedSprite& sprite : PackLayout::SPRITES) {
+        Asset& asset = addReady(AssetKind::Texture, sprite.key, 0);
+        asset.texture = atlas;
+        asset.source = {sprite.x, sprite.y, sprite.w, sprite.h};
+    }
+    for (int i = 0; i < pack.getFontCount(); ++i) {
+        const PackedFontKey& key = PackLayout::FONTS[i];
+        Asset& asset = addReady(AssetKind::Font, key.key, key.pointSize);
+        asset.fontId = textCache->addPackedFont(key.key, pack.getFont(i), atlas,
+                                                static_cast<int>(pack.getAtlasWidth()), static_cast<int>(pack.getAtlasHeight()));
+        asset.missing = asset.fontId < 0;
+    }
+
+    // Every pixel now lives on the GPU
+    pack.close();
+    packMilliseconds = millisecondsBetween(start, Clock::now());
+    return true;
+}
+
+// Record an asset that needs no loading
+AssetManager::Asset& AssetManager::addReady(AssetKind kind, const std::string& relativePath, int pointSize) {
+    auto asset = std::make_unique<Asset>();
+    asset->kind = kind;
+    asset->key = makeKey(kind, relativePath, pointSize);
+    asset->path = relativePath;
+    asset->pointSize = pointSize;
+    asset->state = AssetState::Ready;
+    asset->packed = true;
+    asset->requested = asset->decodeStarted = asset->decoded = asset->uploaded = Clock::now();
+    assets.push_back(std::move(asset));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finishedCount++;
+    return *assets.back();
+}
+
+// Fonts are keyed by path and size
+std::string AssetManager::makeKey(AssetKind kind, const std::string& relativePath, int pointSize) {
+    return kind == AssetKind::Font ? relativePath + "@" + std::to_string(pointSize) : relativePath;
+}
+
+// Queue a texture
+AssetHandle AssetManager::requestTexture(const std::string& relativePath) {
+    return request(AssetKind::Texture, relativePath, 0);
+}
+
+// Queue a font
+AssetHandle AssetManager::requestFont(const std::string& relativePath, int pointSize) {
+    return request(AssetKind::Font, relativePath, pointSize);
+}
+
+// Find an existing request for the same key or queue a new one
+AssetHandle AssetManager::request(AssetKind kind, const std::string& relativePath, int pointSize) {
+    std::string key = makeKey(kind, relativePath, pointSize);
+    for (size_t i = 0; i < assets.size(); ++i) {
+        if (assets[i]->kind == kind && assets[i]->key == key) {
+            return static_cast<AssetHandle>(i);
+        }
+    }
+
+    auto asset = std::make_unique<Asset>();
+    asset->kind = kind;
+    asset->key = key;
+    asset->path = resolvePath(relativePath);
+    asset->pointSize = pointSize;
+    asset->requested = Clock::now();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(asset.get());
+    }
+    assets.push_back(std::move(asset));
+    queueReady.notify_one();
+    return static_cast<AssetHandle>(assets.size() - 1);
+}
+
+// Take queued assets and decode them until the manager is destroyed
+void AssetManager::loaderLoop() {
+    PROFILE_THREAD("asset loader");
+    while (true) {
+        Asset* asset = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            queueReady.wait(lock, [this]() { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            asset = queue.front();
+            queue.pop_front();
+            asset->state = AssetState::Decoding;
+        }
+
+        asset->decodeStarted = Clock::now();
+        decode(*asset);
+        asset->decoded = Clock::now();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded.push_back(asset);
+    }
+}
+
+// The CPU side of a load: no renderer calls here
+void AssetManager::decode(Asset& asset) {
+    PROFILE_ZONE(asset.kind == AssetKind::Font ? "Decode font" : "Decode image");
+    if (asset.kind == AssetKind::Font) {
+        std::lock_guard<std::mutex> lock(ttfMutex);
+        asset.state = TextCache::rasterizeFont(asset.path, asset.pointSize, asset.font) ? AssetState::Decoded : AssetState::Failed;
+        return;
+    }
+
+    SDL_Surface* loaded = IMG_Load(asset.path.c_str());
+    if (!loaded) {
+        std::cerr << "Image Load Failed: " << asset.path << ": " << IMG_GetError() << std::endl;
+        asset.state = AssetState::Failed;
+        return;
+    }
+
+    // Convert here so creating the texture is a plain copy on the render thread
+    SDL_Surface* converted = SDL_ConvertSurfaceFormat(loaded, SDL_PIXELFORMAT_RGBA32, 0);
+    if (converted) {
+        SDL_FreeSurface(loaded);
+        loaded = converted;
+    }
+    asset.surface = std::shared_ptr<SDL_Surface>(loaded, SDL_FreeSurface);
+    asset.state = AssetState::Decoded;
+}
+
+// Upload everything the loaders finished since the last frame
+void AssetManager::uploadPending() {
+    PROFILE_ZONE("Upload assets");
+    std::vector<Asset*> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ready.swap(decoded);
+    }
+
+    for (Asset* asset : ready) {
+        if (asset->state == AssetState::Decoded) {
+            if (asset->kind == AssetKind::Texture) {
+                SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, asset->surface.get());
+                if (texture) {
+                    asset->texture = std::shared_ptr<SDL_Texture>(texture, SDL_DestroyTexture);
+                    asset->state = AssetState::Ready;
+                } else {
+                    std::cerr << "Texture upload failed: " << asset->path << ": " << SDL_GetError() << std::endl;
+                    asset->state = AssetState::Failed;
+                }
+                asset->surface.reset();
+            } else {
+                asset->fontId = textCache->addFont(std::move(asset->font));
+                asset->state = AssetState::Ready;
+            }
+        }
+        asset->missing = asset->state == AssetState::Failed;
+        asset->uploaded = Clock::now();
+    }
+
+    if (!ready.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        finishedCount += static_cast<int>(ready.size());
+    }
+}
+
+// Magenta square drawn in place of textures that failed to load
+SDL_Texture* AssetManager::placeholder() const {
+    if (!missingTexture) {
+        SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, 1, 1);
+        if (texture) {
+            const Uint8 magenta[4] = {0xFF, 0x00, 0xFF, 0xFF};
+            SDL_UpdateTexture(texture, nullptr, magenta, 4);
+            missingTexture = std::shared_ptr<SDL_Texture>(texture, SDL_DestroyTexture);
+        }
+    }
+    return missingTexture.get();
+}
+
+// Texture of a handle
+SDL_Texture* AssetManager::getTexture(AssetHandle handle) const {
+    if (handle < 0 || handle >= static_cast<int>(assets.size())) {
+        return nullptr;
+    }
+    const Asset& asset = *assets[handle];
+    if (asset.texture) {
+        return asset.texture.get();
+    }
+    return asset.missing ? placeholder() : nullptr;
+}
+
+// Atlas rectangle of a packed sprite
+const SDL_Rect* AssetManager::getSourceRect(AssetHandle handle) const {
+    if (handle < 0 || handle >= static_cast<int>(assets.size()) || !assets[handle]->packed) {
+        return nullptr;
+    }
+    return &assets[handle]->source;
+}
+
+// Font id of a handle
+int AssetManager::getFontId(AssetHandle handle) const {
+    if (handle < 0 || handle >= static_cast<int>(assets.size())) {
+        return -1;
+    }
+    return assets[handle]->fontId;
+}
+
+// Share of finished requests
+float AssetManager::getProgress() const {
+    if (assets.empty()) {
+        return 1.0f;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<float>(finishedCount) / assets.size();
+}
+
+// Whether nothing is left to load or upload
+bool AssetManager::isFinished() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return finishedCount == static_cast<int>(assets.size());
+}
+
+// One line per asset, in request order
+void AssetManager::reportLoadTimes() const {
+    std::cout << "Asset load times (" << loaders.size() << " loader threads):" << std::endl;
+    if (packMilliseconds > 0.0) {
+        std::printf("  asset pack mapped and uploaded in %.2f ms\n", packMilliseconds);
+    }
+    Clock::time_point first = Clock::time_point::max(), last = Clock::time_point::min();
+    for (const auto& asset : assets) {
+        first = std::min(first, asset->requested);
+        last = std::max(last, asset->uploaded);
+        std::printf("  %-58s %-6s queued %7.2f ms  decode %7.2f ms  upload %7.2f ms  total %7.2f ms\n",
+                    asset->key.c_str(), asset->missing ? "FAILED" : asset->packed ? "packed" : "ok",
+                    millisecondsBetween(asset->requested, asset->decodeStarted),
+                    millisecondsBetween(asset->decodeStarted, asset->decoded),
+                    millisecondsBetween(asset->decoded, asset->uploaded),
+                    millisecondsBetween(asset->requested, asset->uploaded));
+    }
+    if (!assets.empty()) {
+        std::printf("  all assets ready after %.2f ms\n", millisecondsBetween(first, last));
+    }
+}
@@ -0,0 +1,62 @@
+#include "asset_pack.h"
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Destructor
+AssetPack::~AssetPack() {
+    close();
+}
+
+// Map the whole file read-only and check that every section lies inside it
+bool AssetPack::open(const std::string& path) {
+    close();
+
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return false;
+    }
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || status.st_size < static_cast<off_t>(sizeof(PackHeader))) {
+        std::cerr << "Asset pack " << path << " is too small" << std::endl;
+        ::close(descriptor);
+        return false;
+    }
+
+    void* mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);  // The mapping keeps the file alive
+    if (mapping == MAP_FAILED) {
+        std::cerr << "Failed to map asset pack " << path << std::endl;
+        return false;
+    }
+    data = static_cast<const unsigned char*>(mapping);
+    size = static_cast<size_t>(status.st_size);
+
+    const PackHeader* pack = header();
+    uint64_t atlasEnd = static_cast<uint64_t>(pack->atlasOffset) + static_cast<uint64_t>(pack->atlasWidth) * pack->atlasHeight * 4;
+    uint64_t fontsEnd = static_cast<uint64_t>(pack->fontOffset) + static_cast<uint64_t>(pack->fontCount) * sizeof(PackedFont);
+    if (std::memcmp(pack->magic, "EVPK", 4) != 0 || pack->version != VERSION || atlasEnd > size || fontsEnd > size
+        || pack->atlasOffset % ALIGNMENT != 0 || pack->fontOffset % ALIGNMENT != 0) {
+        std::cerr << "Asset pack " << path << " is malformed or from another version" << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+// Unmap the file
+void AssetPack::close() {
+    if (data) {
+        munmap(const_cast<unsigned char*>(data), size);
+        data = nullptr;
+        size = 0;
+    }
+}
+
+// One font record
+const PackedFont& AssetPack::getFont(int index) const {
+    return reinterpret_cast<const PackedFont*>(data + header()->fontOffset)[index];
+}
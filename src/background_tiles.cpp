@@ -0,0 +1,91 @@
+#include "background_tiles.h"
+#include "profiler.h"
+#include <cmath>
+#include <iostream>
+
+// Constructor
+BackgroundTiles::BackgroundTiles(SDL_Renderer* renderer, AssetManager& assets, AssetHandle background, float scale)
+    : renderer(renderer), assets(assets), background(background), scale(scale) {
+}
+
+// Destructor
+BackgroundTiles::~BackgroundTiles() {
+    if (tiles) {
+        SDL_DestroyTexture(tiles);
+    }
+}
+
+// Draw the band, then its mirror image below it, into the tile texture
+bool BackgroundTiles::build() {
+    SDL_Texture* picture = assets.getTexture(background);
+    if (!picture) {
+        return false;
+    }
+    PROFILE_ZONE("Build background tiles");
+
+    // The part of the picture a view zoomed by `scale` around the centre shows,
+    // stretched to the height of BAND_ROWS rows
+    SDL_Rect whole = {0, 0, 0, 0};
+    if (const SDL_Rect* source = assets.getSourceRect(background)) {
+        whole = *source;
+    } else {
+        SDL_QueryTexture(picture, nullptr, nullptr, &whole.w, &whole.h);
+    }
+    int bandHeight = BAND_ROWS * TILE_HEIGHT;
+    band.w = static_cast<int>(std::lround(whole.w / scale));
+    band.h = static_cast<int>(std::lround(whole.w / scale * bandHeight / SCREEN_WIDTH));
+    band.x = whole.x + (whole.w - band.w) / 2;
+    band.y = whole.y + (whole.h - band.h) / 2;
+
+    if (!tiles && !useSource) {
+        if (SDL_RenderTargetSupported(renderer)) {
+            tiles = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                      SCREEN_WIDTH, cycleHeight());
+        }
+        if (!tiles) {
+            std::cerr << "No render target for the background tiles, drawing them from the picture: "
+                      << SDL_GetError() << std::endl;
+            useSource = true;
+        }
+    }
+    if (tiles) {
+        SDL_Texture* previousTarget = SDL_GetRenderTarget(renderer);
+        SDL_SetRenderTarget(renderer, tiles);
+        SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF);
+        SDL_RenderClear(renderer);
+        SDL_Rect upright = {0, 0, SCREEN_WIDTH, bandHeight};
+        SDL_Rect mirrored = {0, bandHeight, SCREEN_WIDTH, bandHeight};
+        SDL_RenderCopy(renderer, picture, &band, &upright);
+        SDL_RenderCopyEx(renderer, picture, &band, &mirrored, 0.0, nullptr, SDL_FLIP_VERTICAL);
+        SDL_SetRenderTarget(renderer, previousTarget);
+    }
+    built = true;
+    return true;
+}
+
+// Queue the visible rows, wrapping around the cycle
+bool BackgroundTiles::draw(SpriteBatch& batch, float scroll, int layer) {
+    if (!built && !build()) {
+        return false;
+    }
+
+    // Whole pixels, so neighbouring rows never leave a hairline between them
+    int offset = static_cast<int>(std::floor(scroll));
+    int firstRow = offset >= 0 ? offset / TILE_HEIGHT : -((-offset + TILE_HEIGHT - 1) / TILE_HEIGHT);
+    int rows = 2 * BAND_ROWS;
+    for (int row = firstRow; row * TILE_HEIGHT - offset < SCREEN_HEIGHT; ++row) {
+        int tile = ((row % rows) + rows) % rows;
+        SDL_FRect quad = {0.0f, static_cast<float>(row * TILE_HEIGHT - offset),
+                          static_cast<float>(SCREEN_WIDTH), static_cast<float>(TILE_HEIGHT)};
+        if (tiles) {
+            SDL_Rect source = {0, tile * TILE_HEIGHT, SCREEN_WIDTH, TILE_HEIGHT};
+            batch.draw(tiles, &source, quad, layer);
+        } else {
+            // Without the mirrored copy the band simply repeats
+            int bandRow = tile % BAND_ROWS;
+            SDL_Rect source = {band.x, band.y + band.h * bandRow / BAND_ROWS, band.w, band.h / BAND_ROWS};
+            batch.draw(assets.getTexture(background), &source, quad, layer);
+        }
+    }
+    return true;
+}
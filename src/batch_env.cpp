@@ -0,0 +1,254 @@
+#include "batch_env.h"
+#include "car.h"
+#include <algorithm>
+
+namespace {
+// Where Simulation starts its first AI car, and the size every car shares
+const float START_X = 580.0f;
+const float START_Y = 550.0f;
+const int CAR_WIDTH = 39;
+const int CAR_HEIGHT = 65;
+const int LANE_STEP = 10;  // Car::moveLeft / moveRight
+
+// Environments per job when stepping on a job system
+const int DEFAULT_GRAIN = 4096;
+
+// Seed of one chunk of one episode's track, mixing every input through SplitMix64
+uint64_t chunkSeed(unsigned seed, int env, uint32_t episode, int index) {
+    uint64_t key = SplitMix64(seed)();
+    key = SplitMix64(key ^ static_cast<uint64_t>(env))();
+    key = SplitMix64(key ^ episode)();
+    return SplitMix64(key ^ static_cast<uint64_t>(index))();
+}
+}
+
+// Constructor
+BatchEnv::BatchEnv(int envCount, unsigned seed, const BatchEnvConfig& config, JobSystem* jobs)
+    : envCount(std::max(1, envCount)), seed(seed), config(config), jobs(jobs),
+      finishY(START_Y - config.raceLength), grain(DEFAULT_GRAIN) {
+    size_t n = static_cast<size_t>(this->envCount);
+    carX.resize(n);
+    carY.resize(n);
+    speed.resize(n);
+    previousX.resize(n);
+    previousY.resize(n);
+    stepsTaken.resize(n);
+    windowChunk.resize(n);
+    episodeIndex.assign(n, 0);
+    hit.resize(n);
+
+    obstacleX.resize(SLOTS * n);
+    obstacleY.resize(SLOTS * n);
+    visible.resize(SLOTS * n);
+    counted.resize(SLOTS * n);
+
+    observationBuffer.resize(OBSERVATION_SIZE * n);
+    rewardBuffer.resize(n);
+    doneBuffer.resize(n);
+    rangeStats.resize((n + grain - 1) / grain);
+    reset();
+}
+
+// Every environment back on the start line of its current track
+void BatchEnv::reset() {
+    for (int env = 0; env < envCount; ++env) {
+        resetEnv(env);
+    }
+    std::fill(rewardBuffer.begin(), rewardBuffer.end(), 0.0f);
+    std::fill(doneBuffer.begin(), doneBuffer.end(), static_cast<uint8_t>(Running));
+    observe(0, envCount);
+}
+
+// Start line, no speed, the first chunks of the track
+void BatchEnv::resetEnv(int env) {
+    carX[env] = START_X;
+    carY[env] = START_Y;
+    speed[env] = 0.0f;
+    stepsTaken[env] = 0;
+    windowChunk[env] = 0;
+    for (int index = 0; index < WINDOW_CHUNKS; ++index) {
+        installChunk(env, index);
+    }
+}
+
+// Lay out the chunk with a generator that never allocates
+void BatchEnv::installChunk(int env, int index) {
+    SplitMix64 random(chunkSeed(seed, env, episodeIndex[env], index));
+    TrackChunk chunk = Track::layoutChunk(Simulation::AI_ROAD, index, random);
+    size_t first = static_cast<size_t>(index % WINDOW_CHUNKS) * TrackChunk::OBSTACLES;
+    for (int j = 0; j < TrackChunk::OBSTACLES; ++j) {
+        size_t at = (first + j) * envCount + env;
+        obstacleX[at] = chunk.xs[j];
+        obstacleY[at] = chunk.ys[j];
+        visible[at] = 0;
+        counted[at] = 0;
+    }
+}
+
+// Split the step over the job system, or run it in place
+void BatchEnv::step(const int8_t* actions) {
+    pendingActions = actions;
+    if (jobs && envCount > grain) {
+        jobs->parallelFor("batch.step", 0, envCount, grain, [this](int first, int last) { stepRange(first, last); });
+    } else {
+        for (int first = 0; first < envCount; first += grain) {
+            stepRange(first, std::min(envCount, first + grain));
+        }
+    }
+    pendingActions = nullptr;
+}
+
+// The phases of Simulation's AI step, each a loop over environments
+void BatchEnv::stepRange(int first, int last) {
+    const float dt = config.stepSeconds;
+    const float acceleration = Simulation::AI_ACCELERATION;
+    const float maxSpeed = Car::MAX_SPEED;
+    const float minX = static_cast<float>(Track::roadMinX(Simulation::AI_ROAD));
+    const float maxX = static_cast<float>(Track::roadMaxX(Simulation::AI_ROAD) + Simulation::OBSTACLE_WIDTH - CAR_WIDTH);
+    const size_t n = static_cast<size_t>(envCount);
+    float* x = carX.data();
+    float* y = carY.data();
+    float* v = speed.data();
+    float* px = previousX.data();
+    float* py = previousY.data();
+    uint8_t* hits = hit.data();
+
+    // Move up the road and gain speed, as Car::move and the AI's acceleration do
+    for (int e = first; e < last; ++e) {
+        px[e] = x[e];
+        py[e] = y[e];
+        y[e] = std::max(y[e] - v[e] * dt, finishY);
+        v[e] = std::min(v[e] + acceleration * dt, maxSpeed);
+        hits[e] = 0;
+    }
+
+    // Once the car is clear of the window's first chunk, recycle it for the road ahead
+    for (int e = first; e < last; ++e) {
+        while (y[e] + CAR_HEIGHT < Track::chunkBottom(windowChunk[e] + 1)) {
+            installChunk(e, windowChunk[e] + WINDOW_CHUNKS);
+            windowChunk[e]++;
+        }
+    }
+
+    // Reveal obstacles within VISIBILITY_RANGE of the car's corner; the squared
+    // test matches the truncated square root of updateObstacleVisibility
+    const int range2 = Simulation::VISIBILITY_RANGE * Simulation::VISIBILITY_RANGE;
+    for (int slot = 0; slot < SLOTS; ++slot) {
+        const int32_t* ox = obstacleX.data() + slot * n;
+        const int32_t* oy = obstacleY.data() + slot * n;
+        uint8_t* seen = visible.data() + slot * n;
+        for (int e = first; e < last; ++e) {
+            int dx = static_cast<int>(x[e]) - ox[e];
+            int dy = static_cast<int>(y[e]) - oy[e];
+            seen[e] |= static_cast<uint8_t>(dx * dx + dy * dy < range2);
+        }
+    }
+
+    // Steer one lane, kept on the road the planner drives
+    const int8_t* actions = pendingActions;
+    for (int e = first; e < last; ++e) {
+        x[e] = std::min(std::max(x[e] + LANE_STEP * static_cast<float>(actions[e]), minX), maxX);
+    }
+
+    // Hits, each obstacle once: the box swept forward at the old x, then the box
+    // where the sideways move left it (ObstacleField::querySwept and queryOverlap)
+    for (int slot = 0; slot < SLOTS; ++slot) {
+        const int32_t* ox = obstacleX.data() + slot * n;
+        const int32_t* oy = obstacleY.data() + slot * n;
+        uint8_t* done = counted.data() + slot * n;
+        for (int e = first; e < last; ++e) {
+            int left = static_cast<int>(px[e]);
+            int right = static_cast<int>(x[e]);
+            int top = static_cast<int>(y[e]);
+            int bottom = static_cast<int>(py[e]) + CAR_HEIGHT;
+            bool rows = top > oy[e] - CAR_HEIGHT && top < oy[e] + Simulation::OBSTACLE_HEIGHT;
+            bool swept = left > ox[e] - CAR_WIDTH && left < ox[e] + Simulation::OBSTACLE_WIDTH &&
+                         bottom > oy[e] && top < oy[e] + Simulation::OBSTACLE_HEIGHT;
+            bool overlap = rows && right > ox[e] - CAR_WIDTH && right < ox[e] + Simulation::OBSTACLE_WIDTH;
+            uint8_t fresh = static_cast<uint8_t>((swept | overlap) & !done[e]);
+            hits[e] |= fresh;
+            done[e] |= fresh;
+        }
+    }
+
+    // Rewards and episode ends
+    const float progressScale = 1.0f / config.raceLength;
+    const int maxSteps = config.maxSteps > 0 ? config.maxSteps : INT32_MAX;
+    const uint8_t crashCode = config.endOnCollision ? static_cast<uint8_t>(Crashed) : static_cast<uint8_t>(Running);
+    int32_t* steps = stepsTaken.data();
+    float* rewards = rewardBuffer.data();
+    uint8_t* dones = doneBuffer.data();
+    for (int e = first; e < last; ++e) {
+        steps[e]++;
+        bool finished = y[e] <= finishY;
+        rewards[e] = (py[e] - y[e]) * progressScale + hits[e] * config.collisionReward +
+                     finished * config.finishReward;
+        uint8_t end = steps[e] >= maxSteps ? static_cast<uint8_t>(TimedOut) : static_cast<uint8_t>(Running);
+        end = finished ? static_cast<uint8_t>(Finished) : end;
+        dones[e] = hits[e] && crashCode ? crashCode : end;
+    }
+
+    // Start the next episode where one ended
+    Stats& stats = rangeStats[first / grain].stats;
+    stats.steps += static_cast<uint64_t>(last - first);
+    for (int e = first; e < last; ++e) {
+        if (dones[e] == Running) {
+            continue;
+        }
+        stats.episodes++;
+        stats.crashes += dones[e] == Crashed;
+        stats.finishes += dones[e] == Finished;
+        stats.timeouts += dones[e] == TimedOut;
+        episodeIndex[e]++;
+        resetEnv(e);
+    }
+
+    observe(first, last);
+}
+
+// Car features, then every slot of the window nearest chunk first
+void BatchEnv::observe(int first, int last) {
+    const float minX = static_cast<float>(Track::roadMinX(Simulation::AI_ROAD));
+    const float roadWidth = static_cast<float>(Track::roadMaxX(Simulation::AI_ROAD) + Simulation::OBSTACLE_WIDTH) - minX;
+    const float laneScale = 1.0f / (roadWidth - CAR_WIDTH);
+    const float widthScale = 1.0f / roadWidth;
+    const float rangeScale = 1.0f / Simulation::VISIBILITY_RANGE;
+    const float speedScale = 1.0f / Car::MAX_SPEED;
+    const float raceScale = 1.0f / config.raceLength;
+    const size_t n = static_cast<size_t>(envCount);
+
+    for (int e = first; e < last; ++e) {
+        float* out = observationBuffer.data() + static_cast<size_t>(e) * OBSERVATION_SIZE;
+        float x = carX[e];
+        float y = carY[e];
+        out[0] = (x - minX) * laneScale;
+        out[1] = speed[e] * speedScale;
+        out[2] = (y - finishY) * raceScale;
+        out += CAR_FEATURES;
+
+        for (int c = 0; c < WINDOW_CHUNKS; ++c) {
+            size_t firstSlot = static_cast<size_t>((windowChunk[e] + c) % WINDOW_CHUNKS) * TrackChunk::OBSTACLES;
+            for (int j = 0; j < TrackChunk::OBSTACLES; ++j, out += SLOT_FEATURES) {
+                size_t at = (firstSlot + j) * n + e;
+                // Passed once the obstacle's top is below the car's bottom edge
+                bool seen = visible[at] && obstacleY[at] < y + CAR_HEIGHT;
+                out[0] = seen ? 1.0f : 0.0f;
+                out[1] = seen ? (obstacleX[at] - x) * widthScale : 0.0f;
+                out[2] = seen ? (y - obstacleY[at]) * rangeScale : 0.0f;
+            }
+        }
+    }
+}
+
+// Sum the counters of every range
+BatchEnv::Stats BatchEnv::getStats() const {
+    Stats total;
+    for (const RangeStats& range : rangeStats) {
+        total.steps += range.stats.steps;
+        total.episodes += range.stats.episodes;
+        total.crashes += range.stats.crashes;
+        total.finishes += range.stats.finishes;
+        total.timeouts += range.stats.timeouts;
+    }
+    return total;
+}
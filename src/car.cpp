@@ -1,4 +1,5 @@
 #include "car.h"
+#include "state_buffer.h"
 
 // Car dynamics constants
 const float Car::ACCELERATION_RATE = 1.0f;
@@ -7,49 +8,43 @@ const float Car::MAX_SPEED = 120.0f;
 const int Car::FINISH_LINE_X = 1000;
 const int Car::START_LINE_Y = 20; //350
 
-// Constructor: Initialize the car with initial position and texture
-Car::Car(int x, int y, const std::string& textureFilePath, SDL_Renderer* renderer)
-    : x(x), y(y), speed(0.0f) {
-    texture = loadTexture(textureFilePath, renderer);
-     // Check if the texture was loaded successfully
-    if (!texture) {
-        std::cout << "Failed to load texture from " << textureFilePath.c_str() << "SDL_Error: " << SDL_GetError() << std::endl;
-    }
+// Constructor: Initialize the car with initial position
+Car::Car(int x, int y)
+    : speed(0.0f), x(x), y(y), previousX(x), previousY(y) {
 }
 
 // Get the X position of the car
 int Car::getX() const {
-    std::lock_guard<std::mutex> lock(carMutex);
-    return x;
+    return static_cast<int>(x);
 }
 
 // Get the Y position of the car
 int Car::getY() const {
-    std::lock_guard<std::mutex> lock(carMutex);
-    return y;
+    return static_cast<int>(y);
 }
 
 // Set the X position of the car
 void Car::setX(int newX) {
-    std::lock_guard<std::mutex> lock(carMutex);
     x = newX;
 }
 
 // Move the car to the right
 void Car::moveRight() {
-    std::lock_guard<std::mutex> lock(carMutex);
     x += moveDistance;
 }
 
 // Move the car to the left
 void Car::moveLeft() {
-    std::lock_guard<std::mutex> lock(carMutex);
     x += moveDistanceLeft;
 }
 
+// Move the car sideways by any distance
+void Car::moveSideways(float distance) {
+    x += distance;
+}
+
 // Set the Y position of the car
 void Car::setY(int newY) {
-    std::lock_guard<std::mutex> lock(carMutex);
     y = newY;
 }
 
@@ -57,13 +52,35 @@ void Car::setY(int newY) {
 void Car::start() {
     // Set an initial speed if you want
     speed = 0.0f; // Or any other initial speed value
-    std::cout << "Car started with speed: " << speed << std::endl;
 }
 
 // Reset the car's position to the specified coordinates
 void Car::reset(int x, int y){
     this->x = x; 
     this->y = y;
+    previousX = x;
+    previousY = y;
+    distanceCovered = 0.0f;
+}
+
+// The finish line is the upper boundary the car is clamped to
+bool Car::hasFinished() const {
+    return y <= finishLineY;
+}
+
+// Set the finish line
+void Car::setFinishLine(int finishY) {
+    finishLineY = finishY;
+}
+
+// Set the speed, e.g. for cars driven by the simulation rather than by input
+void Car::setSpeed(float newSpeed) {
+    speed = newSpeed;
+}
+
+// Add ground covered this step
+void Car::addDistanceCovered(float distance) {
+    distanceCovered += distance;
 }
 
 // Accelerate the car
@@ -80,46 +97,44 @@ void Car::decelerate() {
 
 // Move the car based on elapsed time (deltaTime)
 void Car::move(float deltaTime) {
-    std::lock_guard<std::mutex> lock(carMutex);
     
     // Adjust the y coordinate to make the car move upwards
-    y -= static_cast<int>(speed * deltaTime); 
-    if (y < START_LINE_Y) y = START_LINE_Y; // Ensure car doesn't move beyond the starting line or upper boundary
+    y -= speed * deltaTime; 
+    if (y < finishLineY) y = finishLineY; // Ensure car doesn't move beyond the finish line
 }
 
-// Render the car on the given renderer
-void Car::render(SDL_Renderer* renderer) {
-    std::lock_guard<std::mutex> lock(carMutex);
-    if (texture) {
-        SDL_Rect carQuad = {x, y, 36, 65};
-        SDL_RenderCopy(renderer, texture.get(), nullptr, &carQuad);
-    }
+// Remember where the car was before the next simulation step
+void Car::savePreviousState() {
+    previousX = x;
+    previousY = y;
 }
 
-// Load a texture from a file path
-std::shared_ptr<SDL_Texture> Car::loadTexture(const std::string& path, SDL_Renderer* renderer) {
-    SDL_Texture* newTexture = nullptr;
-    SDL_Surface* loadedSurface = IMG_Load(path.c_str());
-    if (loadedSurface) {
-        newTexture = SDL_CreateTextureFromSurface(renderer, loadedSurface);
-        SDL_FreeSurface(loadedSurface);
-    }
-    return std::shared_ptr<SDL_Texture>(newTexture, SDL_DestroyTexture);
+// Interpolated X position for rendering
+float Car::getInterpolatedX(float alpha) const {
+    return previousX + (x - previousX) * alpha;
+}
+
+// Interpolated Y position for rendering
+float Car::getInterpolatedY(float alpha) const {
+    return previousY + (y - previousY) * alpha;
 }
 
 // Copy Constructor
 Car::Car(const Car& other)
-    : x(other.x), y(other.y), texture(other.texture), speed(other.speed) {
-    // Nothing extra needed, shared_ptr will automatically increase the reference count.
+    : speed(other.speed), distanceCovered(other.distanceCovered),
+      x(other.x), y(other.y), previousX(other.previousX), previousY(other.previousY),
+      finishLineY(other.finishLineY) {
 }
 
 // Move Constructor
 Car::Car(Car&& other) noexcept
-    : x(other.x), y(other.y), texture(std::move(other.texture)), speed(other.speed) {
+    : speed(other.speed), distanceCovered(other.distanceCovered),
+      x(other.x), y(other.y), previousX(other.previousX), previousY(other.previousY),
+      finishLineY(other.finishLineY) {
     other.x = 0;
     other.y = 0;
     other.speed = 0.0f;
-    // other.texture is automatically set to nullptr by std::move
+    other.distanceCovered = 0.0f;
 }
 
 // Copy Assignment Operator
@@ -127,8 +142,11 @@ Car &Car::operator=(const Car& other) {
     if (this != &other) {
         x = other.x;
         y = other.y;
-        texture = other.texture;  // shared_ptr will automatically handle reference counting
+        previousX = other.previousX;
+        previousY = other.previousY;
+        finishLineY = other.finishLineY;
         speed = other.speed;
+        distanceCovered = other.distanceCovered;
     }
     return *this;
 }
@@ -138,19 +156,41 @@ Car &Car::operator=(Car&& other) noexcept {
     if (this != &other) {
         x = other.x;
         y = other.y;
-        texture = std::move(other.texture);
+        previousX = other.previousX;
+        previousY = other.previousY;
+        finishLineY = other.finishLineY;
         speed = other.speed;
+        distanceCovered = other.distanceCovered;
 
         other.x = 0;
         other.y = 0;
         other.speed = 0.0f;
-        // other.texture is automatically set to nullptr by std::move
+        other.distanceCovered = 0.0f;
     }
     return *this;
 }
 
 // Destructor
-Car::~Car() {
-    // Destructor is called when the shared_ptr's reference count goes to zero,
-    // and it will automatically release the SDL_Texture resource.
+Car::~Car() {}
+
+// Keyframe state
+void Car::saveState(StateWriter& writer) const {
+    writer.f32(speed);
+    writer.f32(distanceCovered);
+    writer.f32(x);
+    writer.f32(y);
+    writer.f32(previousX);
+    writer.f32(previousY);
+    writer.i32(finishLineY);
+}
+
+// Restore a keyframe
+void Car::loadState(StateReader& reader) {
+    speed = reader.f32();
+    distanceCovered = reader.f32();
+    x = reader.f32();
+    y = reader.f32();
+    previousX = reader.f32();
+    previousY = reader.f32();
+    finishLineY = reader.i32();
 }
@@ -0,0 +1,88 @@
+#include "config.h"
+#include "simulation.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace {
+// Read the integer following a flag, keeping the default when it is missing or out of range
+int readInt(int argc, char* args[], int& i, int fallback, int minimum, int maximum) {
+    if (i + 1 >= argc) {
+        std::cerr << "Missing value for " << args[i] << std::endl;
+        return fallback;
+    }
+    int value = std::atoi(args[++i]);
+    if (value < minimum || value > maximum) {
+        std::cerr << "Value for " << args[i - 1] << " must be between " << minimum << " and " << maximum << std::endl;
+        return fallback;
+    }
+    return value;
+}
+
+// Read the string following a flag, keeping the default when it is missing
+std::string readString(int argc, char* args[], int& i, const std::string& fallback) {
+    if (i + 1 >= argc) {
+        std::cerr << "Missing value for " << args[i] << std::endl;
+        return fallback;
+    }
+    return args[++i];
+}
+}
+
+// Parse the command line into a GameConfig
+GameConfig parseCommandLine(int argc, char* args[]) {
+    GameConfig config;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(args[i], "--tick-rate") == 0) {
+            config.tickRate = readInt(argc, args, i, config.tickRate, 1, 1000);
+        } else if (std::strcmp(args[i], "--max-catch-up") == 0) {
+            config.maxCatchUpSteps = readInt(argc, args, i, config.maxCatchUpSteps, 1, 100);
+        } else if (std::strcmp(args[i], "--race-length") == 0) {
+            config.raceLength = readInt(argc, args, i, config.raceLength, Simulation::MIN_RACE_LENGTH,
+                                        Simulation::MAX_RACE_LENGTH);
+        } else if (std::strcmp(args[i], "--ai-cars") == 0) {
+            config.aiCars = readInt(argc, args, i, config.aiCars, 1, Simulation::MAX_AI_CARS);
+        } else if (std::strcmp(args[i], "--ai-budget") == 0) {
+            config.aiBudgetMicros = readInt(argc, args, i, config.aiBudgetMicros, 0, 100000);
+        } else if (std::strcmp(args[i], "--pacing") == 0) {
+            std::string name = readString(argc, args, i, pacingModeName(config.pacing));
+            if (!parsePacingMode(name.c_str(), config.pacing)) {
+                std::cerr << "Pacing must be vsync, cap or uncapped" << std::endl;
+            }
+        } else if (std::strcmp(args[i], "--fps") == 0) {
+            config.targetFps = readInt(argc, args, i, config.targetFps, 1, 1000);
+            config.pacing = PacingMode::Capped;
+        } else if (std::strcmp(args[i], "--record") == 0) {
+            config.recordPath = readString(argc, args, i, config.recordPath);
+        } else if (std::strcmp(args[i], "--replay") == 0) {
+            config.replayPath = readString(argc, args, i, config.replayPath);
+        } else if (std::strcmp(args[i], "--replay-speed") == 0) {
+            config.replaySpeed = readInt(argc, args, i, config.replaySpeed, 1, 1000);
+        } else if (std::strcmp(args[i], "--replay-start") == 0) {
+            config.replayStart = readInt(argc, args, i, config.replayStart, 0, 1000000000);
+        } else if (std::strcmp(args[i], "--seed") == 0) {
+            config.seed = static_cast<unsigned>(readInt(argc, args, i, static_cast<int>(config.seed), 0, 2147483647));
+        } else if (std::strcmp(args[i], "--netplay") == 0) {
+            config.netplay = readString(argc, args, i, config.netplay);
+            if (config.netplay != "host" && config.netplay != "join") {
+                std::cerr << "Netplay must be host or join" << std::endl;
+                config.netplay.clear();
+            }
+        } else if (std::strcmp(args[i], "--port") == 0) {
+            config.netPort = readInt(argc, args, i, config.netPort, 1, 65535);
+        } else if (std::strcmp(args[i], "--peer") == 0) {
+            config.netPeer = readString(argc, args, i, config.netPeer);
+        } else if (std::strcmp(args[i], "--net-delay") == 0) {
+            config.netDelay = readInt(argc, args, i, config.netDelay, 0, 10000);
+        } else if (std::strcmp(args[i], "--help") == 0) {
+            std::cout << "Usage: Evador [--tick-rate HZ] [--max-catch-up STEPS] [--race-length PIXELS]\n"
+                         "              [--ai-cars N] [--ai-budget MICROSECONDS] [--pacing vsync|cap|uncapped] [--fps HZ]\n"
+                         "              [--record FILE] [--replay FILE [--replay-speed N] [--replay-start STEP]] [--seed S]\n"
+                         "              [--netplay host|join [--port PORT] [--peer HOST[:PORT]] [--net-delay MS]]" << std::endl;
+            std::exit(0);
+        } else {
+            std::cerr << "Ignoring unknown option " << args[i] << std::endl;
+        }
+    }
+    return config;
+}
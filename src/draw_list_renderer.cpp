@@ -0,0 +1,121 @@
+#include "draw_list_renderer.h"
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+
+// Constructor
+DrawListRenderer::DrawListRenderer(SpriteBatch& batch, TextCache& textCache, AssetManager& assets)
+    : batch(batch), textCache(textCache), assets(assets) {
+}
+
+// Map a sprite id to an asset
+void DrawListRenderer::setSprite(SpriteId sprite, AssetHandle handle) {
+    sprites[static_cast<size_t>(sprite)] = handle;
+}
+
+// Map the font ids
+void DrawListRenderer::setFonts(int normal, int large) {
+    normalFont = normal;
+    largeFont = large;
+}
+
+// Interpolate to the current time
+void DrawListRenderer::render(const DrawList& list, bool textVisible) {
+    // Fraction of the next step that has already elapsed
+    float alpha = 1.0f;
+    if (list.stepSeconds > 0.0f) {
+        float sinceStep = std::chrono::duration<float>(std::chrono::steady_clock::now() - list.stepTime).count();
+        alpha = std::max(0.0f, std::min(1.0f, sinceStep / list.stepSeconds));
+    }
+    render(list, alpha, textVisible);
+}
+
+// Apply the line offset and alignment
+void DrawListRenderer::placeText(const DrawCommand& command, int fontId, const char* text, float x, float y,
+                                 int& textX, int& textY) const {
+    textX = static_cast<int>(x);
+    textY = static_cast<int>(y) + command.line * (textCache.lineHeight(fontId) + 10);
+    if (command.align == TextAlign::Center) {
+        textX -= textCache.measureText(fontId, text) / 2;
+        textY -= textCache.lineHeight(fontId) / 2;
+    }
+}
+
+// Replay one recorded list into the sprite batch and the text cache
+void DrawListRenderer::render(const DrawList& list, float alpha, bool textVisible) {
+    PROFILE_ZONE("Replay draw list");
+
+    // The camera follows the player's car, keeping it on its starting row
+    cameraY = list.cameraPreviousY + (list.cameraY - list.cameraPreviousY) * alpha;
+
+    // HUD panels first: a panel whose text changed is rendered through the
+    // text cache, which must not hold anything else at that point
+    bool panelsCached = false;
+    if (hudLayers) {
+        hudLayers->beginFrame();
+        for (const DrawCommand& command : list.commands) {
+            if (command.type != DrawCommandType::Text || command.panel == HudPanel::None ||
+                (command.blink && !textVisible)) {
+                continue;
+            }
+            int fontId = command.font == FontId::Large ? largeFont : normalFont;
+            const char* text = list.text.c_str() + command.textOffset;
+            int textX, textY;
+            placeText(command, fontId, text, command.x, command.y, textX, textY);
+            SDL_Color color = {command.color.r, command.color.g, command.color.b, command.color.a};
+            hudLayers->addText(command.panel, fontId, textX, textY, text, color);
+        }
+        panelsCached = hudLayers->compose(batch, SpriteBatch::LAYER_HUD);
+    }
+
+    for (const DrawCommand& command : list.commands) {
+        if (command.type == DrawCommandType::ScrollingBackground) {
+            // Covers the whole screen whatever the camera, so it is never culled
+            if (backgroundTiles) {
+                backgroundTiles->draw(batch, cameraY - command.y, command.layer);
+            }
+            continue;
+        }
+        float x = command.previousX + (command.x - command.previousX) * alpha;
+        float y = command.previousY + (command.y - command.previousY) * alpha;
+        if (!command.screenSpace) {
+            y -= cameraY;
+            // Off-screen world objects cost nothing to skip
+            if (y + command.height < 0 || y >= SCREEN_HEIGHT) continue;
+        }
+
+        SDL_Color color = {command.color.r, command.color.g, command.color.b, command.color.a};
+        switch (command.type) {
+            case DrawCommandType::Sprite: {
+                AssetHandle sprite = sprites[static_cast<size_t>(command.sprite)];
+                SDL_Texture* texture = assets.getTexture(sprite);
+                if (texture) {
+                    SDL_FRect quad = {x, y, command.width, command.height};
+                    batch.draw(texture, assets.getSourceRect(sprite), quad, command.layer, color);
+                }
+                break;
+            }
+            case DrawCommandType::Rect: {
+                SDL_FRect quad = {x, y, command.width, command.height};
+                batch.draw(nullptr, nullptr, quad, command.layer, color);
+                break;
+            }
+            case DrawCommandType::Text: {
+                if (command.blink && !textVisible) {
+                    break; // Don't render the text if it's not visible
+                }
+                if (panelsCached && command.panel != HudPanel::None) {
+                    break; // Composited from its panel's texture
+                }
+                int fontId = command.font == FontId::Large ? largeFont : normalFont;
+                const char* text = list.text.c_str() + command.textOffset;
+                int textX, textY;
+                placeText(command, fontId, text, x, y, textX, textY);
+                textCache.drawText(fontId, textX, textY, text, color);
+                break;
+            }
+            case DrawCommandType::ScrollingBackground:
+                break;
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#include "frame_pacer.h"
+#include "percentile.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+namespace {
+// Bounds of the spin margin; the initial value suits a typical 1 ms timer
+const double MIN_SPIN_MARGIN = 0.0002;
+const double MAX_SPIN_MARGIN = 0.004;
+const double INITIAL_SPIN_MARGIN = 0.0015;
+
+// A wake-up this late shifts the margin by 1/8 of the difference, and the
+// margin covers twice the typical lateness
+const double MARGIN_SMOOTHING = 0.125;
+const double MARGIN_HEADROOM = 2.0;
+}
+
+// Constructor
+FramePacer::FramePacer(PacingMode mode, int targetFps) : spinMarginSeconds(INITIAL_SPIN_MARGIN) {
+    frameMillis.reserve(MAX_SAMPLES);
+    scratch.reserve(MAX_SAMPLES);
+    setMode(mode, targetFps);
+}
+
+// Restart the schedule with a new mode
+void FramePacer::setMode(PacingMode newMode, int newTargetFps) {
+    mode = newMode;
+    targetFps = std::max(1, newTargetFps);
+    period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+    started = false;
+}
+
+// Sleep most of the way, then spin on the clock
+void FramePacer::waitUntil(Clock::time_point deadline) {
+    Clock::time_point now = Clock::now();
+    auto margin = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(spinMarginSeconds));
+    if (deadline - now > margin) {
+        Clock::time_point wakeAt = deadline - margin;
+        std::this_thread::sleep_until(wakeAt);
+        now = Clock::now();
+        // Learn how late sleeps end; early wake-ups only mean more spinning
+        double late = std::chrono::duration<double>(now - wakeAt).count();
+        double wanted = std::min(MAX_SPIN_MARGIN, std::max(MIN_SPIN_MARGIN, late * MARGIN_HEADROOM));
+        spinMarginSeconds += (wanted - spinMarginSeconds) * MARGIN_SMOOTHING;
+    }
+    while (now < deadline) {
+        std::this_thread::yield();
+        now = Clock::now();
+    }
+}
+
+// Wait for the next deadline and record the frame
+void FramePacer::endFrame() {
+    PROFILE_ZONE("Frame pacing");
+    if (mode == PacingMode::Capped) {
+        Clock::time_point now = Clock::now();
+        if (!started) {
+            nextDeadline = now + period;
+        } else if (now > nextDeadline + period) {
+            // More than a frame behind (a hitch): start a new schedule instead of racing to catch up
+            nextDeadline = now + period;
+        }
+        waitUntil(nextDeadline);
+        nextDeadline += period;
+    }
+
+    Clock::time_point end = Clock::now();
+    if (started && frameMillis.size() < MAX_SAMPLES) {
+        frameMillis.push_back(std::chrono::duration<float, std::milli>(end - lastFrameEnd).count());
+    }
+    lastFrameEnd = end;
+    started = true;
+}
+
+// Sort a copy of the frame times and read the percentiles
+FramePacer::Stats FramePacer::takeStats() {
+    Stats stats;
+    stats.spinMarginMillis = mode == PacingMode::Capped ? spinMarginSeconds * 1000.0 : 0.0;
+    stats.frames = static_cast<int>(frameMillis.size());
+    if (frameMillis.empty()) {
+        return stats;
+    }
+    scratch.assign(frameMillis.begin(), frameMillis.end());
+    std::sort(scratch.begin(), scratch.end());
+    stats.p50Millis = percentile(scratch, 0.50);
+    stats.p99Millis = percentile(scratch, 0.99);
+    stats.maxMillis = scratch.back();
+
+    for (float& sample : scratch) {
+        sample = std::fabs(sample - static_cast<float>(stats.p50Millis));
+    }
+    std::sort(scratch.begin(), scratch.end());
+    stats.jitterP50Millis = percentile(scratch, 0.50);
+    stats.jitterP99Millis = percentile(scratch, 0.99);
+    frameMillis.clear();
+    return stats;
+}
+
+// Mode from its command line name
+bool parsePacingMode(const char* name, PacingMode& mode) {
+    if (std::strcmp(name, "vsync") == 0) {
+        mode = PacingMode::VSync;
+    } else if (std::strcmp(name, "cap") == 0) {
+        mode = PacingMode::Capped;
+    } else if (std::strcmp(name, "uncapped") == 0) {
+        mode = PacingMode::Uncapped;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Command line name of a mode
+const char* pacingModeName(PacingMode mode) {
+    switch (mode) {
+        case PacingMode::VSync: return "vsync";
+        case PacingMode::Capped: return "cap";
+        case PacingMode::Uncapped: return "uncapped";
+    }
+    return "vsync";
+}
@@ -1,133 +1,187 @@
 #include "game.h"
-#include <sstream>
-#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
 #include <iostream>
+#include <cstdlib>  // for exit()
 #include <ctime>    // for time()
-#include <cstdlib>  // for srand() and rand()
 
 // Constructor for the Game class
-Game::Game() {
-    // Initialize game state to STARTED (or PAUSED, based on your design)
-    GameState gameState = GameState::STARTED;
-
+Game::Game(const GameConfig& config) : config(config), framePacer(config.pacing, config.targetFps) {
     // Call the initialization method
     initGame();
-
-    // Seed the random number generator with the current time
-    srand(static_cast<unsigned int>(time(nullptr))); 
-
-    // Initialize accumulated time to zero
-    accumulatedTime = 0.0f;
 }
 
-// The game loop function
+// The game loop function: the simulation runs in fixed steps of
+// 1 / tickRate seconds on its own thread; this thread pumps SDL events,
+// forwards them as commands and draws the newest recorded draw list,
+// interpolated to the time of the frame
 void Game::run() {
-    while (gameState != GameState::QUIT) {
-       
-        currentFrameTime = SDL_GetTicks();
-        deltaTime = (currentFrameTime - lastFrameTime) / 1000.0f;
-        lastFrameTime = currentFrameTime;
-
-        timeSinceLastBlink += deltaTime; // where deltaTime is the time (in seconds) since the last frame
-
-        SDL_Event e;
-        while (SDL_PollEvent(&e)) {
-            // user input handler
-            handleEvents(e);
+    const double frequency = static_cast<double>(SDL_GetPerformanceFrequency());
+    lastFrameCounter = SDL_GetPerformanceCounter();
+    PROFILE_THREAD("main");
+    simulationThread->start();
+
+    while (!quitRequested) {
+        Uint64 frameCounter = SDL_GetPerformanceCounter();
+        double frameSeconds = (frameCounter - lastFrameCounter) / frequency;
+        lastFrameCounter = frameCounter;
+
+        timeSinceLastBlink += static_cast<float>(frameSeconds); // Real time since the last frame
+
+        {
+            PROFILE_ZONE("Poll events");
+            SDL_Event e;
+            while (SDL_PollEvent(&e)) {
+                // user input handler
+                handleEvents(e);
+            }
+
+            // Driving keys are sent as the state held after the pump, so the
+            // simulation applies them every step instead of once per key repeat
+            SimulationCommand controls;
+            if (!replayPlayer && inputSampler.sample(controls)) {
+                simulationThread->post(controls);
+            }
         }
-        
-        // Only update and render if the game state is RUNNING
-        if (gameState == GameState::RUNNING) {
-            update();  // Update game state
-        } 
-        render();  // Render game state
+
+        updateAssets();
+        const DrawList* list = simulationThread->acquireDrawList();
+        updateParticles(list, static_cast<float>(frameSeconds));
+        render(list);  // Render game state
+        framePacer.endFrame();  // Waits for the next frame when capped
 
          // Used for blicking text 
         if (timeSinceLastBlink > BLINK_INTERVAL) {
             isTextVisible = !isTextVisible;
             timeSinceLastBlink = 0.0f;
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(16));   
+
+        timeSinceTimingReport += static_cast<float>(frameSeconds);
+        if (timeSinceTimingReport > TIMING_REPORT_INTERVAL) {
+            reportTaskTimings();
+            timeSinceTimingReport = 0.0f;
+        }
+        PROFILE_FRAME();
     }
+    simulationThread->stop();
 }
 
-// Start the game function
+// Start the game function, or stop it when it is running
 void Game::startGame() {
-    if (gameState == GameState::RUNNING) {
-        scalingEnabled = true;
-        car1->start();
-        car2->start();
+    // The race waits for the cars and obstacles to be drawable
+    if (!assets->isFinished() || netSession) {
+        return;  // A netplay race starts when the peer answers
     }
+    simulationThread->post(SimulationCommandType::Toggle);
 }
 
-// Update game state based on user input and time
-void Game::update(){
-    // Used for scaling our poor image
-   // Update the scale factor here. Adjusting the height scale more than the width.
-   if (scalingEnabled) {
-    scaleFactor += 0.02f;//0.002f; // Increment the scale factor slightly over time for height
-    if (scaleFactor > 5.2f) { // 1.2Reset if it grows too large. Adjust the max value as needed.
-        scaleFactor = 5.2f; //1.0f
+// Print how long each kind of task took, so the payoff of running them in
+// parallel can be compared across entity counts
+void Game::reportTaskTimings() {
+    std::cout << "Task timings (" << jobs->workerCount() << " workers, "
+              << lastObstacleCount << " obstacles, " << simulation->getAiCarCount() + 1 << " cars, "
+              << simulationThread->getTicks() << " ticks, "
+              << simulationThread->getDroppedLists() << " draw lists dropped):" << std::endl;
+    for (const auto& timing : jobs->takeTimings()) {
+        std::printf("  %-28s %8lu runs  avg %8.2f us  max %8.2f us\n",
+                    timing.name.c_str(), timing.count,
+                    timing.totalMicros / timing.count, timing.maxMicros);
     }
-   }
-
-   // Launch threads to update cars
-   std::thread car1UpdateThread(&Car::move, car1.get(), deltaTime * 20);
-   std::thread car2UpdateThread(&Car::move, car2.get(), deltaTime);
 
-    // Join threads
-    car1UpdateThread.join();
-    car2UpdateThread.join();
+    // AI planner work since the race started
+    const PlannerStats& planner = lastPlannerStats;
+    if (planner.plans > 0) {
+        std::printf("AI planner: %llu plans, %llu steps reused, avg %.0f nodes  avg %.2f us  max %.2f us\n",
+                    static_cast<unsigned long long>(planner.plans), static_cast<unsigned long long>(planner.reuses),
+                    static_cast<double>(planner.totalNodes) / planner.plans,
+                    planner.totalMicros / planner.plans, planner.maxMicros);
+    }
 
-    accumulatedTime += deltaTime;  // deltaTime should be in seconds
+    // Netplay corrections since the race started
+    const RollbackStats& rollback = lastRollbackStats;
+    if (netSession && rollback.frames > 0) {
+        std::printf("Netplay: %llu frames, %llu rollbacks (avg %.1f frames, max %d), resim avg %.2f us  max %.2f us, "
+                    "%llu stalls, round trip %d frames, %llu/%llu checksums differed\n",
+                    static_cast<unsigned long long>(rollback.frames), static_cast<unsigned long long>(rollback.rollbacks),
+                    rollback.rollbacks > 0 ? static_cast<double>(rollback.resimulatedFrames) / rollback.rollbacks : 0.0,
+                    rollback.maxRollbackFrames,
+                    rollback.rollbacks > 0 ? rollback.totalResimMicros / rollback.rollbacks : 0.0,
+                    rollback.maxResimMicros, static_cast<unsigned long long>(rollback.stalls), rollback.roundTripFrames,
+                    static_cast<unsigned long long>(rollback.desyncs), static_cast<unsigned long long>(rollback.checksums));
+    }
 
-    // Define a constant acceleration value
-    const float ACCELERATION = 1.0f; // you can adjust this value based on how fast you want the car to accelerate
+    // Live effects and spawns lost to full pools
+    ParticleSystem::Stats effects = particles.getStats();
+    std::printf("Particles: %zu live, %d drawn last frame, %llu spawned, %llu dropped\n", effects.live,
+                particleRenderer->getQuadCount(), static_cast<unsigned long long>(effects.spawned),
+                static_cast<unsigned long long>(effects.dropped));
+
+    // HUD panels composited from their cached texture versus rendered again
+    const HudLayers::Stats& hud = hudLayers->getStats();
+    uint64_t hudHits = hud.hits - lastHudStats.hits;
+    uint64_t hudMisses = hud.misses - lastHudStats.misses;
+    if (hudHits + hudMisses > 0) {
+        std::printf("HUD layers: %llu cache hits, %llu misses (%.1f %% hits)\n",
+                    static_cast<unsigned long long>(hudHits), static_cast<unsigned long long>(hudMisses),
+                    100.0 * hudHits / (hudHits + hudMisses));
+    }
+    lastHudStats = hud;
 
-    if (accumulatedTime > 0.0f && car2->speed < Car::MAX_SPEED) {
-        // Increment the car's speed by the acceleration value
-        car2->speed += ACCELERATION;
+    // Key press to the first presented frame showing it
+    InputSampler::Stats latency = inputSampler.takeStats();
+    if (latency.presses > 0) {
+        std::printf("Input latency: %d presses, p50 %.2f ms  p99 %.2f ms  max %.2f ms\n",
+                    latency.presses, latency.p50Millis, latency.p99Millis, latency.maxMillis);
+    }
 
-        // Ensure the speed doesn't exceed MAX_SPEED
-        if (car2->speed > Car::MAX_SPEED) {
-            car2->speed = Car::MAX_SPEED;
+    // How evenly frames were delivered
+    FramePacer::Stats pacing = framePacer.takeStats();
+    if (pacing.frames > 0) {
+        std::printf("Frame pacing (%s", pacingModeName(framePacer.getMode()));
+        if (framePacer.getMode() == PacingMode::Capped) {
+            std::printf(" %d Hz, spin %.2f ms", framePacer.getTargetFps(), pacing.spinMarginMillis);
         }
+        std::printf("): %d frames, p50 %.2f ms  p99 %.2f ms  max %.2f ms, jitter p50 %.3f ms  p99 %.3f ms\n",
+                    pacing.frames, pacing.p50Millis, pacing.p99Millis, pacing.maxMillis,
+                    pacing.jitterP50Millis, pacing.jitterP99Millis);
     }
-    // Update distance covered
-    car1->distanceCovered += car1->speed * deltaTime;
-    car2->distanceCovered += car2->speed * deltaTime;
-
-    // Update visibility for obstacles related to car1 (index 0 to 2)
-    updateObstacleVisibility(car1->getX(), car1->getY(), 0, 2);
-    // Update visibility for obstacles related to car2 (index 3 to 5)
-    updateObstacleVisibility(car2->getX(), car2->getY(), 3, 5);
-
-    // Check for collisions for car2 (given car2's obstacles are from index 3 to 5)
-    for (int i = 3; i <= 5; ++i) {
-        auto& obstacle = obstacles[i];
-        if (obstacle.isVisible()) {
-            AvoidDirection direction = checkImminentCollision(car2->getX(), car2->getY(), car2->getWidth(), car2->getHeight(), obstacle);
-            if (direction == AvoidDirection::Left) {
-                car2->moveLeft();
-            } else if (direction == AvoidDirection::Right) {
-                car2->moveRight();
-            }
-        }
+
+    // Sprite batch counters per frame; text adds one more draw call
+    if (drawStatsFrames > 0) {
+        const SpriteBatch::FrameStats& last = spriteBatch->getStats();
+        std::printf("Sprites per frame: avg %.1f sprites, %.1f draw calls, %.1f vertices (last frame %d / %d / %d)\n",
+                    static_cast<double>(drawStatsTotal.sprites) / drawStatsFrames,
+                    static_cast<double>(drawStatsTotal.drawCalls) / drawStatsFrames,
+                    static_cast<double>(drawStatsTotal.vertices) / drawStatsFrames,
+                    last.sprites, last.drawCalls, last.vertices);
+        drawStatsTotal = SpriteBatch::FrameStats();
+        drawStatsFrames = 0;
     }
+}
 
-    // Collision detection for car1
-    for (const auto& obstacle : obstacles) {
-            if (detectCollision(car1->getX(), car1->getY(), car1->getWidth(), car1->getHeight(), obstacle)) {
-                gameState = GameState::GAMEOVER;
-                break; // Exit the loop once a collision is detected
+// Effects run on real time, like the interpolation; bursts fire once per
+// simulation tick however many frames show its list
+void Game::updateParticles(const DrawList* list, float deltaTime) {
+    deltaTime = std::min(deltaTime, MAX_PARTICLE_STEP);
+    if (list) {
+        bool burstsDone = list->tick == lastBurstTick;
+        for (const ParticleEmitter& emitter : list->emitters) {
+            if (emitter.burst) {
+                if (burstsDone) continue;
+                lastBurstTick = list->tick;
             }
+            particles.emit(emitter, deltaTime);
+        }
     }
-
-
+    particles.update(deltaTime);
 }
 
-// This function renders the game
-void Game::render() {
+// This function renders the game from the newest draw list, with moving
+// objects placed as far between the previous and current step as real time
+// has advanced since that step
+void Game::render(const DrawList* list) {
+    PROFILE_ZONE("Render");
     SDL_SetRenderDrawColor(renderer.get(), 0xFF, 0xFF, 0xFF, 0xFF);
     SDL_RenderClear(renderer.get());
 
@@ -135,263 +189,193 @@ void Game::render() {
     SDL_SetRenderDrawColor(renderer.get(), 0x00, 0x00, 0x00, 0xFF); 
     SDL_RenderFillRect(renderer.get(), NULL);
 
-    if (backgroundTexture) {
-        int newWidth = 1000; // Keep width constant for this approach
-        int newHeight = 634 * scaleFactor;
-        int offsetX = (1000 - newWidth) / 2;
-        int offsetY = (634 - newHeight) / 2;
-
-        SDL_Rect renderQuad = {offsetX, offsetY, newWidth, newHeight};  // Only one quad needed now since we're not moving the image vertically.
-        SDL_RenderCopy(renderer.get(), backgroundTexture.get(), nullptr, &renderQuad);
+    if (list) {
+        lastObstacleCount = list->obstacleCount;
+        lastPlannerStats = list->aiPlanner;
+        lastRollbackStats = list->rollback;
+        drawListRenderer->render(*list, isTextVisible);
     }
-    // For simplicity, rendering on the main thread
-    car1->render(renderer.get());
-    car2->render(renderer.get());
-
-    // Statistics 
-    // For car1
-    renderStatistics(200, 64, "You", car1->speed, car1->distanceCovered);
-
-    // For car2 (positioning it next car1's statistics for clarity)
-    renderStatistics(580, 64, "Computer", car2->speed, car2->distanceCovered);
-
-
-   for (const auto& obstacle : obstacles) {
-    // Check if obstacle is supposed to be visible
-    if (obstacle.isVisible()) {
-        // Create an SDL rectangle with the obstacle's position and dimensions
-        SDL_Rect obstacleRect = { obstacle.positionx, obstacle.positiony, obstacle.screenWidth, obstacle.screenHeight };
+    particleRenderer->draw(*spriteBatch, drawListRenderer->getCameraY(), DrawListRenderer::SCREEN_HEIGHT);
 
-        // Render the obstacle
-        if (SDL_RenderCopy(renderer.get(), obstacleTexture, nullptr, &obstacleRect) < 0) {
-            // SDL_RenderCopy returns -1 on failure. Check the SDL error for more information.
-            std::cerr << "SDL_RenderCopy failed: " << SDL_GetError() << std::endl;
-        }
+    // Loading bar along the bottom while assets stream in
+    if (!assets->isFinished()) {
+        SDL_FRect loadingBar = {0, 628, 1000 * assets->getProgress(), 6};
+        spriteBatch->draw(nullptr, nullptr, loadingBar, SpriteBatch::LAYER_CARS, {0xFF, 0xFF, 0xFF, 0xFF});
     }
+    profilerOverlay.draw(*spriteBatch, *textCache, font);
+    spriteBatch->flush();
+    accumulateDrawStats(spriteBatch->getStats());
+
+    // Draw all queued HUD text in one batch, on top of the scene
+    textCache->flush();
 
-    if (gameState == GameState::GAMEOVER) {
-        renderGameOverMessage();
+    PROFILE_ZONE("Present");
+    SDL_RenderPresent(renderer.get());
+    if (list) {
+        inputSampler.framePresented(list->inputSequence);
     }
 }
 
-    SDL_RenderPresent(renderer.get());
+// Add one frame's batch counters to the running totals
+void Game::accumulateDrawStats(const SpriteBatch::FrameStats& stats) {
+    drawStatsFrames++;
+    drawStatsTotal.sprites += stats.sprites;
+    drawStatsTotal.drawCalls += stats.drawCalls;
+    drawStatsTotal.vertices += stats.vertices;
 }
 
-// Handle user input events
+// Handle user input events; everything that changes the race is forwarded
+// to the simulation thread
 void Game::handleEvents(SDL_Event& e) {
     if (e.type == SDL_QUIT) {
-        gameState = GameState::QUIT;
+        simulationThread->post(SimulationCommandType::Quit);
+        quitRequested = true;
+    } else if (e.type == SDL_RENDER_TARGETS_RESET || e.type == SDL_RENDER_DEVICE_RESET) {
+        backgroundTiles->invalidate(); // The road rows and HUD panels lived in render targets
+        hudLayers->invalidate();
     } else if (e.type == SDL_KEYDOWN) {
+        inputSampler.keyPressed(e.key); // W, S, A and D are read as held keys after the pump
         switch (e.key.keysym.sym) {
             case SDLK_r:
+                // Ignored by the simulation while the race is running
                 std::cout << "Reset key pressed!" << std::endl;
-                if (gameState != GameState::RUNNING) {
-                    gameState = GameState::RESET;
-                    std::cout << "Game state Reset" << std::endl;
-                    // Reset car positions
-                    car1->reset(car1_initial_x, car1_initial_y);
-                    car2->reset(car2_initial_x, car2_initial_y);
-
-                    // Reset obstacle visibility
-                    resetObstaclesVisibility();
-                }
-                break;
+                simulationThread->post(SimulationCommandType::Reset);
+                return;
             case SDLK_RETURN:
-                std::cout << "Starting game!" << std::endl;
-                 if (gameState != GameState::RUNNING) {
-                    gameState = GameState::RUNNING;
-                    std::cout << "Game state changed to RUNNING" << std::endl;
-                    startGame(); // This starts the game
-                } else {
-                    gameState = GameState::STOPPED;
-                    std::cout << "Game state changed to STOPPED" << std::endl;
-                }
-                break;
+                std::cout << "Start/stop key pressed!" << std::endl;
+                startGame(); // This starts or stops the game
+                return;
             case SDLK_b:
                 std::cout << "Stop Game!" << std::endl;
-                break;
-            case SDLK_w:
-                car1->accelerate();  // This increase the car's speed
-                break;
-            case SDLK_s:
-                car1->decelerate();  // This  decrease the car's speed
-                break;
-            case SDLK_d:
-                car1->moveRight(); // This turns the car right
-                break;
-            case SDLK_a:
-                car1->moveLeft(); // This turns the car left
-                break;
-        }
-    }
-}
-
-
-AvoidDirection Game::checkImminentCollision(int carX, int carY, int carWidth, int carHeight, const Obstacle& obstacle) {
-    int dx = carX - obstacle.positionx;
-    int dy = carY - obstacle.positiony;
-    int distance = std::sqrt(dx * dx + dy * dy);
-
-    // Define the road boundaries 
-    int leftBoundary = 450;  // The x-coordinate where the road starts on the left
-    int rightBoundary = 530;  // The x-coordinate where the road ends on the right
-
-    if (distance < 58) {  // 100 is the "imminent collision" distance; adjust as needed
-        if (carX > obstacle.positionx && carX + carWidth < rightBoundary) {
-            return AvoidDirection::Right;
-        } else if (carX < obstacle.positionx && carX > leftBoundary) {
-            return AvoidDirection::Left;
-        } else if (carX + carWidth > rightBoundary) {  // If the car is near the right boundary, force it to move left
-            return AvoidDirection::Left;
-        } else if (carX < leftBoundary) {  // If the car is near the left boundary, force it to move right
-            return AvoidDirection::Right;
+                return;
+            case SDLK_F2:
+#if EVADOR_PROFILING
+                profilerOverlay.toggle();
+#else
+                std::cout << "Built without EVADOR_PROFILING, nothing to show" << std::endl;
+#endif
+                return;
+            case SDLK_F3:
+                // Everything still in the per-thread rings, roughly the last few seconds
+                if (Profiler::writeChromeTrace("evador_trace.json")) {
+                    std::cout << "Wrote evador_trace.json (open in chrome://tracing or ui.perfetto.dev)" << std::endl;
+                } else {
+                    std::cerr << "Could not write evador_trace.json" << std::endl;
+                }
+                return;
+            default:
+                return;
         }
     }
-
-    return AvoidDirection::None;
-}
-// This function is used by car1 for collision detection with obstacles
-bool Game::detectCollision(int carX, int carY, int carWidth, int carHeight, const Obstacle& obstacle) {
-    if (carX < obstacle.positionx + obstacle.screenWidth &&
-        carX + carWidth > obstacle.positionx &&
-        carY < obstacle.positiony + obstacle.screenHeight &&
-        carY + carHeight > obstacle.positiony) {
-        return true; // Collision detected
-    }
-    return false; // No collision
 }
 
-// Render game over blinking message
-void Game::renderGameOverMessage() {
-    if (!isTextVisible) {
-        return; // Don't render the text if it's not visible
-    }
-    // Create a color for the text
-    SDL_Color textColor = {255, 0, 0}; // This is red; you can adjust as needed
-
-    // Create a surface from the text
-    SDL_Surface* textSurface = TTF_RenderText_Solid(largeFont, "You lost to AI", textColor);
-    if (textSurface == nullptr) {
-        std::cerr << "Unable to render text surface! SDL_ttf Error: " << TTF_GetError() << std::endl;
+void Game::initGame() {
+    // Start the worker pool once; it lives as long as the game
+    jobs = std::make_unique<JobSystem>();
+
+    // The race layout changes with every launch unless --seed is given; recordings keep the seed
+    unsigned seed = config.seed != 0 ? config.seed : static_cast<unsigned>(time(nullptr));
+    if (!config.replayPath.empty()) {
+        initReplay();
+    } else if (!config.netplay.empty()) {
+        initNetplay(seed);
     } else {
-        // Convert the surface to a texture
-        SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer.get(), textSurface);
-        if (textTexture == nullptr) {
-            std::cerr << "Unable to create texture from text! SDL Error: " << SDL_GetError() << std::endl;
-        } else {
-            // Render the texture
-            SDL_Rect renderQuad = { (1000 - textSurface->w) / 2, (636 - textSurface->h) / 2, textSurface->w, textSurface->h }; // You can adjust these values to position the text as desired
-            SDL_RenderCopy(renderer.get(), textTexture, nullptr, &renderQuad);
-            
-            // Clean up
-            SDL_DestroyTexture(textTexture);
+        simulation = std::make_unique<Simulation>(seed, jobs.get(), config.raceLength, config.aiCars);
+        simulation->setAiBudgetMicros(config.aiBudgetMicros);
+        simulationThread = std::make_unique<SimulationThread>(*simulation, config.tickRate, config.maxCatchUpSteps);
+        if (!config.recordPath.empty()) {
+            recorder = std::make_unique<ReplayRecorder>();
+            if (recorder->open(config.recordPath, *simulation, static_cast<float>(1.0 / config.tickRate))) {
+                simulationThread->setRecorder(recorder.get());
+                std::cout << "Recording to " << config.recordPath << std::endl;
+            } else {
+                std::cerr << "Could not create " << config.recordPath << ", not recording" << std::endl;
+            }
         }
-        SDL_FreeSurface(textSurface);
     }
-}
 
-// Shows obstacles as cars approach
-void Game::updateObstacleVisibility(int carX, int carY, int startIdx, int endIdx) {
-    for (int i = startIdx; i <= endIdx; ++i) {
-        auto& obstacle = obstacles[i];
-        
-        // If the obstacle is already visible, skip the checks
-        if (obstacle.isVisible()) {
-            continue;
-        }
+    // Initialize SDL and other dependencies
+    initSDL();
 
-        // Calculate distance between car and obstacle
-        int dx = carX - obstacle.positionx;
-        int dy = carY - obstacle.positiony;
-        int distance = std::sqrt(dx * dx + dy * dy);
+    // Initialize cars
+    initCars();
 
-        // Make obstacle visible if the car is within a certain distance
-        if (distance < 200) {  // 200 is the threshold distance; change it as needed
-            obstacle.setVisible(true);
-        }
-    }
+    // Initialize obstacles
+    initObstacles();
+
+    drawListRenderer = std::make_unique<DrawListRenderer>(*spriteBatch, *textCache, *assets);
+    drawListRenderer->setSprite(SpriteId::Background, backgroundAsset);
+    backgroundTiles = std::make_unique<BackgroundTiles>(renderer.get(), *assets, backgroundAsset,
+                                                        SimulationThread::MAX_SCALE);
+    drawListRenderer->setBackgroundTiles(backgroundTiles.get());
+    hudLayers = std::make_unique<HudLayers>(renderer.get(), *textCache);
+    drawListRenderer->setHudLayers(hudLayers.get());
+    drawListRenderer->setSprite(SpriteId::PlayerCar, car1Asset);
+    drawListRenderer->setSprite(SpriteId::AiCar, car2Asset);
+    drawListRenderer->setSprite(SpriteId::Obstacle, obstacleAsset);
+    particleRenderer = std::make_unique<ParticleRenderer>(renderer.get(), particles);
 }
 
-// Reset visibility of obstacles 
-void Game::resetObstaclesVisibility() {
-    for (auto& obstacle : obstacles) {
-        obstacle.setVisible(false);
+// Play a recording: the simulation is rebuilt from its seed and driven by its commands
+void Game::initReplay() {
+    replayFile = std::make_unique<ReplayFile>();
+    std::string error;
+    if (!replayFile->load(config.replayPath, error)) {
+        std::cerr << "Could not load replay " << config.replayPath << ": " << error << std::endl;
+        exit(1);
+    }
+    const ReplayHeader& header = replayFile->header;
+    simulation = std::make_unique<Simulation>(header.seed, jobs.get(), static_cast<int>(header.raceLength),
+                                              static_cast<int>(header.aiCars));
+    replayPlayer = std::make_unique<ReplayPlayer>(*replayFile, *simulation);
+    // Seeking restores a keyframe, which also carries the AI budget the session ran with
+    if (!replayPlayer->seek(static_cast<uint64_t>(config.replayStart))) {
+        std::cerr << "Replay ends before step " << config.replayStart << std::endl;
     }
+    simulationThread = std::make_unique<SimulationThread>(*simulation, static_cast<int>(header.tickRate), config.maxCatchUpSteps);
+    simulationThread->setReplay(replayPlayer.get(), static_cast<float>(config.replaySpeed));
+    std::cout << "Replaying " << config.replayPath << " (" << replayFile->endTick << " steps) at "
+              << config.replaySpeed << "x; Enter pauses" << std::endl;
 }
 
+// Race a remote player: the AI car becomes theirs, driven through a rollback session
+void Game::initNetplay(unsigned seed) {
+    bool hosting = config.netplay == "host";
+    std::string peerHost = "127.0.0.1";
+    int peerPort = hosting ? 7778 : 7777;
+    if (!config.netPeer.empty()) {
+        size_t colon = config.netPeer.rfind(':');
+        peerHost = config.netPeer.substr(0, colon);
+        if (colon != std::string::npos) {
+            peerPort = std::atoi(config.netPeer.c_str() + colon + 1);
+        }
+    }
+    int localPort = config.netPort != 0 ? config.netPort : hosting ? 7777 : 7778;
 
-void Game::renderStatistics(int x, int y, const std::string &carName, float carSpeed, float carDistance) {
-    SDL_Color textColor = {255, 255, 255}; // White color
-
-    float roundedCarSpeed = floor(carSpeed * 100) / 100.0f;
-    float roundedCarDistance = floor(carDistance * 100) / 100.0f;
-
-    std::ostringstream speedStream;
-    speedStream << std::fixed << std::setprecision(2) << roundedCarSpeed;
-    std::string speedText = carName + " Speed: " + speedStream.str();
-
-    std::ostringstream distanceStream;
-    distanceStream << std::fixed << std::setprecision(2) << roundedCarDistance;
-    std::string distanceText = carName + " Distance: " + distanceStream.str();
-  
-
-
-    SDL_Surface* speedSurface = TTF_RenderText_Solid(font, speedText.c_str(), textColor);
-    if (!speedSurface) {
-        // Handle error, maybe log it or return
-        return;
+    netLink = std::make_unique<UdpLink>();
+    std::string error;
+    if (!netLink->open(localPort, peerHost, peerPort, error)) {
+        std::cerr << "Netplay: " << error << std::endl;
+        exit(1);
     }
-    
-    SDL_Texture* speedTexture = SDL_CreateTextureFromSurface(renderer.get(), speedSurface);
-    int speedWidth = speedSurface->w;
-    int speedHeight = speedSurface->h;
-
-    if (!speedSurface) {
-    std::cout << "Failed to create speedSurface: " << TTF_GetError() << std::endl;
-    return;
+    netLink->setSimulatedDelay(config.netDelay);
+
+    // Rolling back re-runs steps inside one tick; without the job system they do not allocate
+    simulation = std::make_unique<Simulation>(seed, nullptr, config.raceLength, 1);
+    netSession = std::make_unique<RollbackSession>(*simulation, *netLink, hosting ? 0 : 1,
+                                                   static_cast<float>(1.0 / config.tickRate));
+    simulationThread = std::make_unique<SimulationThread>(*simulation, config.tickRate, config.maxCatchUpSteps);
+    simulationThread->setNetplay(netSession.get());
+    if (!config.recordPath.empty()) {
+        std::cerr << "Recording is not supported in netplay, not recording" << std::endl;
     }
-
-
-
-    SDL_FreeSurface(speedSurface);
-
-    SDL_Surface* distanceSurface = TTF_RenderText_Solid(font, distanceText.c_str(), textColor);
-    if (!distanceSurface) {
-        // Handle error, maybe log it or return
-        SDL_DestroyTexture(speedTexture);
-        return;
+    if (hosting) {
+        std::cout << "Hosting a race with seed " << seed;
+    } else {
+        std::cout << "Joining a race, seed from the host,";
     }
-    SDL_Texture* distanceTexture = SDL_CreateTextureFromSurface(renderer.get(), distanceSurface);
-    int distanceWidth = distanceSurface->w;
-    int distanceHeight = distanceSurface->h;
-    SDL_FreeSurface(distanceSurface);
-if (!distanceSurface) {
-    std::cout << "Failed to create distanceSurface: " << TTF_GetError() << std::endl;
-    return;
-}
-    // Render the speed text
-    SDL_Rect speedRenderQuad = {x, y, speedWidth, speedHeight};
-    SDL_RenderCopy(renderer.get(), speedTexture, nullptr, &speedRenderQuad);
-
-    SDL_DestroyTexture(speedTexture); 
-
-    // Render the distance text below the speed
-    SDL_Rect distanceRenderQuad = {x, y + speedHeight + 10, distanceWidth, distanceHeight};
-    SDL_RenderCopy(renderer.get(), distanceTexture, nullptr, &distanceRenderQuad);
-
-    SDL_DestroyTexture(distanceTexture); 
-}
-
-
-void Game::initGame() {
-    // Initialize SDL and other dependencies
-    initSDL();
-
-    // Initialize cars
-    initCars();
-
-    // Initialize obstacles
-    initObstacles();
+    std::cout << " on port " << localPort << ", peer " << peerHost << ":" << peerPort
+              << "; it starts when both sides are up" << std::endl;
 }
 
 void Game::initSDL() {
@@ -411,9 +395,14 @@ void Game::initSDL() {
         exit(1);
     }
 
-    // Create an SDL renderer and wrap it in a shared_ptr
+    // Create an SDL renderer and wrap it in a shared_ptr; only vsync pacing
+    // lets present wait for the display, the other modes are paced by framePacer
+    Uint32 rendererFlags = SDL_RENDERER_ACCELERATED;
+    if (config.pacing == PacingMode::VSync) {
+        rendererFlags |= SDL_RENDERER_PRESENTVSYNC;
+    }
     renderer = std::shared_ptr<SDL_Renderer>(
-    SDL_CreateRenderer(window.get(), -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC),
+    SDL_CreateRenderer(window.get(), -1, rendererFlags),
     SDL_DestroyRenderer);
 
     if (renderer == nullptr) {
@@ -421,65 +410,70 @@ void Game::initSDL() {
         exit(1);
     }
 
+    // Some renderers (software, some drivers) ignore vsync; cap at the display's refresh rate instead
+    SDL_RendererInfo info;
+    if (config.pacing == PacingMode::VSync && SDL_GetRendererInfo(renderer.get(), &info) == 0 &&
+        !(info.flags & SDL_RENDERER_PRESENTVSYNC)) {
+        SDL_DisplayMode display;
+        int refreshRate = 60;
+        if (SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(window.get()), &display) == 0 && display.refresh_rate > 0) {
+            refreshRate = display.refresh_rate;
+        }
+        std::cerr << "Renderer has no vsync, capping at " << refreshRate << " fps instead" << std::endl;
+        framePacer.setMode(PacingMode::Capped, refreshRate);
+    }
+
     if (TTF_Init() == -1) {
         std::cerr << "SDL_ttf could not initialize! SDL_ttf Error: " << TTF_GetError() << std::endl;
     }
 
-    font = TTF_OpenFont("assets/fonts/open_sans/OpenSans-VariableFont_wdth,wght.ttf", 24); // 24 is the font size
-    largeFont =  TTF_OpenFont("assets/fonts/open_sans/OpenSans-VariableFont_wdth,wght.ttf", 34); 
+    spriteBatch = std::make_unique<SpriteBatch>(renderer.get());
+    textCache = std::make_unique<TextCache>(renderer.get());
 
-    if (!font || !largeFont) {
-        std::cout << "Failed to load font: " << TTF_GetError() << std::endl;
-        return;
+    // Everything below loads in the background; the window is drawn from the first frame
+    assets = std::make_unique<AssetManager>(renderer.get(), textCache.get());
+    if (!assets->loadPack("assets/evador.pack")) {
+        std::cerr << "No usable asset pack, decoding the assets instead" << std::endl;
     }
+    fontAsset = assets->requestFont("assets/fonts/open_sans/OpenSans-VariableFont_wdth,wght.ttf", 24); // 24 is the font size
+    largeFontAsset = assets->requestFont("assets/fonts/open_sans/OpenSans-VariableFont_wdth,wght.ttf", 34);
 
-    scaleFactor = 1.0f; //1.0f // Initialize the scale factor to 1 (original size)
-    // Load the background texture from the provided path
-    backgroundTexture = std::shared_ptr<SDL_Texture>(loadTexture("/Applications/dev/cplusplus/evador/assets/evador.png"), SDL_DestroyTexture);
-
-
+    backgroundAsset = assets->requestTexture("assets/evador.png");
 }
 
 void Game::initCars() {
-    car1 = std::make_shared<Car>(car1_initial_x, car1_initial_y, "/Applications/dev/cplusplus/evador/assets/car_1.png", renderer.get());
-    car2 = std::make_shared<Car>(car2_initial_x, car2_initial_y, "/Applications/dev/cplusplus/evador/assets/car_2.png", renderer.get());
+    car1Asset = assets->requestTexture("assets/car_1.png");
+    car2Asset = assets->requestTexture("assets/car_2.png");
 }
 
 void Game::initObstacles() {
-    SDL_Surface* loadedobstacleTextureSurface = IMG_Load("/Applications/dev/cplusplus/evador/assets/obstacle.png");
-    if (loadedobstacleTextureSurface) {
-        obstacleTexture = SDL_CreateTextureFromSurface(renderer.get(), loadedobstacleTextureSurface);
-        SDL_FreeSurface(loadedobstacleTextureSurface);
-    } else {
-        std::cerr << "Image Load Failed: " << IMG_GetError() << std::endl;
-    }
-
-    const int OBSTACLE_WIDTH = 42; // Set this to the width of your obstacle
-    const int OBSTACLE_HEIGHT = 42; // Set this to the height of your obstacle
-
-    obstacles.emplace_back(Obstacle(350, 400, obstacleTexture, OBSTACLE_WIDTH, OBSTACLE_HEIGHT));
-    obstacles.emplace_back(Obstacle(440, 250, obstacleTexture,  OBSTACLE_WIDTH, OBSTACLE_HEIGHT));
-    obstacles.emplace_back(Obstacle(420, 90, obstacleTexture,  OBSTACLE_WIDTH, OBSTACLE_HEIGHT));
-    obstacles.emplace_back(Obstacle(620, 400, obstacleTexture, OBSTACLE_WIDTH, OBSTACLE_HEIGHT));
-    obstacles.emplace_back(Obstacle(500, 260, obstacleTexture, OBSTACLE_WIDTH, OBSTACLE_HEIGHT));
-    obstacles.emplace_back(Obstacle(540, 90, obstacleTexture, OBSTACLE_WIDTH, OBSTACLE_HEIGHT));
+    obstacleAsset = assets->requestTexture("assets/obstacle.png");
 }
 
-// Load a texture from the given path
-SDL_Texture* Game::loadTexture(const std::string &path) {
-    SDL_Texture* newTexture = nullptr;
-    SDL_Surface* loadedSurface = IMG_Load(path.c_str());
-    if (loadedSurface) {
-        newTexture = SDL_CreateTextureFromSurface(renderer.get(), loadedSurface);
-        SDL_FreeSurface(loadedSurface);
+// Upload what the loaders finished and pick up the fonts once they are in
+void Game::updateAssets() {
+    assets->uploadPending();
+    font = assets->getFontId(fontAsset);
+    largeFont = assets->getFontId(largeFontAsset);
+    drawListRenderer->setFonts(font, largeFont);
+
+    if (!assetsReported && assets->isFinished()) {
+        assets->reportLoadTimes();
+        assetsReported = true;
     }
-    return newTexture;
 }
 
 // Destructor for the Game class
 Game::~Game() {
-    SDL_Quit();  // Clean up SDL
-    TTF_CloseFont(font);
+    simulationThread.reset(); // Joins the simulation thread before the simulation goes away
+    netSession.reset(); // Refers to the simulation and the link
+    recorder.reset(); // Finishes the recording
+    drawListRenderer.reset();
+    backgroundTiles.reset(); // Frees the tile texture while the renderer still exists
+    hudLayers.reset();
+    particleRenderer.reset(); // Frees the particle textures while the renderer still exists
+    assets.reset(); // Stops the loaders and frees the textures while the renderer still exists
+    textCache.reset(); // Closes the fonts and frees the glyph atlas
     TTF_Quit();
-    font = nullptr;
+    SDL_Quit();  // Clean up SDL
 }
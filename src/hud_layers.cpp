@@ -0,0 +1,158 @@
+#include "hud_layers.h"
+#include "profiler.h"
+#include <algorithm>
+#include <climits>
+#include <iostream>
+
+namespace {
+// Glyphs may reach a little past their advance
+const int PANEL_MARGIN = 4;
+
+// Panel textures grow in steps of this many pixels, so small changes in width reuse them
+const int TEXTURE_GRANULARITY = 64;
+
+int roundUp(int value) {
+    return (value + TEXTURE_GRANULARITY - 1) / TEXTURE_GRANULARITY * TEXTURE_GRANULARITY;
+}
+}
+
+// Constructor
+HudLayers::HudLayers(SDL_Renderer* renderer, TextCache& textCache)
+    : renderer(renderer), textCache(textCache), supported(SDL_RenderTargetSupported(renderer) == SDL_TRUE) {
+}
+
+// Destructor
+HudLayers::~HudLayers() {
+    for (Panel& panel : panels) {
+        if (panel.texture) {
+            SDL_DestroyTexture(panel.texture);
+        }
+    }
+}
+
+// Empty every panel, keeping the string buffers
+void HudLayers::beginFrame() {
+    for (Panel& panel : panels) {
+        panel.lineCount = 0;
+    }
+}
+
+// Collect one line
+void HudLayers::addText(HudPanel panel, int fontId, int x, int y, const char* text, SDL_Color color) {
+    Panel& target = panels[static_cast<size_t>(panel)];
+    if (target.lineCount == target.lines.size()) {
+        target.lines.emplace_back();
+    }
+    Line& line = target.lines[target.lineCount++];
+    line.fontId = fontId;
+    line.x = x;
+    line.y = y;
+    line.color = color;
+    line.text.assign(text);
+}
+
+// Same lines, fonts, places and colours as when the texture was rendered
+bool HudLayers::upToDate(const Panel& panel) const {
+    if (!panel.valid || panel.lineCount != panel.cached.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < panel.lineCount; ++i) {
+        const Line& a = panel.lines[i];
+        const Line& b = panel.cached[i];
+        if (a.fontId != b.fontId || a.x != b.x || a.y != b.y || a.text != b.text ||
+            a.color.r != b.color.r || a.color.g != b.color.g || a.color.b != b.color.b || a.color.a != b.color.a) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Draw the lines into the panel's texture, growing it when they no longer fit
+bool HudLayers::render(Panel& panel, SpriteBatch& batch) {
+    PROFILE_ZONE("Render HUD panel");
+    int left = INT_MAX, top = INT_MAX, right = INT_MIN, bottom = INT_MIN;
+    for (size_t i = 0; i < panel.lineCount; ++i) {
+        const Line& line = panel.lines[i];
+        left = std::min(left, line.x);
+        top = std::min(top, line.y);
+        right = std::max(right, line.x + textCache.measureText(line.fontId, line.text.c_str()));
+        bottom = std::max(bottom, line.y + textCache.lineHeight(line.fontId));
+    }
+    panel.bounds = {left - PANEL_MARGIN, top - PANEL_MARGIN, right - left + 2 * PANEL_MARGIN,
+                    bottom - top + 2 * PANEL_MARGIN};
+
+    if (panel.bounds.w > panel.textureWidth || panel.bounds.h > panel.textureHeight) {
+        if (panel.texture) {
+            batch.forgetTexture(panel.texture);
+            SDL_DestroyTexture(panel.texture);
+        }
+        panel.textureWidth = roundUp(panel.bounds.w);
+        panel.textureHeight = roundUp(panel.bounds.h);
+        panel.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                          panel.textureWidth, panel.textureHeight);
+        if (!panel.texture) {
+            std::cerr << "Could not create a HUD panel texture, drawing the HUD directly: " << SDL_GetError() << std::endl;
+            panel.textureWidth = panel.textureHeight = 0;
+            supported = false;
+            return false;
+        }
+        // The glyphs are already blended into the texture against transparent
+        // black, so its colours are premultiplied by their alpha
+        SDL_BlendMode premultiplied = SDL_ComposeCustomBlendMode(
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD,
+            SDL_BLENDFACTOR_ONE, SDL_BLENDFACTOR_ONE_MINUS_SRC_ALPHA, SDL_BLENDOPERATION_ADD);
+        if (SDL_SetTextureBlendMode(panel.texture, premultiplied) != 0) {
+            SDL_SetTextureBlendMode(panel.texture, SDL_BLENDMODE_BLEND);  // Edges come out a little darker
+        }
+    }
+
+    SDL_Texture* previousTarget = SDL_GetRenderTarget(renderer);
+    SDL_SetRenderTarget(renderer, panel.texture);
+    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0x00);
+    SDL_RenderClear(renderer);
+    for (size_t i = 0; i < panel.lineCount; ++i) {
+        const Line& line = panel.lines[i];
+        textCache.drawText(line.fontId, line.x - panel.bounds.x, line.y - panel.bounds.y, line.text.c_str(), line.color);
+    }
+    textCache.flush();
+    SDL_SetRenderTarget(renderer, previousTarget);
+
+    panel.cached.assign(panel.lines.begin(), panel.lines.begin() + static_cast<std::ptrdiff_t>(panel.lineCount));
+    panel.valid = true;
+    return true;
+}
+
+// Re-render what changed, then composite
+bool HudLayers::compose(SpriteBatch& batch, int layer) {
+    if (!supported) {
+        return false;
+    }
+    for (Panel& panel : panels) {
+        if (panel.lineCount == 0) {
+            continue;  // Hidden this frame (a blinking banner); the texture is kept
+        }
+        if (upToDate(panel)) {
+            stats.hits++;
+        } else {
+            stats.misses++;
+            if (!render(panel, batch)) {
+                continue;
+            }
+        }
+        if (panel.bounds.w <= 0 || panel.bounds.h <= 0) {
+            continue;
+        }
+        SDL_Rect source = {0, 0, panel.bounds.w, panel.bounds.h};
+        SDL_FRect quad = {static_cast<float>(panel.bounds.x), static_cast<float>(panel.bounds.y),
+                          static_cast<float>(panel.bounds.w), static_cast<float>(panel.bounds.h)};
+        batch.draw(panel.texture, &source, quad, layer);
+    }
+    return true;
+}
+
+// Forget what every texture shows
+void HudLayers::invalidate() {
+    for (Panel& panel : panels) {
+        panel.valid = false;
+    }
+}
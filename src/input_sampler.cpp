@@ -0,0 +1,110 @@
+#include "input_sampler.h"
+#include "percentile.h"
+#include <algorithm>
+
+namespace {
+// Presses still waiting for their frame; older ones are dropped past this
+const size_t MAX_PENDING = 64;
+
+// Which control a key drives, by physical position so other layouts keep WASD
+bool* controlOf(PlayerInput& input, SDL_Scancode key) {
+    switch (key) {
+        case SDL_SCANCODE_W: return &input.accelerate;
+        case SDL_SCANCODE_S: return &input.decelerate;
+        case SDL_SCANCODE_A: return &input.steerLeft;
+        case SDL_SCANCODE_D: return &input.steerRight;
+        default: return nullptr;
+    }
+}
+
+bool sameControls(const PlayerInput& a, const PlayerInput& b) {
+    return a.accelerate == b.accelerate && a.decelerate == b.decelerate &&
+           a.steerLeft == b.steerLeft && a.steerRight == b.steerRight;
+}
+}
+
+// Constructor
+InputSampler::InputSampler() : counterFrequency(static_cast<double>(SDL_GetPerformanceFrequency())) {
+    pending.reserve(MAX_PENDING);
+    latencyMillis.reserve(MAX_SAMPLES);
+}
+
+// Note a press and when SDL queued it
+void InputSampler::keyPressed(const SDL_KeyboardEvent& event) {
+    bool* control = controlOf(tapped, event.keysym.scancode);
+    if (!control || event.repeat) {
+        return;
+    }
+    *control = true;
+
+    // The event's timestamp is in SDL_GetTicks milliseconds; move it onto the
+    // high-resolution counter so time spent in the event queue is included
+    Uint64 now = SDL_GetPerformanceCounter();
+    Uint32 queuedMillis = SDL_GetTicks() - event.timestamp;
+    Uint64 queued = static_cast<Uint64>(queuedMillis * counterFrequency / 1000.0);
+    Uint64 pressedAt = queued < now ? now - queued : now;
+    if (!pressed || pressedAt < firstPressAt) {
+        firstPressAt = pressedAt;
+    }
+    pressed = true;
+}
+
+// Read the keyboard state SDL kept up to date during the pump
+bool InputSampler::sample(SimulationCommand& command) {
+    const Uint8* keys = SDL_GetKeyboardState(nullptr);
+    PlayerInput now;
+    for (SDL_Scancode key : {SDL_SCANCODE_W, SDL_SCANCODE_S, SDL_SCANCODE_A, SDL_SCANCODE_D}) {
+        *controlOf(now, key) = keys[key] != 0 || *controlOf(tapped, key);
+    }
+
+    bool changed = !sameControls(now, held);
+    if (changed) {
+        held = now;
+        command = SimulationCommand();
+        command.type = SimulationCommandType::Controls;
+        command.input = now;
+        // The release may reach the simulation before it steps; the taps keep the press for one step
+        command.tapped = tapped;
+        if (pressed) {
+            command.inputSequence = nextSequence++;
+            if (pending.size() == MAX_PENDING) {
+                pending.erase(pending.begin());
+            }
+            pending.push_back({command.inputSequence, firstPressAt});
+        }
+    }
+    tapped = PlayerInput();
+    pressed = false;
+    return changed;
+}
+
+// Every press the presented frame shows is done
+void InputSampler::framePresented(uint32_t inputSequence) {
+    if (pending.empty() || pending.front().sequence > inputSequence) {
+        return;
+    }
+    Uint64 now = SDL_GetPerformanceCounter();
+    size_t done = 0;
+    while (done < pending.size() && pending[done].sequence <= inputSequence) {
+        if (latencyMillis.size() < MAX_SAMPLES) {
+            latencyMillis.push_back(static_cast<float>((now - pending[done].pressedAt) * 1000.0 / counterFrequency));
+        }
+        ++done;
+    }
+    pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(done));
+}
+
+// Sort and read the percentiles
+InputSampler::Stats InputSampler::takeStats() {
+    Stats stats;
+    stats.presses = static_cast<int>(latencyMillis.size());
+    if (latencyMillis.empty()) {
+        return stats;
+    }
+    std::sort(latencyMillis.begin(), latencyMillis.end());
+    stats.p50Millis = percentile(latencyMillis, 0.50);
+    stats.p99Millis = percentile(latencyMillis, 0.99);
+    stats.maxMillis = latencyMillis.back();
+    latencyMillis.clear();
+    return stats;
+}
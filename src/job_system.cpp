@@ -0,0 +1,222 @@
+#include "job_system.h"
+#include "profiler.h"
+#include <algorithm>
+
+namespace {
+// Index of the queue owned by the current thread; outside threads have none
+thread_local int currentQueue = -1;
+}
+
+// Constructor: start the workers, each with its own deque
+JobSystem::JobSystem(unsigned workerCount) {
+    if (workerCount == 0) {
+        unsigned hardware = std::thread::hardware_concurrency();
+        workerCount = hardware > 1 ? hardware - 1 : 1;
+    }
+
+    for (unsigned i = 0; i <= workerCount; ++i) {
+        queues.push_back(std::make_unique<WorkQueue>());
+        timingTables.push_back(std::make_unique<TimingTable>());
+    }
+    for (unsigned i = 0; i < workerCount; ++i) {
+        workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+// Destructor
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeCondition.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Push a task onto the caller's deque, or round-robin for outside threads
+void JobSystem::run(TaskGroup& group, const char* name, Task task) {
+    if (group.pending.fetch_add(1, std::memory_order_relaxed) == 0) {
+        group.forkTime = std::chrono::steady_clock::now();
+    }
+
+    unsigned target = currentQueue >= 0
+        ? static_cast<unsigned>(currentQueue)
+        : nextQueue.fetch_add(1, std::memory_order_relaxed) % queues.size();
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->pushBack(Job{std::move(task), &group, name});
+    }
+    queuedJobs.fetch_add(1, std::memory_order_release);
+    {
+        // Pairs with the predicate check in workerLoop so a wakeup cannot be lost
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeCondition.notify_one();
+}
+
+// Help with pending work until every task of the group has finished
+void JobSystem::wait(TaskGroup& group) {
+    PROFILE_ZONE(group.name);
+    unsigned home = currentQueue >= 0 ? static_cast<unsigned>(currentQueue) : workerCount();
+    Job job;
+    while (group.pending.load(std::memory_order_acquire) > 0) {
+        if (popOrSteal(home, job)) {
+            execute(job);
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    recordTiming(group.name, true, std::chrono::steady_clock::now() - group.forkTime);
+}
+
+// Take the newest job of our own deque, otherwise the oldest job of another
+bool JobSystem::popOrSteal(unsigned home, Job& job) {
+    if (queuedJobs.load(std::memory_order_acquire) <= 0) {
+        return false;
+    }
+
+    {
+        WorkQueue& own = *queues[home];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.count > 0) {
+            own.popBack(job);
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    for (size_t offset = 1; offset < queues.size(); ++offset) {
+        WorkQueue& victim = *queues[(home + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.count > 0) {
+            victim.popFront(job);
+            queuedJobs.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Append, doubling the ring when it is full
+void JobSystem::WorkQueue::pushBack(Job&& job) {
+    if (count == ring.size()) {
+        std::vector<Job> grown(ring.empty() ? 16 : ring.size() * 2);
+        for (size_t i = 0; i < count; ++i) {
+            grown[i] = std::move(ring[(head + i) % ring.size()]);
+        }
+        ring.swap(grown);
+        head = 0;
+    }
+    ring[(head + count) % ring.size()] = std::move(job);
+    count++;
+}
+
+// Take the newest job
+void JobSystem::WorkQueue::popBack(Job& job) {
+    count--;
+    job = std::move(ring[(head + count) % ring.size()]);
+}
+
+// Take the oldest job
+void JobSystem::WorkQueue::popFront(Job& job) {
+    job = std::move(ring[head]);
+    head = (head + 1) % ring.size();
+    count--;
+}
+
+// Run one job, time it and signal its group
+void JobSystem::execute(Job& job) {
+    auto start = std::chrono::steady_clock::now();
+    {
+        PROFILE_ZONE(job.name);
+        job.task();
+    }
+    recordTiming(job.name, false, std::chrono::steady_clock::now() - start);
+
+    job.task = nullptr;
+    job.group->pending.fetch_sub(1, std::memory_order_release);
+}
+
+// Worker thread: run jobs while there are any, sleep otherwise
+void JobSystem::workerLoop(unsigned index) {
+    currentQueue = static_cast<int>(index);
+    PROFILE_THREAD("worker " + std::to_string(index));
+    Job job;
+    while (true) {
+        if (popOrSteal(index, job)) {
+            execute(job);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeCondition.wait(lock, [this]() {
+            return stopping || queuedJobs.load(std::memory_order_acquire) > 0;
+        });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+// Accumulate the duration of one task or group in the calling thread's
+// table. Outside threads share the last table, so every update is atomic.
+void JobSystem::recordTiming(const char* name, bool wall, std::chrono::steady_clock::duration elapsed) {
+    TimingTable& table = *timingTables[currentQueue >= 0 ? static_cast<size_t>(currentQueue) : workers.size()];
+    for (TimingSlot& slot : wall ? table.walls : table.tasks) {
+        const char* owner = slot.name.load(std::memory_order_acquire);
+        if (owner == nullptr && slot.name.compare_exchange_strong(owner, name, std::memory_order_acq_rel)) {
+            owner = name;
+        }
+        if (owner != name) {
+            continue;
+        }
+
+        uint64_t nanos = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+        slot.count.fetch_add(1, std::memory_order_relaxed);
+        slot.totalNanos.fetch_add(nanos, std::memory_order_relaxed);
+        uint64_t longest = slot.maxNanos.load(std::memory_order_relaxed);
+        while (nanos > longest && !slot.maxNanos.compare_exchange_weak(longest, nanos, std::memory_order_relaxed)) {
+        }
+        return;
+    }
+}
+
+// Add the counters of one thread's slots to the totals by name, and zero them
+void JobSystem::mergeTimings(std::array<TimingSlot, TIMING_SLOTS>& slots, const char* suffix,
+                             std::map<std::string, TaskTiming>& merged) {
+    for (TimingSlot& slot : slots) {
+        const char* name = slot.name.load(std::memory_order_acquire);
+        if (name == nullptr) {
+            return;
+        }
+        uint64_t count = slot.count.exchange(0, std::memory_order_relaxed);
+        if (count == 0) {
+            continue;
+        }
+        std::string key = std::string(name) + suffix;
+        TaskTiming& timing = merged[key];
+        timing.name = key;
+        timing.count += count;
+        timing.totalMicros += slot.totalNanos.exchange(0, std::memory_order_relaxed) / 1000.0;
+        timing.maxMicros = std::max(timing.maxMicros, slot.maxNanos.exchange(0, std::memory_order_relaxed) / 1000.0);
+    }
+}
+
+// Hand the timings collected by every thread to the caller and start a new window
+std::vector<TaskTiming> JobSystem::takeTimings() {
+    std::map<std::string, TaskTiming> merged;
+    for (auto& table : timingTables) {
+        mergeTimings(table->tasks, "", merged);
+        mergeTimings(table->walls, " (wall)", merged);
+    }
+
+    std::vector<TaskTiming> result;
+    result.reserve(merged.size());
+    for (auto& entry : merged) {
+        result.push_back(entry.second);
+    }
+    return result;
+}
@@ -1,9 +1,13 @@
+#include "config.h"
 #include "game.h"
 
 int main(int argc, char* args[]) {
 
+    // Read settings such as the simulation tick rate
+    GameConfig config = parseCommandLine(argc, args);
+
     // Initialize the game
-    Game game;
+    Game game(config);
 
     // Run the game
     game.run();
@@ -0,0 +1,345 @@
+#include "obstacle_field.h"
+#include "simd_dispatch.h"
+#include "state_buffer.h"
+#include <algorithm>
+
+namespace {
+
+// Box edges shared by the kernels
+struct Box {
+    int32_t left, top, right, bottom;
+};
+
+// One obstacle at a time; finishes the obstacles left after the last full vector
+int overlapScalar(const int32_t* lefts, const int32_t* tops, const int32_t* rights, const int32_t* bottoms,
+                  size_t begin, size_t end, const Box& box) {
+    for (size_t i = begin; i < end; ++i) {
+        if (box.left < rights[i] && box.right > lefts[i] &&
+            box.top < bottoms[i] && box.bottom > tops[i]) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+#ifdef EVADOR_X86_SIMD
+
+// Overlap mask of 8 obstacles starting at index i, one bit per obstacle
+__attribute__((target("avx2")))
+inline int overlapMaskAvx2(const int32_t* lefts, const int32_t* tops, const int32_t* rights, const int32_t* bottoms,
+                           size_t i, __m256i boxLeft, __m256i boxTop, __m256i boxRight, __m256i boxBottom) {
+    __m256i hit = _mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rights + i)), boxLeft);
+    hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(boxRight, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lefts + i))));
+    hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(bottoms + i)), boxTop));
+    hit = _mm256_and_si256(hit, _mm256_cmpgt_epi32(boxBottom, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tops + i))));
+    return _mm256_movemask_ps(_mm256_castsi256_ps(hit));
+}
+
+// 8 obstacles per compare, two blocks (16 obstacles) per iteration
+__attribute__((target("avx2")))
+int overlapAvx2(const int32_t* lefts, const int32_t* tops, const int32_t* rights, const int32_t* bottoms,
+                size_t begin, size_t end, const Box& box) {
+    const __m256i boxLeft = _mm256_set1_epi32(box.left);
+    const __m256i boxTop = _mm256_set1_epi32(box.top);
+    const __m256i boxRight = _mm256_set1_epi32(box.right);
+    const __m256i boxBottom = _mm256_set1_epi32(box.bottom);
+
+    size_t i = begin;
+    for (; i + 16 <= end; i += 16) {
+        int low = overlapMaskAvx2(lefts, tops, rights, bottoms, i, boxLeft, boxTop, boxRight, boxBottom);
+        int high = overlapMaskAvx2(lefts, tops, rights, bottoms, i + 8, boxLeft, boxTop, boxRight, boxBottom);
+        if (low | high) {
+            int mask = low | (high << 8);
+            return static_cast<int>(i) + __builtin_ctz(mask);
+        }
+    }
+    for (; i + 8 <= end; i += 8) {
+        int mask = overlapMaskAvx2(lefts, tops, rights, bottoms, i, boxLeft, boxTop, boxRight, boxBottom);
+        if (mask) {
+            return static_cast<int>(i) + __builtin_ctz(mask);
+        }
+    }
+    return overlapScalar(lefts, tops, rights, bottoms, i, end, box);
+}
+
+// 4 obstacles per compare, one block per iteration
+__attribute__((target("sse2")))
+int overlapSse2(const int32_t* lefts, const int32_t* tops, const int32_t* rights, const int32_t* bottoms,
+                size_t begin, size_t end, const Box& box) {
+    const __m128i boxLeft = _mm_set1_epi32(box.left);
+    const __m128i boxTop = _mm_set1_epi32(box.top);
+    const __m128i boxRight = _mm_set1_epi32(box.right);
+    const __m128i boxBottom = _mm_set1_epi32(box.bottom);
+
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128i hit = _mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rights + i)), boxLeft);
+        hit = _mm_and_si128(hit, _mm_cmpgt_epi32(boxRight, _mm_loadu_si128(reinterpret_cast<const __m128i*>(lefts + i))));
+        hit = _mm_and_si128(hit, _mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(bottoms + i)), boxTop));
+        hit = _mm_and_si128(hit, _mm_cmpgt_epi32(boxBottom, _mm_loadu_si128(reinterpret_cast<const __m128i*>(tops + i))));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(hit));
+        if (mask) {
+            return static_cast<int>(i) + __builtin_ctz(mask);
+        }
+    }
+    return overlapScalar(lefts, tops, rights, bottoms, i, end, box);
+}
+
+using OverlapKernel = int (*)(const int32_t*, const int32_t*, const int32_t*, const int32_t*,
+                              size_t, size_t, const Box&);
+
+// Kernel for an instruction set
+OverlapKernel overlapKernel(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx2: return overlapAvx2;
+        case SimdLevel::Sse2: return overlapSse2;
+        default: return overlapScalar;
+    }
+}
+
+#endif // EVADOR_X86_SIMD
+
+} // namespace
+
+// Append an obstacle
+size_t ObstacleField::add(int x, int y, int width, int height, int road) {
+    lefts.push_back(x);
+    tops.push_back(y);
+    rights.push_back(x + width);
+    bottoms.push_back(y + height);
+    flags.push_back(0);
+    roads.push_back(static_cast<uint8_t>(road));
+    size_t index = lefts.size() - 1;
+    grid.reserveFor(width, height);
+    grid.insert(static_cast<int>(index), x, y, width, height);
+    return index;
+}
+
+// Remove every obstacle
+void ObstacleField::clear() {
+    lefts.clear();
+    tops.clear();
+    rights.clear();
+    bottoms.clear();
+    flags.clear();
+    roads.clear();
+    grid.clear();
+}
+
+// Copy of one obstacle
+Obstacle ObstacleField::get(size_t index) const {
+    Obstacle obstacle;
+    obstacle.positionx = getX(index);
+    obstacle.positiony = getY(index);
+    obstacle.screenWidth = getWidth(index);
+    obstacle.screenHeight = getHeight(index);
+    obstacle.visible = isVisible(index);
+    return obstacle;
+}
+
+// Set the visibility of one obstacle
+void ObstacleField::setVisible(size_t index, bool visibility) {
+    if (visibility) {
+        flags[index] |= VISIBLE;
+    } else {
+        flags[index] &= static_cast<uint8_t>(~VISIBLE);
+    }
+}
+
+// Move one obstacle, keeping its size
+void ObstacleField::setPosition(size_t index, int x, int y) {
+    int width = getWidth(index);
+    int height = getHeight(index);
+    grid.update(static_cast<int>(index), lefts[index], tops[index], x, y, width, height);
+    lefts[index] = x;
+    tops[index] = y;
+    rights[index] = x + width;
+    bottoms[index] = y + height;
+}
+
+// Keyframe state: positions and flags, since sizes and roads never change
+void ObstacleField::saveState(StateWriter& writer) const {
+    writer.u32(static_cast<uint32_t>(size()));
+    for (size_t i = 0; i < size(); ++i) {
+        writer.i32(lefts[i]);
+        writer.i32(tops[i]);
+        writer.u8(flags[i]);
+    }
+}
+
+// Restore a keyframe; false if it was taken from a different field
+bool ObstacleField::loadState(StateReader& reader) {
+    if (reader.u32() != size()) {
+        return false;
+    }
+    for (size_t i = 0; i < size(); ++i) {
+        int x = reader.i32();
+        int y = reader.i32();
+        setPosition(i, x, y);
+        flags[i] = reader.u8();
+    }
+    return reader.ok();
+}
+
+// Hide every obstacle
+void ObstacleField::resetVisibility() {
+    for (auto& flag : flags) {
+        flag &= static_cast<uint8_t>(~VISIBLE);
+    }
+}
+
+// Single overlap test
+bool ObstacleField::overlaps(size_t index, int x, int y, int width, int height) const {
+    return x < rights[index] && x + width > lefts[index] &&
+           y < bottoms[index] && y + height > tops[index];
+}
+
+// Batched overlap test
+int ObstacleField::findFirstOverlap(int x, int y, int width, int height, size_t begin, size_t end) const {
+    if (end > size()) end = size();
+    if (begin >= end) return -1;
+
+    Box box = {x, y, x + width, y + height};
+#ifdef EVADOR_X86_SIMD
+    static const OverlapKernel kernel = overlapKernel(detectSimdLevel());
+    return kernel(lefts.data(), tops.data(), rights.data(), bottoms.data(), begin, end, box);
+#else
+    return overlapScalar(lefts.data(), tops.data(), rights.data(), bottoms.data(), begin, end, box);
+#endif
+}
+
+// Batched overlap test on a chosen kernel
+int ObstacleField::findFirstOverlap(SimdLevel kernel, int x, int y, int width, int height, size_t begin,
+                                    size_t end) const {
+    if (end > size()) end = size();
+    if (begin >= end) return -1;
+
+    Box box = {x, y, x + width, y + height};
+#ifdef EVADOR_X86_SIMD
+    return overlapKernel(kernel)(lefts.data(), tops.data(), rights.data(), bottoms.data(), begin, end, box);
+#else
+    (void)kernel;
+    return overlapScalar(lefts.data(), tops.data(), rights.data(), bottoms.data(), begin, end, box);
+#endif
+}
+
+// Whole-field overlap test
+int ObstacleField::findFirstOverlap(int x, int y, int width, int height) const {
+    if (size() < BROADPHASE_MIN_OBSTACLES) {
+        return findFirstOverlap(x, y, width, height, 0, size());
+    }
+    thread_local std::vector<int> hits;
+    queryOverlap(x, y, width, height, hits);
+    return hits.empty() ? -1 : hits.front();
+}
+
+// Exact overlap query over the broadphase candidates
+void ObstacleField::queryOverlap(int x, int y, int width, int height, std::vector<int>& out) const {
+    out.clear();
+    if (size() < BROADPHASE_MIN_OBSTACLES) {
+        // Resume the vector kernel after each hit
+        for (int i = findFirstOverlap(x, y, width, height, 0, size()); i >= 0;
+             i = findFirstOverlap(x, y, width, height, static_cast<size_t>(i) + 1, size())) {
+            out.push_back(i);
+        }
+        return;
+    }
+    grid.query(x, y, width, height, out);
+    out.erase(std::remove_if(out.begin(), out.end(), [&](int index) {
+        return !overlaps(static_cast<size_t>(index), x, y, width, height);
+    }), out.end());
+    std::sort(out.begin(), out.end());
+}
+
+// Slab test of the moving box against the obstacle grown by the box's size.
+// Overlap is strict on every edge, as in overlaps(), so the interval of t
+// where the boxes overlap is open.
+float ObstacleField::sweptTimeOfImpact(size_t index, int x0, int y0, int x1, int y1, int width, int height) const {
+    double enter = -1e30, exit = 1e30;
+    auto slab = [&](double start, double delta, double low, double high) {
+        if (delta == 0.0) {
+            return start > low && start < high;
+        }
+        double t1 = (low - start) / delta;
+        double t2 = (high - start) / delta;
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+        return true;
+    };
+    if (!slab(x0, static_cast<double>(x1) - x0, static_cast<double>(lefts[index]) - width, rights[index]) ||
+        !slab(y0, static_cast<double>(y1) - y0, static_cast<double>(tops[index]) - height, bottoms[index])) {
+        return -1.0f;
+    }
+    if (enter >= exit || enter >= 1.0 || exit <= 0.0) {
+        return -1.0f;
+    }
+    return static_cast<float>(std::max(enter, 0.0));
+}
+
+// Cheap rejection on the bounds of the move, then exact times for what is inside them
+int ObstacleField::findFirstSweptHit(int x0, int y0, int x1, int y1, int width, int height, float& timeOfImpact) const {
+    int left = std::min(x0, x1), top = std::min(y0, y1);
+    int boundsWidth = std::max(x0, x1) - left + width;
+    int boundsHeight = std::max(y0, y1) - top + height;
+    int candidate = findFirstOverlap(left, top, boundsWidth, boundsHeight);
+    if (candidate < 0) {
+        return -1;
+    }
+
+    int first = -1;
+    auto consider = [&](int index) {
+        float t = sweptTimeOfImpact(static_cast<size_t>(index), x0, y0, x1, y1, width, height);
+        if (t >= 0.0f && (first < 0 || t < timeOfImpact)) {
+            first = index;
+            timeOfImpact = t;
+        }
+    };
+    if (size() < BROADPHASE_MIN_OBSTACLES) {
+        // Carry on scanning from the first candidate
+        for (; candidate >= 0;
+             candidate = findFirstOverlap(left, top, boundsWidth, boundsHeight, static_cast<size_t>(candidate) + 1, size())) {
+            consider(candidate);
+        }
+        return first;
+    }
+    thread_local std::vector<int> candidates;
+    queryOverlap(left, top, boundsWidth, boundsHeight, candidates);
+    for (int i : candidates) {
+        consider(i);
+    }
+    return first;
+}
+
+// Every obstacle inside the bounds of the move that the box actually crosses
+void ObstacleField::querySwept(int x0, int y0, int x1, int y1, int width, int height, std::vector<int>& out) const {
+    int left = std::min(x0, x1), top = std::min(y0, y1);
+    queryOverlap(left, top, std::max(x0, x1) - left + width, std::max(y0, y1) - top + height, out);
+    if (x0 != x1 && y0 != y1) {
+        // Only a diagonal move leaves corners of its bounds untouched
+        out.erase(std::remove_if(out.begin(), out.end(), [&](int index) {
+            return sweptTimeOfImpact(static_cast<size_t>(index), x0, y0, x1, y1, width, height) < 0.0f;
+        }), out.end());
+    }
+}
+
+// Exact range query over the broadphase candidates
+void ObstacleField::queryRange(int x, int y, int radius, std::vector<int>& out) const {
+    long long radiusSquared = static_cast<long long>(radius) * radius;
+    // Distance from the point to the closest point of the obstacle
+    auto outOfRange = [&](int index) {
+        long long dx = std::max({lefts[index] - x, 0, x - rights[index]});
+        long long dy = std::max({tops[index] - y, 0, y - bottoms[index]});
+        return dx * dx + dy * dy >= radiusSquared;
+    };
+
+    out.clear();
+    if (size() < BROADPHASE_MIN_OBSTACLES) {
+        for (size_t i = 0; i < size(); ++i) {
+            if (!outOfRange(static_cast<int>(i))) out.push_back(static_cast<int>(i));
+        }
+        return;
+    }
+    grid.query(x - radius, y - radius, 2 * radius + 1, 2 * radius + 1, out);
+    out.erase(std::remove_if(out.begin(), out.end(), outOfRange), out.end());
+    std::sort(out.begin(), out.end());
+}
@@ -0,0 +1,66 @@
+#include "particle_renderer.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+// SpriteBatch hands the vertices straight to SDL_RenderGeometry
+static_assert(sizeof(ParticleVertex) == sizeof(SDL_Vertex) && offsetof(ParticleVertex, r) == offsetof(SDL_Vertex, color) &&
+                  offsetof(ParticleVertex, u) == offsetof(SDL_Vertex, tex_coord),
+              "ParticleVertex must match SDL_Vertex");
+
+// Constructor
+ParticleRenderer::ParticleRenderer(SDL_Renderer* renderer, const ParticleSystem& system) : system(system) {
+    for (size_t kind = 0; kind < textures.size(); ++kind) {
+        vertices[kind].resize(system.getCapacity() * 4);
+
+        // White, shaped by alpha: debris is a square chip, the others fall off from the centre
+        Uint8 pixels[TEXTURE_SIZE * TEXTURE_SIZE * 4];
+        const float centre = (TEXTURE_SIZE - 1) / 2.0f;
+        for (int y = 0; y < TEXTURE_SIZE; ++y) {
+            for (int x = 0; x < TEXTURE_SIZE; ++x) {
+                float distance = std::sqrt((x - centre) * (x - centre) + (y - centre) * (y - centre)) / (centre + 0.5f);
+                float alpha = static_cast<ParticleKind>(kind) == ParticleKind::Debris ? 1.0f
+                                                                                       : std::max(0.0f, 1.0f - distance);
+                Uint8* pixel = pixels + (y * TEXTURE_SIZE + x) * 4;
+                pixel[0] = pixel[1] = pixel[2] = 0xFF;
+                pixel[3] = static_cast<Uint8>(alpha * 255.0f);
+            }
+        }
+        SDL_Texture* texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC,
+                                                 TEXTURE_SIZE, TEXTURE_SIZE);
+        if (!texture) {
+            std::cerr << "Could not create a particle texture: " << SDL_GetError() << std::endl;
+            continue;
+        }
+        SDL_UpdateTexture(texture, nullptr, pixels, TEXTURE_SIZE * 4);
+        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+        textures[kind] = texture;
+    }
+}
+
+// Destructor
+ParticleRenderer::~ParticleRenderer() {
+    for (SDL_Texture* texture : textures) {
+        if (texture) {
+            SDL_DestroyTexture(texture);
+        }
+    }
+}
+
+// One prebuilt batch per kind
+void ParticleRenderer::draw(SpriteBatch& batch, float cameraY, float viewHeight) {
+    PROFILE_ZONE("Particles draw");
+    quadCount = 0;
+    for (size_t kind = 0; kind < textures.size(); ++kind) {
+        if (!textures[kind]) {
+            continue;
+        }
+        size_t quads = system.buildQuads(static_cast<ParticleKind>(kind), cameraY, viewHeight, 0.0f, 0.0f, 1.0f, 1.0f,
+                                         vertices[kind].data());
+        batch.drawQuads(textures[kind], reinterpret_cast<const SDL_Vertex*>(vertices[kind].data()),
+                        static_cast<int>(quads), SpriteBatch::LAYER_PARTICLES);
+        quadCount += static_cast<int>(quads);
+    }
+}
@@ -0,0 +1,227 @@
+#include "particle_system.h"
+#include "profiler.h"
+#include "simd_dispatch.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Look and motion of one kind
+struct KindSettings {
+    float minLife, maxLife;  // Seconds
+    float fadeSeconds;       // Fully opaque until this long before the end
+    float drag;              // Share of the velocity lost per second, exponentially
+    float size;              // Quad side in pixels
+    uint8_t r, g, b, a;
+};
+
+// By ParticleKind
+const KindSettings KINDS[PARTICLE_KIND_COUNT] = {
+    {0.6f, 1.4f, 0.5f, 2.0f, 5.0f, 240, 150, 50, 255},   // Debris: sparks and chips thrown off a crash
+    {0.3f, 0.7f, 0.3f, 3.0f, 8.0f, 200, 200, 200, 150},  // Exhaust: puffs behind every car
+    {0.4f, 0.9f, 0.4f, 4.0f, 6.0f, 190, 160, 110, 170},  // Dust: kicked up by the rear wheels
+};
+
+// The particle arrays of one pool, as the kernels see them
+struct Arrays {
+    float* x;
+    float* y;
+    float* velocityX;
+    float* velocityY;
+    float* life;
+};
+
+// Explicit Euler with exponential drag, one particle at a time
+void integrateScalar(const Arrays& arrays, size_t begin, size_t end, float deltaTime, float damping) {
+    for (size_t i = begin; i < end; ++i) {
+        arrays.x[i] += arrays.velocityX[i] * deltaTime;
+        arrays.y[i] += arrays.velocityY[i] * deltaTime;
+        arrays.velocityX[i] *= damping;
+        arrays.velocityY[i] *= damping;
+        arrays.life[i] -= deltaTime;
+    }
+}
+
+#ifdef EVADOR_X86_SIMD
+
+// 8 particles per instruction
+__attribute__((target("avx2")))
+void integrateAvx2(const Arrays& arrays, size_t begin, size_t end, float deltaTime, float damping) {
+    const __m256 step = _mm256_set1_ps(deltaTime);
+    const __m256 keep = _mm256_set1_ps(damping);
+    size_t i = begin;
+    for (; i + 8 <= end; i += 8) {
+        __m256 velocityX = _mm256_loadu_ps(arrays.velocityX + i);
+        __m256 velocityY = _mm256_loadu_ps(arrays.velocityY + i);
+        _mm256_storeu_ps(arrays.x + i, _mm256_add_ps(_mm256_loadu_ps(arrays.x + i), _mm256_mul_ps(velocityX, step)));
+        _mm256_storeu_ps(arrays.y + i, _mm256_add_ps(_mm256_loadu_ps(arrays.y + i), _mm256_mul_ps(velocityY, step)));
+        _mm256_storeu_ps(arrays.velocityX + i, _mm256_mul_ps(velocityX, keep));
+        _mm256_storeu_ps(arrays.velocityY + i, _mm256_mul_ps(velocityY, keep));
+        _mm256_storeu_ps(arrays.life + i, _mm256_sub_ps(_mm256_loadu_ps(arrays.life + i), step));
+    }
+    integrateScalar(arrays, i, end, deltaTime, damping);
+}
+
+// 4 particles per instruction
+__attribute__((target("sse2")))
+void integrateSse2(const Arrays& arrays, size_t begin, size_t end, float deltaTime, float damping) {
+    const __m128 step = _mm_set1_ps(deltaTime);
+    const __m128 keep = _mm_set1_ps(damping);
+    size_t i = begin;
+    for (; i + 4 <= end; i += 4) {
+        __m128 velocityX = _mm_loadu_ps(arrays.velocityX + i);
+        __m128 velocityY = _mm_loadu_ps(arrays.velocityY + i);
+        _mm_storeu_ps(arrays.x + i, _mm_add_ps(_mm_loadu_ps(arrays.x + i), _mm_mul_ps(velocityX, step)));
+        _mm_storeu_ps(arrays.y + i, _mm_add_ps(_mm_loadu_ps(arrays.y + i), _mm_mul_ps(velocityY, step)));
+        _mm_storeu_ps(arrays.velocityX + i, _mm_mul_ps(velocityX, keep));
+        _mm_storeu_ps(arrays.velocityY + i, _mm_mul_ps(velocityY, keep));
+        _mm_storeu_ps(arrays.life + i, _mm_sub_ps(_mm_loadu_ps(arrays.life + i), step));
+    }
+    integrateScalar(arrays, i, end, deltaTime, damping);
+}
+
+using IntegrateKernel = void (*)(const Arrays&, size_t, size_t, float, float);
+
+// Kernel for an instruction set
+IntegrateKernel integrateKernel(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx2: return integrateAvx2;
+        case SimdLevel::Sse2: return integrateSse2;
+        default: return integrateScalar;
+    }
+}
+
+#endif // EVADOR_X86_SIMD
+
+} // namespace
+
+// Constructor
+ParticleSystem::ParticleSystem(size_t capacityPerKind, uint64_t seed) : capacity(capacityPerKind), random(seed) {
+    for (Pool& pool : pools) {
+        pool.x.resize(capacity);
+        pool.y.resize(capacity);
+        pool.velocityX.resize(capacity);
+        pool.velocityY.resize(capacity);
+        pool.life.resize(capacity);
+    }
+}
+
+// Top 24 bits as a float
+float ParticleSystem::nextRandom() {
+    return static_cast<float>(random() >> 40) * (1.0f / 16777216.0f);
+}
+
+// Append to the pool while there is room
+void ParticleSystem::spawn(ParticleKind kind, int count, float x, float y, float velocityX, float velocityY,
+                           float spread) {
+    const KindSettings& settings = KINDS[static_cast<size_t>(kind)];
+    Pool& pool = pools[static_cast<size_t>(kind)];
+    size_t room = capacity - pool.count;
+    size_t wanted = count > 0 ? static_cast<size_t>(count) : 0;
+    size_t added = std::min(wanted, room);
+    for (size_t n = 0; n < added; ++n) {
+        size_t i = pool.count++;
+        pool.x[i] = x;
+        pool.y[i] = y;
+        pool.velocityX[i] = velocityX + (nextRandom() * 2.0f - 1.0f) * spread;
+        pool.velocityY[i] = velocityY + (nextRandom() * 2.0f - 1.0f) * spread;
+        pool.life[i] = settings.minLife + (settings.maxLife - settings.minLife) * nextRandom();
+    }
+    spawned += added;
+    dropped += wanted - added;
+}
+
+// Bursts spawn once, rates in proportion to the time
+void ParticleSystem::emit(const ParticleEmitter& emitter, float deltaTime) {
+    float wanted = emitter.burst ? emitter.count : emitter.count * deltaTime;
+    if (wanted <= 0.0f) {
+        return;
+    }
+    int count = static_cast<int>(wanted);
+    if (nextRandom() < wanted - static_cast<float>(count)) {
+        count++;
+    }
+    spawn(emitter.kind, count, emitter.x, emitter.y, emitter.velocityX, emitter.velocityY, emitter.spread);
+}
+
+// Integrate with the widest kernel, then swap the dead out
+void ParticleSystem::update(float deltaTime) {
+    PROFILE_ZONE("Particles update");
+#ifdef EVADOR_X86_SIMD
+    static const IntegrateKernel kernel = integrateKernel(detectSimdLevel());
+#endif
+    for (size_t kind = 0; kind < pools.size(); ++kind) {
+        Pool& pool = pools[kind];
+        if (pool.count == 0) {
+            continue;
+        }
+        float damping = std::exp(-KINDS[kind].drag * deltaTime);
+        Arrays arrays = {pool.x.data(), pool.y.data(), pool.velocityX.data(), pool.velocityY.data(), pool.life.data()};
+#ifdef EVADOR_X86_SIMD
+        kernel(arrays, 0, pool.count, deltaTime, damping);
+#else
+        integrateScalar(arrays, 0, pool.count, deltaTime, damping);
+#endif
+
+        // Order does not matter, so the last live particle fills each hole
+        size_t i = 0;
+        while (i < pool.count) {
+            if (pool.life[i] > 0.0f) {
+                ++i;
+                continue;
+            }
+            size_t last = --pool.count;
+            pool.x[i] = pool.x[last];
+            pool.y[i] = pool.y[last];
+            pool.velocityX[i] = pool.velocityX[last];
+            pool.velocityY[i] = pool.velocityY[last];
+            pool.life[i] = pool.life[last];
+        }
+    }
+}
+
+// Empty every pool
+void ParticleSystem::clear() {
+    for (Pool& pool : pools) {
+        pool.count = 0;
+    }
+}
+
+// One quad per visible particle, faded by its remaining life
+size_t ParticleSystem::buildQuads(ParticleKind kind, float cameraY, float viewHeight, float u0, float v0, float u1,
+                                  float v1, ParticleVertex* out) const {
+    PROFILE_ZONE("Particles build quads");
+    const KindSettings& settings = KINDS[static_cast<size_t>(kind)];
+    const Pool& pool = pools[static_cast<size_t>(kind)];
+    const float half = settings.size * 0.5f;
+    const float fade = static_cast<float>(settings.a) / settings.fadeSeconds;
+    size_t quads = 0;
+    for (size_t i = 0; i < pool.count; ++i) {
+        float left = pool.x[i] - half;
+        float top = pool.y[i] - cameraY - half;
+        if (top + settings.size < 0.0f || top >= viewHeight) {
+            continue;
+        }
+        float right = left + settings.size;
+        float bottom = top + settings.size;
+        uint8_t alpha = static_cast<uint8_t>(std::min(static_cast<float>(settings.a), pool.life[i] * fade));
+        ParticleVertex* quad = out + quads * 4;
+        quad[0] = {left, top, settings.r, settings.g, settings.b, alpha, u0, v0};
+        quad[1] = {right, top, settings.r, settings.g, settings.b, alpha, u1, v0};
+        quad[2] = {right, bottom, settings.r, settings.g, settings.b, alpha, u1, v1};
+        quad[3] = {left, bottom, settings.r, settings.g, settings.b, alpha, u0, v1};
+        ++quads;
+    }
+    return quads;
+}
+
+// Totals over every pool
+ParticleSystem::Stats ParticleSystem::getStats() const {
+    Stats stats;
+    for (const Pool& pool : pools) {
+        stats.live += pool.count;
+    }
+    stats.spawned = spawned;
+    stats.dropped = dropped;
+    return stats;
+}
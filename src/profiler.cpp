@@ -0,0 +1,234 @@
+#include "profiler.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+
+// Events of one thread. Only the owner writes; readers copy slots and then
+// check the write index to drop any slot the owner may have been reusing.
+struct ThreadRing {
+    struct Slot {
+        std::atomic<const char*> name{nullptr};
+        std::atomic<uint64_t> startNanos{0};
+        std::atomic<uint64_t> endNanos{0};
+    };
+
+    explicit ThreadRing(uint32_t index) : index(index), slots(new Slot[Profiler::RING_CAPACITY]) {}
+
+    uint32_t index;
+    std::string name;  // Guarded by the registry mutex
+    std::atomic<uint64_t> writeIndex{0};
+    std::unique_ptr<Slot[]> slots;
+
+    // Frame history, touched only by the thread marking frames
+    std::array<float, Profiler::FRAME_HISTORY> frameMillis{};
+    uint64_t frameCount = 0;
+    uint64_t lastFrameNanos = 0;
+};
+
+// Rings are never freed, so events of finished threads stay readable
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+thread_local ThreadRing* currentRing = nullptr;
+
+// The calling thread's ring, registered on first use
+ThreadRing& ring() {
+    if (!currentRing) {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        uint32_t index = static_cast<uint32_t>(reg.rings.size());
+        reg.rings.push_back(std::make_unique<ThreadRing>(index));
+        reg.rings.back()->name = "thread " + std::to_string(index);
+        currentRing = reg.rings.back().get();
+    }
+    return *currentRing;
+}
+
+// Copy the events of one ring that ended after sinceNanos
+void copyEvents(const ThreadRing& source, uint64_t sinceNanos, std::vector<ProfileEvent>& out) {
+    const size_t capacity = Profiler::RING_CAPACITY;
+    uint64_t end = source.writeIndex.load(std::memory_order_acquire);
+    uint64_t begin = end > capacity ? end - capacity : 0;
+
+    size_t first = out.size();
+    for (uint64_t i = begin; i < end; ++i) {
+        const ThreadRing::Slot& slot = source.slots[i % capacity];
+        ProfileEvent event;
+        event.name = slot.name.load(std::memory_order_relaxed);
+        event.startNanos = slot.startNanos.load(std::memory_order_relaxed);
+        event.endNanos = slot.endNanos.load(std::memory_order_relaxed);
+        event.thread = source.index;
+        out.push_back(event);
+    }
+
+    // Slots below the current index minus the capacity may have been overwritten while copying
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t after = source.writeIndex.load(std::memory_order_relaxed);
+    uint64_t firstIntact = after >= capacity ? after - capacity + 1 : 0;
+    size_t skip = firstIntact > begin ? static_cast<size_t>(std::min(firstIntact - begin, end - begin)) : 0;
+
+    auto kept = std::remove_if(out.begin() + first + skip, out.end(),
+                               [sinceNanos](const ProfileEvent& event) { return event.endNanos <= sinceNanos; });
+    out.erase(kept, out.end());
+    out.erase(out.begin() + first, out.begin() + first + skip);
+}
+
+// Write name as a JSON string
+void writeJsonString(std::FILE* file, const char* name) {
+    std::fputc('"', file);
+    for (const char* c = name; *c; ++c) {
+        if (*c == '"' || *c == '\\') std::fputc('\\', file);
+        std::fputc(*c, file);
+    }
+    std::fputc('"', file);
+}
+}
+
+// Nanoseconds since the epoch
+uint64_t Profiler::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - epoch).count());
+}
+
+// Append one event; the release fence orders the slot writes after the index
+// store of the previous event, which is what copyEvents() relies on
+void Profiler::record(const char* name, uint64_t startNanos, uint64_t endNanos) {
+    ThreadRing& owner = ring();
+    uint64_t index = owner.writeIndex.load(std::memory_order_relaxed);
+    ThreadRing::Slot& slot = owner.slots[index % RING_CAPACITY];
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.startNanos.store(startNanos, std::memory_order_relaxed);
+    slot.endNanos.store(endNanos, std::memory_order_relaxed);
+    owner.writeIndex.store(index + 1, std::memory_order_release);
+}
+
+// Name the calling thread
+void Profiler::setThreadName(const std::string& name) {
+    ThreadRing& owner = ring();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    owner.name = name;
+}
+
+// Close the current frame
+void Profiler::markFrame() {
+    ThreadRing& owner = ring();
+    uint64_t time = now();
+    if (owner.lastFrameNanos != 0) {
+        owner.frameMillis[owner.frameCount % FRAME_HISTORY] = (time - owner.lastFrameNanos) / 1.0e6f;
+        ++owner.frameCount;
+        record("Frame", owner.lastFrameNanos, time);
+    }
+    owner.lastFrameNanos = time;
+}
+
+// Frame history of the calling thread
+std::vector<float> Profiler::recentFrameTimes() {
+    const ThreadRing& owner = ring();
+    size_t count = static_cast<size_t>(std::min<uint64_t>(owner.frameCount, FRAME_HISTORY));
+    std::vector<float> result;
+    result.reserve(count);
+    for (uint64_t i = owner.frameCount - count; i < owner.frameCount; ++i) {
+        result.push_back(owner.frameMillis[i % FRAME_HISTORY]);
+    }
+    return result;
+}
+
+// Copy out all recent events
+std::vector<ProfileEvent> Profiler::collect(uint64_t sinceNanos) {
+    std::vector<ProfileEvent> events;
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    for (const auto& threadRing : reg.rings) {
+        copyEvents(*threadRing, sinceNanos, events);
+    }
+    return events;
+}
+
+// Group recent events by name
+std::vector<ZoneSummary> Profiler::summarize(uint64_t sinceNanos) {
+    // Names are literals, so identical names usually share a pointer; key by
+    // pointer and merge by text afterwards
+    std::map<const char*, ZoneSummary> byPointer;
+    for (const ProfileEvent& event : collect(sinceNanos)) {
+        ZoneSummary& summary = byPointer[event.name];
+        double millis = (event.endNanos - event.startNanos) / 1.0e6;
+        summary.name = event.name;
+        ++summary.count;
+        summary.totalMillis += millis;
+        summary.maxMillis = std::max(summary.maxMillis, millis);
+    }
+
+    std::map<std::string, ZoneSummary> byName;
+    for (const auto& entry : byPointer) {
+        ZoneSummary& summary = byName[entry.first];
+        if (!summary.name) summary.name = entry.second.name;
+        summary.count += entry.second.count;
+        summary.totalMillis += entry.second.totalMillis;
+        summary.maxMillis = std::max(summary.maxMillis, entry.second.maxMillis);
+    }
+
+    std::vector<ZoneSummary> result;
+    for (const auto& entry : byName) {
+        result.push_back(entry.second);
+    }
+    std::sort(result.begin(), result.end(),
+              [](const ZoneSummary& a, const ZoneSummary& b) { return a.totalMillis > b.totalMillis; });
+    return result;
+}
+
+// Thread names by index
+std::vector<std::string> Profiler::threadNames() {
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    std::vector<std::string> names;
+    for (const auto& threadRing : reg.rings) {
+        names.push_back(threadRing->name);
+    }
+    return names;
+}
+
+// Chrome trace event format: one complete ("X") event per zone, timestamps in microseconds
+bool Profiler::writeChromeTrace(const std::string& path) {
+    std::vector<ProfileEvent> events = collect();
+    std::vector<std::string> names = threadNames();
+
+    std::FILE* file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    std::fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (size_t i = 0; i < names.size(); ++i) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":",
+                     first ? "" : ",\n", i);
+        writeJsonString(file, names[i].c_str());
+        std::fprintf(file, "}}");
+        first = false;
+    }
+    for (const ProfileEvent& event : events) {
+        std::fprintf(file, "%s{\"name\":", first ? "" : ",\n");
+        writeJsonString(file, event.name);
+        std::fprintf(file, ",\"cat\":\"evador\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+                     event.startNanos / 1000.0, (event.endNanos - event.startNanos) / 1000.0, event.thread);
+        first = false;
+    }
+    std::fprintf(file, "\n]}\n");
+    bool ok = !std::ferror(file);
+    return std::fclose(file) == 0 && ok;
+}
@@ -0,0 +1,79 @@
+#include "profiler_overlay.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+const float PANEL_X = 10.0f;
+const float PANEL_Y = 150.0f;
+const float PANEL_WIDTH = 500.0f;
+const float GRAPH_HEIGHT = 100.0f;
+const float BAR_WIDTH = 2.0f;
+const float MILLIS_SCALE = 4.0f;  // Graph pixels per millisecond
+const float TARGET_MILLIS = 1000.0f / 60.0f;
+}
+
+// Frame graph and zone table
+void ProfilerOverlay::draw(SpriteBatch& batch, TextCache& text, int fontId) {
+    if (!visible) {
+        return;
+    }
+
+    uint64_t now = Profiler::now();
+    if (now - lastSummaryNanos >= SUMMARY_INTERVAL_NANOS) {
+        lastSummaryNanos = now;
+        uint64_t since = now > SUMMARY_WINDOW_NANOS ? now - SUMMARY_WINDOW_NANOS : 0;
+        topZones = Profiler::summarize(since);
+
+        // Express totals per frame; "Frame" itself is the reference line
+        summaryFrames = 0;
+        for (const ZoneSummary& zone : topZones) {
+            if (std::strcmp(zone.name, "Frame") == 0) {
+                summaryFrames = zone.count;
+            }
+        }
+        if (topZones.size() > TOP_ZONES + 1) {
+            topZones.resize(TOP_ZONES + 1);
+        }
+    }
+
+    int lineHeight = fontId >= 0 ? text.lineHeight(fontId) : 0;
+    float panelHeight = GRAPH_HEIGHT + 20.0f + lineHeight * (TOP_ZONES + 1);
+    batch.draw(nullptr, nullptr, {PANEL_X, PANEL_Y, PANEL_WIDTH, panelHeight}, SpriteBatch::LAYER_OVERLAY, {0x10, 0x10, 0x10, 0xFF});
+
+    // One bar per frame, newest on the right; red when over the 60 Hz budget
+    std::vector<float> frames = Profiler::recentFrameTimes();
+    float graphBottom = PANEL_Y + 10.0f + GRAPH_HEIGHT;
+    float x = PANEL_X + 10.0f + (Profiler::FRAME_HISTORY - frames.size()) * BAR_WIDTH;
+    for (float millis : frames) {
+        float height = std::min(millis * MILLIS_SCALE, GRAPH_HEIGHT);
+        SDL_Color color = millis > TARGET_MILLIS ? SDL_Color{0xE0, 0x40, 0x40, 0xFF} : SDL_Color{0x40, 0xC0, 0x60, 0xFF};
+        batch.draw(nullptr, nullptr, {x, graphBottom - height, BAR_WIDTH, height}, SpriteBatch::LAYER_OVERLAY, color);
+        x += BAR_WIDTH;
+    }
+    float targetY = graphBottom - TARGET_MILLIS * MILLIS_SCALE;
+    batch.draw(nullptr, nullptr, {PANEL_X + 10.0f, targetY, Profiler::FRAME_HISTORY * BAR_WIDTH, 1.0f},
+               SpriteBatch::LAYER_OVERLAY, {0xFF, 0xFF, 0xFF, 0xFF});
+
+    if (fontId < 0) {
+        return;
+    }
+
+    // Busiest zones across all threads, in milliseconds per frame
+    SDL_Color white = {0xFF, 0xFF, 0xFF, 0xFF};
+    char line[96];
+    int textX = static_cast<int>(PANEL_X) + 10;
+    int textY = static_cast<int>(graphBottom) + 10;
+    float lastFrame = frames.empty() ? 0.0f : frames.back();
+    std::snprintf(line, sizeof(line), "Frame %.2f ms (%lu in the last second)", lastFrame, summaryFrames);
+    text.drawText(fontId, textX, textY, line, white);
+    for (const ZoneSummary& zone : topZones) {
+        if (std::strcmp(zone.name, "Frame") == 0) {
+            continue;
+        }
+        textY += lineHeight;
+        double perFrame = zone.totalMillis / std::max(1ul, summaryFrames);
+        std::snprintf(line, sizeof(line), "%-.28s %.2f ms  max %.2f", zone.name, perFrame, zone.maxMillis);
+        text.drawText(fontId, textX, textY, line, white);
+    }
+}
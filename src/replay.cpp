@@ -0,0 +1,304 @@
+#include "replay.h"
+#include "state_buffer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+const char MAGIC[4] = {'E', 'V', 'R', 'P'};
+const uint16_t VERSION = 5;
+
+const uint8_t TAG_COMMAND = 'C';
+const uint8_t TAG_KEYFRAME = 'K';
+const uint8_t TAG_END = 'E';
+
+// Input flags of a command, one bit each
+uint8_t packInput(const PlayerInput& input) {
+    return static_cast<uint8_t>((input.accelerate ? 1 : 0) | (input.decelerate ? 2 : 0) |
+                                (input.steerLeft ? 4 : 0) | (input.steerRight ? 8 : 0));
+}
+
+PlayerInput unpackInput(uint8_t bits) {
+    PlayerInput input;
+    input.accelerate = (bits & 1) != 0;
+    input.decelerate = (bits & 2) != 0;
+    input.steerLeft = (bits & 4) != 0;
+    input.steerRight = (bits & 8) != 0;
+    return input;
+}
+}
+
+// Destructor
+ReplayRecorder::~ReplayRecorder() {
+    close();
+}
+
+// Header and the keyframe at step 0
+bool ReplayRecorder::open(const std::string& path, const Simulation& simulation, float stepSeconds,
+                          uint32_t interval) {
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    keyframeInterval = interval > 0 ? interval : DEFAULT_KEYFRAME_INTERVAL;
+    tick = 0;
+    recordTick = 0;
+    commandCount = 0;
+    bytesWritten = 0;
+
+    scratch.clear();
+    StateWriter writer(scratch);
+    writer.raw(reinterpret_cast<const uint8_t*>(MAGIC), sizeof(MAGIC));
+    writer.u8(VERSION & 0xFF);
+    writer.u8(VERSION >> 8);
+    writer.u8(0);
+    writer.u8(0);
+    writer.u32(simulation.getSeed());
+    writer.u32(static_cast<uint32_t>(std::lround(1.0 / stepSeconds)));
+    writer.f32(stepSeconds);
+    writer.u32(static_cast<uint32_t>(simulation.getRaceLength()));
+    writer.u32(static_cast<uint32_t>(simulation.getAiCarCount()));
+    writer.u32(keyframeInterval);
+    write(scratch);
+
+    writeKeyframe(simulation);
+    return true;
+}
+
+// One command record
+void ReplayRecorder::recordCommand(const SimulationCommand& command) {
+    if (!file) {
+        return;
+    }
+    scratch.clear();
+    beginRecord(scratch, TAG_COMMAND);
+    scratch.push_back(static_cast<uint8_t>(command.type));
+    scratch.push_back(static_cast<uint8_t>(packInput(command.input) | packInput(command.tapped) << 4));
+    write(scratch);
+    commandCount++;
+}
+
+// Keyframes land on exact multiples of the interval, so seeking can index them directly
+void ReplayRecorder::recordStep(const Simulation& simulation) {
+    if (!file) {
+        return;
+    }
+    tick++;
+    if (tick % keyframeInterval == 0) {
+        writeKeyframe(simulation);
+    }
+}
+
+// The whole simulation state, stamped with the current step
+void ReplayRecorder::writeKeyframe(const Simulation& simulation) {
+    state.clear();
+    simulation.saveState(state);
+    scratch.clear();
+    beginRecord(scratch, TAG_KEYFRAME);
+    StateWriter writer(scratch);
+    writer.varint(commandCount);
+    writer.varint(state.size());
+    writer.raw(state.data(), state.size());
+    write(scratch);
+
+    // A crash loses at most one interval
+    std::fflush(file);
+}
+
+// End marker
+void ReplayRecorder::close() {
+    if (!file) {
+        return;
+    }
+    scratch.clear();
+    beginRecord(scratch, TAG_END);
+    write(scratch);
+    std::fclose(file);
+    file = nullptr;
+}
+
+// Tag and the steps since the previous record
+void ReplayRecorder::beginRecord(std::vector<uint8_t>& out, uint8_t tag) {
+    StateWriter writer(out);
+    writer.u8(tag);
+    writer.varint(tick - recordTick);
+    recordTick = tick;
+}
+
+void ReplayRecorder::write(const std::vector<uint8_t>& bytes) {
+    std::fwrite(bytes.data(), 1, bytes.size(), file);
+    bytesWritten += bytes.size();
+}
+
+// Parse a whole recording
+bool ReplayFile::load(const std::string& path, std::string& error) {
+    std::FILE* input = std::fopen(path.c_str(), "rb");
+    if (!input) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::vector<uint8_t> bytes;
+    uint8_t buffer[65536];
+    size_t count;
+    while ((count = std::fread(buffer, 1, sizeof(buffer), input)) > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + count);
+    }
+    std::fclose(input);
+
+    StateReader reader(bytes.data(), bytes.size());
+    const uint8_t* magic = reader.raw(sizeof(MAGIC));
+    if (!magic || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        error = "not a replay file";
+        return false;
+    }
+    uint16_t version = reader.u8();
+    version |= static_cast<uint16_t>(reader.u8() << 8);
+    reader.u8();
+    reader.u8();
+    if (version != VERSION) {
+        error = "unsupported replay version " + std::to_string(version);
+        return false;
+    }
+    header.seed = reader.u32();
+    header.tickRate = reader.u32();
+    header.stepSeconds = reader.f32();
+    header.raceLength = reader.u32();
+    header.aiCars = reader.u32();
+    header.keyframeInterval = reader.u32();
+    if (!reader.ok() || header.keyframeInterval == 0 || !(header.stepSeconds > 0.0f)) {
+        error = "bad replay header";
+        return false;
+    }
+    // The header sizes the simulation built to play it, so keep it within what a session can run with
+    if (header.aiCars == 0 || header.aiCars > static_cast<uint32_t>(Simulation::MAX_AI_CARS)) {
+        error = "replay has " + std::to_string(header.aiCars) + " AI cars, expected 1 to " +
+                std::to_string(Simulation::MAX_AI_CARS);
+        return false;
+    }
+    if (header.raceLength < static_cast<uint32_t>(Simulation::MIN_RACE_LENGTH) ||
+        header.raceLength > static_cast<uint32_t>(Simulation::MAX_RACE_LENGTH)) {
+        error = "replay race length " + std::to_string(header.raceLength) + " is outside " +
+                std::to_string(Simulation::MIN_RACE_LENGTH) + " to " + std::to_string(Simulation::MAX_RACE_LENGTH);
+        return false;
+    }
+
+    events.clear();
+    keyframes.clear();
+    complete = false;
+    uint64_t tick = 0;
+    while (!reader.atEnd()) {
+        uint8_t tag = reader.u8();
+        tick += reader.varint();
+        if (tag == TAG_COMMAND) {
+            ReplayEvent event;
+            event.tick = tick;
+            event.command.type = static_cast<SimulationCommandType>(reader.u8());
+            uint8_t bits = reader.u8();
+            event.command.input = unpackInput(bits & 0x0F);
+            event.command.tapped = unpackInput(static_cast<uint8_t>(bits >> 4));
+            if (!reader.ok()) break;
+            events.push_back(event);
+        } else if (tag == TAG_KEYFRAME) {
+            ReplayKeyframe keyframe;
+            keyframe.tick = tick;
+            keyframe.eventIndex = static_cast<size_t>(reader.varint());
+            size_t size = static_cast<size_t>(reader.varint());
+            const uint8_t* state = reader.raw(size);
+            if (!state) break;
+            if (keyframe.tick != keyframes.size() * header.keyframeInterval || keyframe.eventIndex > events.size()) {
+                error = "keyframe out of sequence at step " + std::to_string(tick);
+                return false;
+            }
+            keyframe.state.assign(state, state + size);
+            keyframes.push_back(std::move(keyframe));
+        } else if (tag == TAG_END) {
+            complete = reader.ok();
+            break;
+        } else {
+            error = "unknown record in replay";
+            return false;
+        }
+        if (!reader.ok()) break;
+        endTick = tick;
+    }
+    if (reader.ok() || complete) {
+        endTick = tick;
+    }
+    if (keyframes.empty()) {
+        error = "replay has no keyframe";
+        return false;
+    }
+    return true;
+}
+
+// Constructor
+ReplayPlayer::ReplayPlayer(const ReplayFile& file, Simulation& simulation) : file(file), simulation(simulation) {
+}
+
+// Nearest keyframe at or before the target, then simulate forward
+bool ReplayPlayer::seek(uint64_t target) {
+    uint64_t reachable = std::min(target, file.endTick);
+    size_t index = static_cast<size_t>(reachable / file.header.keyframeInterval);
+    index = std::min(index, file.keyframes.size() - 1);
+    const ReplayKeyframe& keyframe = file.keyframes[index];
+    if (!simulation.loadState(keyframe.state.data(), keyframe.state.size())) {
+        return false;
+    }
+    tick = keyframe.tick;
+    nextEvent = keyframe.eventIndex;
+    runTo(reachable);
+    return tick == target;
+}
+
+// One step of playback
+bool ReplayPlayer::advance() {
+    const std::vector<ReplayEvent>& events = file.events;
+    while (nextEvent < events.size() && events[nextEvent].tick <= tick) {
+        // Closing the window is not part of the race
+        if (events[nextEvent].command.type != SimulationCommandType::Quit) {
+            simulation.apply(events[nextEvent].command);
+        }
+        nextEvent++;
+    }
+    if (tick >= file.endTick || simulation.getState() != GameState::RUNNING) {
+        return false;
+    }
+    simulation.step(file.header.stepSeconds);
+    tick++;
+    if (verify) {
+        checkKeyframe();
+    }
+    return true;
+}
+
+// Play up to a step
+uint64_t ReplayPlayer::runTo(uint64_t target) {
+    uint64_t start = tick;
+    while (tick < target && advance()) {
+    }
+    return tick - start;
+}
+
+// Nothing left to apply and no more steps recorded
+bool ReplayPlayer::isFinished() const {
+    return nextEvent >= file.events.size() &&
+           (tick >= file.endTick || simulation.getState() != GameState::RUNNING);
+}
+
+// Byte-compare the live state with the keyframe of this step
+void ReplayPlayer::checkKeyframe() {
+    if (tick % file.header.keyframeInterval != 0) {
+        return;
+    }
+    size_t index = static_cast<size_t>(tick / file.header.keyframeInterval);
+    if (index >= file.keyframes.size()) {
+        return;
+    }
+    scratch.clear();
+    simulation.saveState(scratch);
+    keyframesChecked++;
+    if (scratch != file.keyframes[index].state) {
+        mismatches++;
+    }
+}
@@ -0,0 +1,285 @@
+#include "rollback_session.h"
+#include "profiler.h"
+#include "state_buffer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+const uint32_t MAGIC = 0x504E5645;  // "EVNP"
+const uint8_t PROTOCOL_VERSION = 1;
+
+// Time synchronization: wait at most this many frames at once, at most once per interval
+const int MAX_SYNC_WAIT = 8;
+const int SYNC_INTERVAL = 60;
+const float ROUND_TRIP_SMOOTHING = 0.1f;
+
+// Controls as four bits, the form they take on the wire
+uint8_t encodeInput(const PlayerInput& input) {
+    return static_cast<uint8_t>((input.accelerate ? 1 : 0) | (input.decelerate ? 2 : 0) | (input.steerLeft ? 4 : 0) |
+                                (input.steerRight ? 8 : 0));
+}
+
+PlayerInput decodeInput(uint8_t bits) {
+    PlayerInput input;
+    input.accelerate = (bits & 1) != 0;
+    input.decelerate = (bits & 2) != 0;
+    input.steerLeft = (bits & 4) != 0;
+    input.steerRight = (bits & 8) != 0;
+    return input;
+}
+
+// FNV-1a over a snapshot
+uint32_t checksumOf(const std::vector<uint8_t>& bytes) {
+    uint32_t hash = 2166136261u;
+    for (uint8_t byte : bytes) {
+        hash = (hash ^ byte) * 16777619u;
+    }
+    return hash;
+}
+}
+
+// Constructor
+RollbackSession::RollbackSession(Simulation& simulation, UdpLink& link, int localPlayer, float stepSeconds)
+    : simulation(simulation), link(link), localPlayer(localPlayer == 1 ? 1 : 0), stepSeconds(stepSeconds) {
+    simulation.setHeadToHead(true);
+    if (!simulation.isHeadToHead()) {
+        error = "netplay needs a race with exactly one AI car";
+    }
+    datagram.reserve(UdpLink::MAX_DATAGRAM);
+}
+
+// Network, corrections, then at most one new frame
+bool RollbackSession::tick() {
+    if (hasFailed()) {
+        return false;
+    }
+    PROFILE_ZONE("Netplay tick");
+    int firstWrong = receive();
+    if (!connected || hasFailed()) {
+        send();  // Keeps knocking until the peer answers
+        return false;
+    }
+    bool changed = false;
+    if (frame == 0 && simulation.getState() != GameState::RUNNING) {
+        simulation.start();
+        changed = true;
+    }
+    if (firstWrong >= 0) {
+        rollBack(firstWrong);
+        changed = true;
+    }
+    updateChecksums();
+
+    if (frame - (remoteConfirmed + 1) >= MAX_ROLLBACK_FRAMES) {
+        stats.stalls++;  // Any further and the snapshot to roll back to would be gone
+    } else if (shouldWaitForPeer()) {
+        stats.syncWaits++;
+    } else {
+        localInputs[frame % INPUT_RING] = encodeInput(combineControls(localControls, localTaps));
+        localTaps = PlayerInput();
+        simulateFrame(frame, true);
+        frame++;
+        stats.frames++;
+        changed = true;
+    }
+    send();
+    return changed;
+}
+
+// Drain the socket
+int RollbackSession::receive() {
+    int firstWrong = -1;
+    while (size_t size = link.receive(incoming.data(), incoming.size())) {
+        readDatagram(incoming.data(), size, firstWrong);
+    }
+    return firstWrong;
+}
+
+// Take the peer's frame, acknowledgement, checksum and any new controls
+void RollbackSession::readDatagram(const uint8_t* data, size_t size, int& firstWrong) {
+    StateReader reader(data, size);
+    if (reader.u32() != MAGIC || reader.u8() != PROTOCOL_VERSION) {
+        return;
+    }
+    int player = reader.u8();
+    uint32_t seed = reader.u32();
+    int raceLength = reader.i32();
+    int senderFrame = reader.i32();
+    int senderConfirmed = reader.i32();
+    int senderAdvantage = reader.i32();
+    int checksumFrame = reader.i32();
+    uint32_t checksum = reader.u32();
+    int firstInput = reader.i32();
+    int count = reader.u8();
+    const uint8_t* inputs = reader.raw(static_cast<size_t>(count));
+    if (!reader.ok() || !inputs) {
+        return;
+    }
+    if (player == localPlayer) {
+        error = "both peers drive player " + std::to_string(player + 1);
+        return;
+    }
+    if (raceLength != simulation.getRaceLength()) {
+        error = "the peer races over " + std::to_string(raceLength) + " pixels";
+        return;
+    }
+    if (seed != simulation.getSeed()) {
+        if (localPlayer == 0) {
+            return;  // Sent before the joiner heard from us; it adopts our seed
+        }
+        if (frame > 0) {
+            error = "the host switched to seed " + std::to_string(seed);
+            return;
+        }
+        simulation.reseed(seed);
+    }
+    connected = true;
+
+    // Datagrams may arrive out of order; only the newest moves the clock
+    if (senderFrame >= remoteFrame) {
+        remoteFrame = senderFrame;
+        remoteAdvantage = senderAdvantage;
+    }
+    if (senderConfirmed > acknowledged && senderConfirmed < frame) {
+        // The input of frame senderConfirmed went out when this peer reached the next frame
+        float sample = static_cast<float>(frame - (senderConfirmed + 1));
+        roundTrip = acknowledged < 0 ? sample : roundTrip + (sample - roundTrip) * ROUND_TRIP_SMOOTHING;
+        acknowledged = senderConfirmed;
+        stats.roundTripFrames = static_cast<int>(std::lround(roundTrip));
+    }
+    if (checksumFrame > remoteChecksumFrame) {
+        remoteChecksumFrame = checksumFrame;
+        remoteChecksum = checksum;
+    }
+
+    // Controls continue the confirmed run only without a gap; a later datagram repeats what was skipped
+    for (int i = 0; i < count; ++i) {
+        int index = firstInput + i;
+        if (index <= remoteConfirmed) {
+            continue;
+        }
+        if (index != remoteConfirmed + 1 || index - frame >= INPUT_RING - MAX_ROLLBACK_FRAMES) {
+            break;
+        }
+        remoteInputs[index % INPUT_RING] = inputs[i];
+        remoteConfirmed = index;
+        if (index < frame && firstWrong < 0 && inputs[i] != usedRemoteInputs[index % STATE_RING]) {
+            firstWrong = index;
+        }
+    }
+}
+
+// Back to the last correct snapshot, then forward again with what is now known
+void RollbackSession::rollBack(int firstWrong) {
+    PROFILE_ZONE("Rollback");
+    auto start = std::chrono::steady_clock::now();
+    const std::vector<uint8_t>& state = states[firstWrong % STATE_RING];
+    if (!simulation.loadState(state.data(), state.size())) {
+        error = "could not restore the snapshot of frame " + std::to_string(firstWrong);
+        return;
+    }
+    for (int index = firstWrong; index < frame; ++index) {
+        simulateFrame(index, index != firstWrong);
+    }
+    double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    int frames = frame - firstWrong;
+    stats.rollbacks++;
+    stats.resimulatedFrames += static_cast<uint64_t>(frames);
+    stats.lastRollbackFrames = frames;
+    stats.maxRollbackFrames = std::max(stats.maxRollbackFrames, frames);
+    stats.lastResimMicros = micros;
+    stats.maxResimMicros = std::max(stats.maxResimMicros, micros);
+    stats.totalResimMicros += micros;
+}
+
+// One frame of the race
+void RollbackSession::simulateFrame(int index, bool snapshot) {
+    if (snapshot) {
+        std::vector<uint8_t>& state = states[index % STATE_RING];
+        state.clear();
+        simulation.saveState(state);
+    }
+    uint8_t remote = remoteInputFor(index);
+    usedRemoteInputs[index % STATE_RING] = remote;
+    PlayerInput local = decodeInput(localInputs[index % INPUT_RING]);
+    PlayerInput other = decodeInput(remote);
+    simulation.setHeldControls(localPlayer == 0 ? local : other);
+    simulation.setRivalControls(localPlayer == 0 ? other : local);
+    simulation.step(stepSeconds);
+}
+
+// Received, or the newest received held on
+uint8_t RollbackSession::remoteInputFor(int index) const {
+    if (index <= remoteConfirmed) {
+        return remoteInputs[index % INPUT_RING];
+    }
+    return remoteConfirmed >= 0 ? remoteInputs[remoteConfirmed % INPUT_RING] : 0;
+}
+
+// A snapshot is final once every input before its frame is confirmed
+void RollbackSession::updateChecksums() {
+    int settled = std::min(remoteConfirmed + 1, frame - 1);
+    while (nextChecksumFrame <= settled) {
+        if (frame - nextChecksumFrame < STATE_RING) {
+            Checksum& own = checksums[(nextChecksumFrame / CHECKSUM_INTERVAL) % CHECKSUM_RING];
+            own.frame = nextChecksumFrame;
+            own.value = checksumOf(states[nextChecksumFrame % STATE_RING]);
+        }
+        nextChecksumFrame += CHECKSUM_INTERVAL;
+    }
+
+    if (remoteChecksumFrame > comparedChecksumFrame) {
+        const Checksum& own = checksums[(remoteChecksumFrame / CHECKSUM_INTERVAL) % CHECKSUM_RING];
+        if (own.frame == remoteChecksumFrame) {
+            stats.checksums++;
+            stats.desyncs += own.value != remoteChecksum ? 1 : 0;
+            comparedChecksumFrame = remoteChecksumFrame;
+        }
+    }
+}
+
+// Skip a few ticks when this peer is further ahead than the other; each
+// side estimates its lead from the other's last frame plus half a round trip
+bool RollbackSession::shouldWaitForPeer() {
+    int remoteNow = remoteFrame + static_cast<int>(std::lround(roundTrip / 2.0f));
+    stats.frameAdvantage = frame - remoteNow;
+    if (waitFrames > 0) {
+        waitFrames--;
+        return true;
+    }
+    int lead = (stats.frameAdvantage - remoteAdvantage) / 2;
+    if (lead >= 1 && frame - lastSyncFrame >= SYNC_INTERVAL) {
+        waitFrames = std::min(lead, MAX_SYNC_WAIT) - 1;
+        lastSyncFrame = frame;
+        return true;
+    }
+    return false;
+}
+
+// Every local input the peer has not confirmed, newest MAX_INPUTS_PER_DATAGRAM at most
+void RollbackSession::send() {
+    int firstInput = std::max(acknowledged + 1, frame - MAX_INPUTS_PER_DATAGRAM);
+    int count = std::max(0, frame - firstInput);
+    const Checksum& latest = checksums[((nextChecksumFrame / CHECKSUM_INTERVAL) + CHECKSUM_RING - 1) % CHECKSUM_RING];
+
+    datagram.clear();
+    StateWriter writer(datagram);
+    writer.u32(MAGIC);
+    writer.u8(PROTOCOL_VERSION);
+    writer.u8(static_cast<uint8_t>(localPlayer));
+    writer.u32(simulation.getSeed());
+    writer.i32(simulation.getRaceLength());
+    writer.i32(frame);
+    writer.i32(remoteConfirmed);
+    writer.i32(stats.frameAdvantage);
+    writer.i32(latest.frame);
+    writer.u32(latest.value);
+    writer.i32(firstInput);
+    writer.u8(static_cast<uint8_t>(count));
+    for (int index = firstInput; index < firstInput + count; ++index) {
+        writer.u8(localInputs[index % INPUT_RING]);
+    }
+    link.send(datagram.data(), datagram.size());
+}
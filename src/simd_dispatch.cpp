@@ -0,0 +1,28 @@
+#include "simd_dispatch.h"
+
+// Ask the CPU once; every kernel selector shares the answer
+SimdLevel detectSimdLevel() {
+    static const SimdLevel level = []() {
+#ifdef EVADOR_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+        if (__builtin_cpu_supports("sse2")) return SimdLevel::Sse2;
+#endif
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+// Levels are ordered, so anything up to the detected one runs
+bool simdLevelSupported(SimdLevel level) {
+    return static_cast<int>(level) <= static_cast<int>(detectSimdLevel());
+}
+
+// Names as printed by the tools
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::Avx2: return "avx2";
+        case SimdLevel::Sse2: return "sse2";
+        default: return "scalar";
+    }
+}
@@ -0,0 +1,529 @@
+#include "simulation.h"
+#include "state_buffer.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+const float Simulation::PLAYER_SPEED_SCALE = 20.0f;
+const float Simulation::AI_ACCELERATION = 60.0f;
+// About what holding a key gave at a typical 30 Hz key repeat, one step per repeat
+const float Simulation::PLAYER_THROTTLE_RATE = 30.0f;
+const float Simulation::PLAYER_BRAKE_RATE = 30.0f;
+const float Simulation::PLAYER_STEER_SPEED = 300.0f;
+const int Simulation::OBSTACLE_WIDTH = 42;
+const int Simulation::OBSTACLE_HEIGHT = 42;
+
+// Constructor
+Simulation::Simulation(unsigned seed, JobSystem* jobs, int raceLength, int aiCarCount)
+    : seed(seed), jobs(jobs), raceLength(raceLength), track(seed, jobs) {
+    car1 = std::make_unique<Car>(car1_initial_x, car1_initial_y);
+    car1->setFinishLine(getFinishLineY());
+    track.init(obstacles, OBSTACLE_WIDTH, OBSTACLE_HEIGHT);
+
+    // The AI's lanes span the whole width obstacles can occupy on its road
+    int carWidth = car1->getWidth();
+    AiPlanner planner(car2_initial_x, Track::roadMinX(AI_ROAD), Track::roadMaxX(AI_ROAD) + OBSTACLE_WIDTH - carWidth);
+
+    // The first AI car keeps the original spot and acceleration; the others
+    // fill columns on either side of it and accelerate a little differently
+    static const int COLUMN_OFFSETS[AI_COLUMNS] = {0, -1, 1, -2};
+    aiDrivers.reserve(std::max(1, aiCarCount));
+    for (int i = 0; i < std::max(1, aiCarCount); ++i) {
+        int x = car2_initial_x + COLUMN_OFFSETS[i % AI_COLUMNS] * AI_COLUMN_SPACING;
+        aiDrivers.emplace_back(x, car2_initial_y, aiAcceleration(seed, i), planner);
+        aiDrivers.back().car.setFinishLine(getFinishLineY());
+        aiDrivers.back().hitObstacle.assign(obstacles.size(), 0);
+    }
+
+    updateTrack();
+    publishSnapshot();
+}
+
+// The first car keeps the original acceleration, the others vary by up to a quarter
+float Simulation::aiAcceleration(unsigned seed, int index) {
+    if (index == 0) {
+        return AI_ACCELERATION;
+    }
+    std::seed_seq sequence{seed, 0xA1u, static_cast<unsigned>(index)};
+    std::mt19937 random(sequence);
+    return AI_ACCELERATION * std::uniform_real_distribution<float>(0.75f, 1.25f)(random);
+}
+
+// Set every AI car's planning budget
+void Simulation::setAiBudgetMicros(int micros) {
+    for (AiDriver& driver : aiDrivers) {
+        driver.planner.setBudgetMicros(micros);
+    }
+}
+
+// Sum of the planners' counters; the last search is the first car's
+PlannerStats Simulation::getAiPlannerStats() const {
+    PlannerStats total = aiDrivers.front().planner.getStats();
+    for (size_t i = 1; i < aiDrivers.size(); ++i) {
+        const PlannerStats& stats = aiDrivers[i].planner.getStats();
+        total.plans += stats.plans;
+        total.reuses += stats.reuses;
+        total.totalNodes += stats.totalNodes;
+        total.totalMicros += stats.totalMicros;
+        total.maxMicros = std::max(total.maxMicros, stats.maxMicros);
+    }
+    return total;
+}
+
+// Each road streams around its own cars: the AI road from its leading to its trailing car
+void Simulation::updateTrack() {
+    int aiLeadingY = aiDrivers.front().car.getY();
+    int aiTrailingY = aiLeadingY;
+    for (const AiDriver& driver : aiDrivers) {
+        aiLeadingY = std::min(aiLeadingY, driver.car.getY());
+        aiTrailingY = std::max(aiTrailingY, driver.car.getY());
+    }
+    recycledSlots.clear();
+    track.update(obstacles, PLAYER_ROAD, car1->getY(), car1->getY(), recycledSlots);
+    track.update(obstacles, AI_ROAD, aiLeadingY, aiTrailingY, recycledSlots);
+    for (AiDriver& driver : aiDrivers) {
+        for (int slot : recycledSlots) {
+            driver.hitObstacle[slot] = 0;
+        }
+    }
+}
+
+// Start the race
+void Simulation::start() {
+    if (gameState == GameState::RUNNING) {
+        return;
+    }
+    gameState = GameState::RUNNING;
+    car1->start();
+    for (AiDriver& driver : aiDrivers) {
+        driver.car.start();
+    }
+    publishSnapshot();
+}
+
+// Stop the race
+void Simulation::stop() {
+    if (gameState == GameState::RUNNING) {
+        gameState = GameState::STOPPED;
+        publishSnapshot();
+    }
+}
+
+// Reset cars and obstacles
+void Simulation::reset() {
+    if (gameState == GameState::RUNNING) {
+        return;
+    }
+    gameState = GameState::RESET;
+    winner = RaceWinner::None;
+    playerHit = false;
+    aiCollisions = 0;
+    raceTime = 0.0f;
+
+    // Reset car positions
+    car1->reset(car1_initial_x, car1_initial_y);
+    for (AiDriver& driver : aiDrivers) {
+        driver.car.reset(driver.startX, car2_initial_y);
+        driver.planner.reset();
+        driver.collisions = 0;
+        std::fill(driver.hitObstacle.begin(), driver.hitObstacle.end(), 0);
+    }
+    tick = 0;
+
+    // Lay the road from the start again
+    track.reset(obstacles);
+    updateTrack();
+    publishSnapshot();
+}
+
+// New track and AI accelerations, then back to the start
+void Simulation::reseed(unsigned newSeed) {
+    if (gameState == GameState::RUNNING) {
+        return;
+    }
+    seed = newSeed;
+    track.reseed(seed);
+    for (size_t i = 0; i < aiDrivers.size(); ++i) {
+        aiDrivers[i].acceleration = aiAcceleration(seed, static_cast<int>(i));
+    }
+    reset();
+}
+
+// Quit the game
+void Simulation::quit() {
+    gameState = GameState::QUIT;
+    publishSnapshot();
+}
+
+// Apply player controls
+void Simulation::applyInput(const PlayerInput& input) {
+    if (input.accelerate) car1->accelerate();  // This increase the car's speed
+    if (input.decelerate) car1->decelerate();  // This  decrease the car's speed
+    if (input.steerRight) car1->moveRight();   // This turns the car right
+    if (input.steerLeft) car1->moveLeft();     // This turns the car left
+}
+
+// Dispatch a command to the matching control
+void Simulation::apply(const SimulationCommand& command) {
+    switch (command.type) {
+        case SimulationCommandType::Start:
+            start();
+            break;
+        case SimulationCommandType::Stop:
+            stop();
+            break;
+        case SimulationCommandType::Toggle:
+            if (gameState == GameState::RUNNING) {
+                stop();
+            } else {
+                start();
+            }
+            break;
+        case SimulationCommandType::Reset:
+            reset();
+            break;
+        case SimulationCommandType::Quit:
+            quit();
+            break;
+        case SimulationCommandType::Input:
+            applyInput(command.input);
+            break;
+        case SimulationCommandType::Controls:
+            setHeldControls(command.input);
+            latchTappedControls(command.tapped);
+            break;
+    }
+}
+
+// Join the tasks forked with runTask
+void Simulation::waitTasks(TaskGroup& group) {
+    if (jobs) {
+        jobs->wait(group);
+    }
+}
+
+// Held controls, as rates; steering inside the step keeps it within the swept collision test
+void Simulation::driveWithControls(Car& car, const PlayerInput& controls, float deltaTime) {
+    car.savePreviousState();  // Start of the step, used to interpolate the cars while rendering
+    float throttle = (controls.accelerate ? PLAYER_THROTTLE_RATE : 0.0f) - (controls.decelerate ? PLAYER_BRAKE_RATE : 0.0f);
+    if (throttle != 0.0f) {
+        car.setSpeed(std::max(0.0f, std::min(car.getSpeed() + throttle * deltaTime, Car::MAX_SPEED)));
+    }
+    int steering = (controls.steerRight ? 1 : 0) - (controls.steerLeft ? 1 : 0);
+    car.moveSideways(steering * PLAYER_STEER_SPEED * deltaTime);
+    car.move(deltaTime * PLAYER_SPEED_SCALE);
+    car.addDistanceCovered(car.getSpeed() * deltaTime);
+}
+
+// Advance the race by one fixed step of deltaTime seconds. Per-car work
+// runs in three fork/join phases; between them the track is streamed and
+// revealed obstacles are applied on this thread, so every AI car sees the
+// same world whatever the number of threads.
+void Simulation::step(float deltaTime) {
+    // Taps count for this step only, and are dropped while the race is not running
+    const PlayerInput controls = combineControls(heldControls, tappedControls);
+    tappedControls = PlayerInput();
+    if (gameState != GameState::RUNNING) {
+        return;
+    }
+
+    // Move every car; the player's task runs alongside the AI chunks
+    TaskGroup moveGroup("update.move");
+    runTask(moveGroup, "car.move", [this, &controls, deltaTime]() {
+        driveWithControls(*car1, controls, deltaTime);
+    });
+    auto moveAi = [this, deltaTime](AiDriver& driver) {
+        Car& car = driver.car;
+        if (headToHead) {
+            driveWithControls(car, rivalControls, deltaTime);
+            return;
+        }
+        car.savePreviousState();
+        car.move(deltaTime);
+        // Gain this step's speed without exceeding MAX_SPEED
+        car.setSpeed(std::min(car.getSpeed() + driver.acceleration * deltaTime, Car::MAX_SPEED));
+        car.addDistanceCovered(car.getSpeed() * deltaTime);
+    };
+    runForAiCars(moveGroup, "ai.move", moveAi);
+    waitTasks(moveGroup);
+
+    raceTime += deltaTime;  // deltaTime should be in seconds
+
+    // Bring in the road ahead and recycle what the cars have left behind
+    updateTrack();
+
+    // Reveal obstacles near every car. The player's road is written directly;
+    // AI cars share a road, so each lists what it would reveal and the lists
+    // are applied below. The human drivers' collision tests only read positions.
+    bool car1Collided = false;
+    float car1Impact = 1.0f;
+    bool rivalCollided = false;
+    float rivalImpact = 1.0f;
+    TaskGroup revealGroup("update.reveal");
+    runTask(revealGroup, "obstacle.visibility", [this]() {
+        updateObstacleVisibility(obstacles, car1->getX(), car1->getY(), PLAYER_ROAD, playerNearby);
+    });
+    runTask(revealGroup, "car.collision", [this, &car1Collided, &car1Impact]() {
+        car1Collided = detectSweptCollision(static_cast<int>(car1->getPreviousX()), static_cast<int>(car1->getPreviousY()),
+                                            car1->getX(), car1->getY(), car1->getWidth(), car1->getHeight(),
+                                            car1Impact) >= 0;
+    });
+    if (headToHead) {
+        runTask(revealGroup, "rival.collision", [this, &rivalCollided, &rivalImpact]() {
+            const Car& rival = aiDrivers.front().car;
+            rivalCollided = detectSweptCollision(static_cast<int>(rival.getPreviousX()), static_cast<int>(rival.getPreviousY()),
+                                                 rival.getX(), rival.getY(), rival.getWidth(), rival.getHeight(),
+                                                 rivalImpact) >= 0;
+        });
+    }
+    auto findReveals = [this](AiDriver& driver) {
+        driver.reveal.clear();
+        findObstaclesToReveal(obstacles, driver.car.getX(), driver.car.getY(), AI_ROAD, driver.nearby, driver.reveal);
+    };
+    runForAiCars(revealGroup, "ai.reveal", findReveals);
+    waitTasks(revealGroup);
+    for (const AiDriver& driver : aiDrivers) {
+        for (int i : driver.reveal) {
+            obstacles.setVisible(i, true);
+        }
+    }
+
+    // Let every AI car steer around what it can see, then count what it hits;
+    // a human rival steers itself
+    TaskGroup avoidGroup("update.avoid");
+    auto avoid = [this, deltaTime](AiDriver& driver) {
+        Car& car = driver.car;
+        AvoidDirection direction = driver.planner.update(obstacles, AI_ROAD, car.getX(), car.getY(), car.getWidth(),
+                                                         car.getHeight(), car.getSpeed(), driver.acceleration,
+                                                         Car::MAX_SPEED, deltaTime, driver.nearby);
+        if (direction == AvoidDirection::Left) {
+            car.moveLeft();
+        } else if (direction == AvoidDirection::Right) {
+            car.moveRight();
+        }
+
+        // Count each obstacle a car fails to avoid once, for tuning statistics:
+        // everything crossed moving forward this step, then where the sideways move left it
+        auto countHits = [&driver, this]() {
+            for (int i : driver.nearby) {
+                if (obstacles.getRoad(i) == AI_ROAD && !driver.hitObstacle[i]) {
+                    driver.hitObstacle[i] = 1;
+                    driver.collisions++;
+                }
+            }
+        };
+        int previousX = static_cast<int>(car.getPreviousX());
+        obstacles.querySwept(previousX, static_cast<int>(car.getPreviousY()), previousX, car.getY(),
+                             car.getWidth(), car.getHeight(), driver.nearby);
+        countHits();
+        obstacles.queryOverlap(car.getX(), car.getY(), car.getWidth(), car.getHeight(), driver.nearby);
+        countHits();
+    };
+    if (!headToHead) {
+        runForAiCars(avoidGroup, "ai.avoid", avoid);
+        waitTasks(avoidGroup);
+    } else if (rivalCollided) {
+        aiDrivers.front().collisions++;
+    }
+
+    aiCollisions = 0;
+    bool aiFinished = false;
+    for (const AiDriver& driver : aiDrivers) {
+        aiCollisions += driver.collisions;
+        aiFinished = aiFinished || driver.car.hasFinished();
+    }
+
+    // Game state transitions: a crash loses the race (two in one step draw it),
+    // otherwise the first car over the line wins
+    auto stopAtContact = [](Car& car, float impact) {
+        // Leave the car where it touched the obstacle rather than wherever the step ended
+        float previousY = car.getPreviousY();
+        car.setY(static_cast<int>(std::lround(previousY + (car.getPositionY() - previousY) * impact)));
+    };
+    if (car1Collided || rivalCollided) {
+        if (car1Collided) {
+            stopAtContact(*car1, car1Impact);
+        }
+        if (rivalCollided) {
+            stopAtContact(aiDrivers.front().car, rivalImpact);
+        }
+        playerHit = car1Collided;
+        winner = car1Collided && rivalCollided ? RaceWinner::None : car1Collided ? RaceWinner::AI : RaceWinner::Player;
+        gameState = GameState::GAMEOVER;
+    } else if (car1->hasFinished()) {
+        winner = RaceWinner::Player;
+        gameState = GameState::GAMEOVER;
+    } else if (aiFinished) {
+        winner = RaceWinner::AI;
+        gameState = GameState::GAMEOVER;
+    }
+
+    tick++;
+    publishSnapshot();
+}
+
+// Keyframe layout: seed and length to catch mismatched files, then each part
+void Simulation::saveState(std::vector<uint8_t>& out) const {
+    StateWriter writer(out);
+    writer.u32(seed);
+    writer.i32(raceLength);
+    writer.u8(static_cast<uint8_t>(gameState));
+    writer.u8(static_cast<uint8_t>(winner));
+    writer.u8(playerHit ? 1 : 0);
+    writer.i32(aiCollisions);
+    writer.f32(raceTime);
+    writer.varint(tick);
+    writer.u8(heldControls.accelerate ? 1 : 0);
+    writer.u8(heldControls.decelerate ? 1 : 0);
+    writer.u8(heldControls.steerLeft ? 1 : 0);
+    writer.u8(heldControls.steerRight ? 1 : 0);
+    writer.u8(headToHead ? 1 : 0);
+    writer.u8(rivalControls.accelerate ? 1 : 0);
+    writer.u8(rivalControls.decelerate ? 1 : 0);
+    writer.u8(rivalControls.steerLeft ? 1 : 0);
+    writer.u8(rivalControls.steerRight ? 1 : 0);
+    car1->saveState(writer);
+    writer.u32(static_cast<uint32_t>(aiDrivers.size()));
+    for (const AiDriver& driver : aiDrivers) {
+        driver.car.saveState(writer);
+        driver.planner.saveState(writer);
+        writer.i32(driver.collisions);
+        writer.raw(driver.hitObstacle.data(), driver.hitObstacle.size());
+    }
+    obstacles.saveState(writer);
+    track.saveState(writer);
+}
+
+// Restore a keyframe
+bool Simulation::loadState(const uint8_t* data, size_t size) {
+    StateReader reader(data, size);
+    if (reader.u32() != seed || reader.i32() != raceLength) {
+        return false;
+    }
+    gameState = static_cast<GameState>(reader.u8());
+    winner = static_cast<RaceWinner>(reader.u8());
+    playerHit = reader.u8() != 0;
+    aiCollisions = reader.i32();
+    raceTime = reader.f32();
+    tick = reader.varint();
+    heldControls.accelerate = reader.u8() != 0;
+    heldControls.decelerate = reader.u8() != 0;
+    heldControls.steerLeft = reader.u8() != 0;
+    heldControls.steerRight = reader.u8() != 0;
+    tappedControls = PlayerInput();
+    if ((reader.u8() != 0) != headToHead) {
+        return false;
+    }
+    rivalControls.accelerate = reader.u8() != 0;
+    rivalControls.decelerate = reader.u8() != 0;
+    rivalControls.steerLeft = reader.u8() != 0;
+    rivalControls.steerRight = reader.u8() != 0;
+    car1->loadState(reader);
+    if (reader.u32() != aiDrivers.size()) {
+        return false;
+    }
+    for (AiDriver& driver : aiDrivers) {
+        driver.car.loadState(reader);
+        if (!driver.planner.loadState(reader)) {
+            return false;
+        }
+        driver.collisions = reader.i32();
+        const uint8_t* hits = reader.raw(driver.hitObstacle.size());
+        if (!hits) {
+            return false;
+        }
+        std::copy(hits, hits + driver.hitObstacle.size(), driver.hitObstacle.begin());
+    }
+    if (!obstacles.loadState(reader) || !track.loadState(reader) || !reader.ok()) {
+        return false;
+    }
+    publishSnapshot();
+    return true;
+}
+
+// Fill the back snapshot; its vectors keep their capacity, so this does not allocate once warmed up
+void Simulation::publishSnapshot() {
+    WorldSnapshot& world = snapshots.back();
+    world.tick = tick;
+    world.state = gameState;
+    world.winner = winner;
+    world.playerCollided = playerHit;
+    world.aiCollisions = aiCollisions;
+    world.raceTime = raceTime;
+    world.headToHead = headToHead;
+    world.finishLineY = getFinishLineY();
+
+    auto copyCar = [](const Car& car, CarSnapshot& snapshot) {
+        snapshot.x = car.getPositionX();
+        snapshot.y = car.getPositionY();
+        snapshot.previousX = car.getPreviousX();
+        snapshot.previousY = car.getPreviousY();
+        snapshot.speed = car.getSpeed();
+        snapshot.distanceCovered = car.getDistanceCovered();
+        snapshot.width = car.getWidth();
+        snapshot.height = car.getHeight();
+    };
+    copyCar(*car1, world.player);
+    world.aiCars.resize(aiDrivers.size());
+    for (size_t i = 0; i < aiDrivers.size(); ++i) {
+        copyCar(aiDrivers[i].car, world.aiCars[i]);
+    }
+
+    world.obstacles.clear();
+    for (size_t i = 0; i < obstacles.size(); ++i) {
+        if (obstacles.isVisible(i)) {
+            world.obstacles.push_back({obstacles.getX(i), obstacles.getY(i), obstacles.getWidth(i),
+                                       obstacles.getHeight(i), obstacles.getRoad(i)});
+        }
+    }
+    snapshots.publish();
+}
+
+// Axis-aligned overlap test between a car and every obstacle, batched over the SoA field
+int Simulation::detectCollision(int carX, int carY, int carWidth, int carHeight) const {
+    return obstacles.findFirstOverlap(carX, carY, carWidth, carHeight);
+}
+
+// Swept test of the car's move against every obstacle
+int Simulation::detectSweptCollision(int fromX, int fromY, int toX, int toY, int carWidth, int carHeight,
+                                     float& timeOfImpact) const {
+    return obstacles.findFirstSweptHit(fromX, fromY, toX, toY, carWidth, carHeight, timeOfImpact);
+}
+
+// Shows obstacles as cars approach; only obstacles the broadphase finds near the car are checked
+void Simulation::updateObstacleVisibility(ObstacleField& field, int carX, int carY, int road, std::vector<int>& nearby) {
+    field.queryRange(carX, carY, VISIBILITY_RANGE, nearby);
+    for (int i : nearby) {
+        // If the obstacle is on another road or already visible, skip the checks
+        if (field.getRoad(i) != road || field.isVisible(i)) {
+            continue;
+        }
+
+        // Calculate distance between car and obstacle
+        int dx = carX - field.getX(i);
+        int dy = carY - field.getY(i);
+        int distance = std::sqrt(dx * dx + dy * dy);
+
+        // Make obstacle visible if the car is within a certain distance
+        if (distance < VISIBILITY_RANGE) {  // 200 is the threshold distance; change it as needed
+            field.setVisible(i, true);
+        }
+    }
+}
+
+// Hidden obstacles of the road within VISIBILITY_RANGE, as updateObstacleVisibility would reveal them
+void Simulation::findObstaclesToReveal(const ObstacleField& field, int carX, int carY, int road,
+                                       std::vector<int>& nearby, std::vector<int>& reveal) {
+    field.queryRange(carX, carY, VISIBILITY_RANGE, nearby);
+    for (int i : nearby) {
+        if (field.getRoad(i) != road || field.isVisible(i)) {
+            continue;
+        }
+        int dx = carX - field.getX(i);
+        int dy = carY - field.getY(i);
+        int distance = std::sqrt(dx * dx + dy * dy);
+        if (distance < VISIBILITY_RANGE) {
+            reveal.push_back(i);
+        }
+    }
+}
@@ -0,0 +1,414 @@
+#include "simulation_thread.h"
+#include "car.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+// Layers shared with the renderer's SpriteBatch: background, track, cars;
+// particles (2) are drawn by the game between the track and the cars
+const int LAYER_BACKGROUND = 0;
+const int LAYER_TRACK = 1;
+const int LAYER_CARS = 3;
+
+// Screen row the camera keeps the player's car on
+const float PLAYER_SCREEN_Y = 550.0f;
+const float SCREEN_WIDTH = 1000.0f;
+const float SCREEN_HEIGHT = 634.0f;
+
+// Drawn car size, and the effects it leaves: exhaust and wheel dust in
+// particles per second, debris particles thrown off in a crash
+const float CAR_WIDTH = 36.0f;
+const float CAR_HEIGHT = 65.0f;
+const float EXHAUST_RATE = 40.0f;
+const float EXHAUST_RATE_AT_TOP_SPEED = 400.0f;
+const float DUST_RATE = 250.0f;             // Per wheel, at top speed or while steering
+const float DUST_SPEED_SHARE = 0.8f;        // Dust starts at this share of Car::MAX_SPEED
+const float CRASH_DEBRIS = 600.0f;
+}
+
+// Constructor
+SimulationThread::SimulationThread(Simulation& simulation, int tickRate, int maxCatchUpSteps)
+    : simulation(simulation), stepSeconds(1.0 / tickRate), maxCatchUpSteps(maxCatchUpSteps) {
+}
+
+// Destructor
+SimulationThread::~SimulationThread() {
+    stop();
+}
+
+// Spawn the thread
+void SimulationThread::start() {
+    if (thread.joinable()) {
+        return;
+    }
+    stopping.store(false);
+    thread = std::thread(&SimulationThread::loop, this);
+}
+
+// Switch to playback
+void SimulationThread::setReplay(ReplayPlayer* player, float speed) {
+    replay = player;
+    replaySpeed = speed > 0.0f ? speed : 1.0f;
+}
+
+// Join the thread
+void SimulationThread::stop() {
+    stopping.store(true);
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+// Queue a command
+bool SimulationThread::post(const SimulationCommand& command) {
+    if (!commands.push(command)) {
+        std::fprintf(stderr, "Simulation command queue full, dropping a command\n");
+        return false;
+    }
+    return true;
+}
+
+// Queue a command without input
+bool SimulationThread::post(SimulationCommandType type) {
+    SimulationCommand command;
+    command.type = type;
+    return post(command);
+}
+
+// Keep only the newest list queued
+const DrawList* SimulationThread::acquireDrawList() {
+    while (drawLists.size() > 1) {
+        drawLists.pop();
+    }
+    return drawLists.front();
+}
+
+// The fixed-step loop: commands, steps, then one recorded list
+void SimulationThread::loop() {
+    PROFILE_THREAD("simulation");
+    Clock::time_point previous = Clock::now();
+    double accumulator = 0.0;
+    bool needsRecord = true;  // Something changed that the renderer has not been sent yet
+
+    while (!stopping.load(std::memory_order_relaxed)) {
+        needsRecord |= applyCommands();
+        if (simulation.getState() == GameState::QUIT) {
+            record();
+            quit.store(true, std::memory_order_release);
+            return;
+        }
+
+        Clock::time_point now = Clock::now();
+        double elapsed = std::chrono::duration<double>(now - previous).count();
+        previous = now;
+
+        // Netplay keeps ticking before and after the race to talk to the peer
+        bool active = replay ? !replayPaused && !replay->isFinished()
+                             : netplay || simulation.getState() == GameState::RUNNING;
+        if (active) {
+            accumulator += elapsed * (replay ? replaySpeed : 1.0f);
+            int maxSteps = replay ? static_cast<int>(maxCatchUpSteps * std::ceil(replaySpeed)) : maxCatchUpSteps;
+            int steps = 0;
+            while (accumulator >= stepSeconds && steps < maxSteps) {
+                previousBackgroundScale = backgroundScale;
+                if (scaling) {
+                    backgroundScale = std::min(backgroundScale + SCALE_RATE * static_cast<float>(stepSeconds), MAX_SCALE);
+                }
+                {
+                    PROFILE_ZONE("Simulation step");
+                    if (replay) {
+                        // Applies the recorded commands of this step first
+                        if (!replay->advance()) {
+                            needsRecord = true;  // The last commands may have changed the scene
+                            break;
+                        }
+                        scaling = scaling || simulation.getState() == GameState::RUNNING;
+                    } else if (netplay) {
+                        netplay->tick();
+                        scaling = scaling || simulation.getState() == GameState::RUNNING;
+                    } else {
+                        simulation.step(static_cast<float>(stepSeconds));
+                        if (recorder) recorder->recordStep(simulation);
+                    }
+                }
+                if (backgroundScale == MAX_SCALE && previousBackgroundScale < MAX_SCALE) {
+                    roadOriginY = viewedCar().getY() - PLAYER_SCREEN_Y;
+                }
+                accumulator -= stepSeconds;
+                ++steps;
+                ticks.fetch_add(1, std::memory_order_relaxed);
+                if (!replay && !netplay && simulation.getState() != GameState::RUNNING) break;
+            }
+            // Too far behind (e.g. after a hitch): drop the backlog instead of teleporting the cars
+            if (steps == maxSteps && accumulator >= stepSeconds) {
+                accumulator = 0.0;
+            }
+            if (steps > 0) {
+                lastStepTime = Clock::now();
+                needsRecord = true;
+                shownInputSequence = appliedInputSequence;
+            }
+        } else {
+            accumulator = 0.0;
+            shownInputSequence = appliedInputSequence;
+        }
+
+        if (needsRecord) {
+            needsRecord = !record();
+        }
+
+        // Sleep until the next step is due
+        double untilNextStep = stepSeconds - accumulator;
+        std::this_thread::sleep_until(now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(untilNextStep)));
+    }
+}
+
+// Apply everything the main thread posted since the last tick
+bool SimulationThread::applyCommands() {
+    if (!commands.front()) {
+        return false;
+    }
+    PROFILE_ZONE("Apply commands");
+    while (SimulationCommand* command = commands.front()) {
+        if (replay) {
+            // The recording drives the race; the player can only pause or leave
+            if (command->type == SimulationCommandType::Quit) {
+                simulation.quit();
+            } else if (command->type == SimulationCommandType::Toggle) {
+                replayPaused = !replayPaused;
+            }
+        } else if (netplay) {
+            // Both players' controls go through the session, which starts the race itself
+            if (command->type == SimulationCommandType::Quit) {
+                simulation.quit();
+            } else if (command->type == SimulationCommandType::Controls) {
+                netplay->setLocalControls(command->input, command->tapped);
+                appliedInputSequence = std::max(appliedInputSequence, command->inputSequence);
+            }
+        } else {
+            if (recorder) {
+                recorder->recordCommand(*command);
+            }
+            simulation.apply(*command);
+            appliedInputSequence = std::max(appliedInputSequence, command->inputSequence);
+            scaling = scaling || simulation.getState() == GameState::RUNNING;
+        }
+        commands.pop();
+    }
+    return true;
+}
+
+// Turn the latest snapshot into draw commands
+bool SimulationThread::record() {
+    DrawList* list = drawLists.beginPush();
+    if (!list) {
+        droppedLists.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    PROFILE_ZONE("Record draw list");
+
+    recordWorld(simulation.acquireSnapshot(), previousBackgroundScale, backgroundScale, roadOriginY, *list,
+                netplay ? netplay->getLocalPlayer() : 0);
+    list->stepTime = lastStepTime;
+    list->stepSeconds = static_cast<float>(stepSeconds);
+    list->inputSequence = shownInputSequence;
+    list->obstacleCount = static_cast<int>(simulation.getObstacles().size());
+    list->aiPlanner = simulation.getAiPlannerStats();
+    list->netplay = netplay != nullptr;
+    if (netplay) {
+        list->rollback = netplay->getStats();
+        recordNetplayStatus(*list);
+    }
+    drawLists.commitPush();
+    return true;
+}
+
+// Connection state, or what the last correction cost, along the bottom of the screen
+void SimulationThread::recordNetplayStatus(DrawList& list) const {
+    char line[128];
+    if (netplay->hasFailed()) {
+        std::snprintf(line, sizeof(line), "Netplay failed: %.90s", netplay->getError().c_str());
+    } else if (!netplay->isConnected()) {
+        std::snprintf(line, sizeof(line), "Waiting for the other player...");
+    } else {
+        const RollbackStats& stats = list.rollback;
+        std::snprintf(line, sizeof(line), "Ping %d frames  Rollbacks %llu (last %d frames, %.0f us)  Stalls %llu",
+                      stats.roundTripFrames, static_cast<unsigned long long>(stats.rollbacks),
+                      stats.lastRollbackFrames, stats.lastResimMicros, static_cast<unsigned long long>(stats.stalls));
+    }
+    DrawCommand& status = list.addText(line, FontId::Normal, 10.0f, 596.0f);
+    status.color = {255, 255, 0, 255};
+}
+
+// The local player's car, which is the rival's when joining a netplay race
+const Car& SimulationThread::viewedCar() const {
+    if (netplay && netplay->getLocalPlayer() == 1) {
+        return simulation.ai();
+    }
+    return simulation.player();
+}
+
+// Everything drawn for one world state
+void SimulationThread::recordWorld(const WorldSnapshot& world, float previousBackgroundScale,
+                                   float backgroundScale, float roadOriginY, DrawList& list, int localPlayer) {
+    bool rivalView = world.headToHead && localPlayer == 1 && !world.aiCars.empty();
+    const CarSnapshot& viewed = rivalView ? world.aiCars.front() : world.player;
+    list.clear();
+    list.tick = world.tick;
+    list.cameraPreviousY = viewed.previousY - PLAYER_SCREEN_Y;
+    list.cameraY = viewed.y - PLAYER_SCREEN_Y;
+
+    // Background: the picture zooming around the screen centre, then the road
+    DrawCommand background;
+    background.layer = LAYER_BACKGROUND;
+    background.width = SCREEN_WIDTH;
+    background.x = background.previousX = 0.0f;
+    if (previousBackgroundScale < MAX_SCALE) {
+        background.type = DrawCommandType::Sprite;
+        background.sprite = SpriteId::Background;
+        background.screenSpace = true;
+        background.height = SCREEN_HEIGHT * backgroundScale;
+        background.y = (SCREEN_HEIGHT - background.height) / 2;
+        background.previousY = (SCREEN_HEIGHT - SCREEN_HEIGHT * previousBackgroundScale) / 2;
+    } else {
+        background.type = DrawCommandType::ScrollingBackground;
+        background.height = SCREEN_HEIGHT;
+        background.y = background.previousY = roadOriginY;
+    }
+    list.commands.push_back(background);
+
+    // Finish line across both roads
+    DrawCommand finish;
+    finish.type = DrawCommandType::Rect;
+    finish.layer = LAYER_TRACK;
+    finish.x = finish.previousX = 300.0f;
+    finish.y = finish.previousY = static_cast<float>(world.finishLineY);
+    finish.width = 400.0f;
+    finish.height = 4.0f;
+    list.commands.push_back(finish);
+
+    for (const ObstacleSnapshot& obstacle : world.obstacles) {
+        DrawCommand command;
+        command.sprite = SpriteId::Obstacle;
+        command.layer = LAYER_TRACK;
+        command.x = command.previousX = static_cast<float>(obstacle.x);
+        command.y = command.previousY = static_cast<float>(obstacle.y);
+        command.width = static_cast<float>(obstacle.width);
+        command.height = static_cast<float>(obstacle.height);
+        list.commands.push_back(command);
+    }
+
+    auto addCar = [&list](const CarSnapshot& car, SpriteId sprite) {
+        DrawCommand command;
+        command.sprite = sprite;
+        command.layer = LAYER_CARS;
+        command.previousX = car.previousX;
+        command.previousY = car.previousY;
+        command.x = car.x;
+        command.y = car.y;
+        command.width = 36.0f;
+        command.height = 65.0f;
+        list.commands.push_back(command);
+    };
+    for (const CarSnapshot& car : world.aiCars) {
+        addCar(car, SpriteId::AiCar);
+    }
+    addCar(world.player, SpriteId::PlayerCar);
+
+    // Effects, for cars in view: exhaust behind every moving car, dust from
+    // the rear wheels near top speed or while steering, debris from a crash
+    auto addEffects = [&list](const CarSnapshot& car, bool running, bool crashed) {
+        if (car.y + CAR_HEIGHT < list.cameraY || car.y >= list.cameraY + SCREEN_HEIGHT) {
+            return;
+        }
+        if (crashed) {
+            ParticleEmitter debris;
+            debris.kind = ParticleKind::Debris;
+            debris.burst = true;
+            debris.count = CRASH_DEBRIS;
+            debris.x = car.x + CAR_WIDTH / 2;
+            debris.y = car.y;
+            debris.spread = 220.0f;
+            list.emitters.push_back(debris);
+        }
+        if (!running || car.speed <= 0.0f) {
+            return;
+        }
+        float share = car.speed / Car::MAX_SPEED;
+        ParticleEmitter exhaust;
+        exhaust.kind = ParticleKind::Exhaust;
+        exhaust.count = EXHAUST_RATE + (EXHAUST_RATE_AT_TOP_SPEED - EXHAUST_RATE) * share;
+        exhaust.x = car.x + CAR_WIDTH / 2;
+        exhaust.y = car.y + CAR_HEIGHT;
+        exhaust.velocityY = 60.0f;
+        exhaust.spread = 25.0f;
+        list.emitters.push_back(exhaust);
+
+        float steering = car.x - car.previousX;
+        if (share >= DUST_SPEED_SHARE || steering != 0.0f) {
+            for (float wheelX : {6.0f, CAR_WIDTH - 6.0f}) {
+                ParticleEmitter dust;
+                dust.kind = ParticleKind::Dust;
+                dust.count = DUST_RATE * std::max(share, 0.5f);
+                dust.x = car.x + wheelX;
+                dust.y = car.y + CAR_HEIGHT - 8.0f;
+                dust.velocityX = steering > 0.0f ? -80.0f : steering < 0.0f ? 80.0f : 0.0f;  // Thrown away from the turn
+                dust.velocityY = 40.0f;
+                dust.spread = 40.0f;
+                list.emitters.push_back(dust);
+            }
+        }
+    };
+    bool running = world.state == GameState::RUNNING;
+    bool gameOver = world.state == GameState::GAMEOVER;
+    addEffects(world.player, running, gameOver && world.playerCollided);
+    for (size_t i = 0; i < world.aiCars.size(); ++i) {
+        // Only a human rival's crash ends the race; AI cars drive on after theirs
+        addEffects(world.aiCars[i], running, gameOver && world.headToHead && i == 0 && world.aiCollisions > 0);
+    }
+
+    // The HUD follows the leading AI car
+    const CarSnapshot* leader = nullptr;
+    for (const CarSnapshot& car : world.aiCars) {
+        if (!leader || car.y < leader->y) {
+            leader = &car;
+        }
+    }
+
+    // Statistics, formatted into stack buffers so steady-state recording does not allocate
+    auto addStatistics = [&list](HudPanel panel, float x, const char* carName, const CarSnapshot& car) {
+        char line[64];
+        std::snprintf(line, sizeof(line), "%s Speed: %.2f", carName, car.speed);
+        list.addText(line, FontId::Normal, x, 64.0f).panel = panel;
+        std::snprintf(line, sizeof(line), "%s Distance: %.2f", carName, car.distanceCovered);
+        DrawCommand& distance = list.addText(line, FontId::Normal, x, 64.0f);
+        distance.line = 1;
+        distance.panel = panel;
+    };
+    if (world.headToHead) {
+        addStatistics(HudPanel::Player, 200.0f, rivalView ? "Rival" : "You", world.player);
+        if (leader) {
+            addStatistics(HudPanel::Computer, 580.0f, rivalView ? "You" : "Rival", *leader);
+        }
+    } else {
+        addStatistics(HudPanel::Player, 200.0f, "You", world.player);
+        if (leader) {
+            addStatistics(HudPanel::Computer, 580.0f, "Computer", *leader);
+        }
+    }
+
+    if (world.state == GameState::GAMEOVER) {
+        const char* message = world.winner == RaceWinner::Player ? "You beat the AI" : "You lost to AI";
+        if (world.headToHead) {
+            bool won = world.winner == (rivalView ? RaceWinner::AI : RaceWinner::Player);
+            message = world.winner == RaceWinner::None ? "Both crashed" : won ? "You win" : "You lost";
+        }
+        DrawCommand& text = list.addText(message, FontId::Large, SCREEN_WIDTH / 2, 318.0f);
+        text.align = TextAlign::Center;
+        text.blink = true;
+        text.color = {255, 0, 0, 255};
+        text.panel = HudPanel::Banner;
+    }
+}
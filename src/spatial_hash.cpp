@@ -0,0 +1,145 @@
+#include "spatial_hash.h"
+#include <algorithm>
+
+// Constructor
+SpatialHash::SpatialHash(int cellSize) : cellSize(cellSize > 0 ? cellSize : 64) {}
+
+// Floor division, so negative coordinates land in the right cell
+int SpatialHash::cellCoordinate(int value) const {
+    return value >= 0 ? value / cellSize : -((-value + cellSize - 1) / cellSize);
+}
+
+// Pack two cell coordinates into one map key
+uint64_t SpatialHash::key(int cellX, int cellY) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(cellX)) << 32) | static_cast<uint32_t>(cellY);
+}
+
+// Cells covered by a box (its right and bottom edges are exclusive)
+SpatialHash::CellRange SpatialHash::cellsOf(int x, int y, int width, int height) const {
+    CellRange range;
+    range.minX = cellCoordinate(x);
+    range.minY = cellCoordinate(y);
+    range.maxX = cellCoordinate(x + std::max(width, 1) - 1);
+    range.maxY = cellCoordinate(y + std::max(height, 1) - 1);
+    return range;
+}
+
+// Add a box to every cell it covers
+void SpatialHash::insert(int id, int x, int y, int width, int height) {
+    CellRange range = cellsOf(x, y, width, height);
+    for (int cy = range.minY; cy <= range.maxY; ++cy) {
+        for (int cx = range.minX; cx <= range.maxX; ++cx) {
+            cellAt(key(cx, cy)).push_back(Entry{id, range.minX, range.minY});
+        }
+    }
+}
+
+// A box w pixels wide covers at most (w - 1) / cellSize + 2 columns, likewise rows
+void SpatialHash::reserveFor(int width, int height) {
+    size_t columns = static_cast<size_t>((std::max(width, 1) - 1) / cellSize + 2);
+    size_t rows = static_cast<size_t>((std::max(height, 1) - 1) / cellSize + 2);
+    reservedCells += columns * rows;
+    cells.reserve(reservedCells);
+    spareCells.reserve(reservedCells);
+
+    // Nodes are made in a scratch map, since only a map can create them
+    CellMap scratch;
+    for (; ownedCells < reservedCells; ++ownedCells) {
+        std::vector<Entry> entries;
+        entries.reserve(SPARE_ENTRIES);
+        scratch.emplace(0, std::move(entries));
+        spareCells.push_back(scratch.extract(scratch.begin()));
+    }
+}
+
+// Drop one id from one cell
+void SpatialHash::removeFromCell(int cellX, int cellY, int id) {
+    auto cell = cells.find(key(cellX, cellY));
+    if (cell == cells.end()) {
+        return;
+    }
+    auto& entries = cell->second;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        if (entries[i].id == id) {
+            entries[i] = entries.back();
+            entries.pop_back();
+            break;
+        }
+    }
+    if (entries.empty()) {
+        retire(cell);
+    }
+}
+
+// Re-key a spare node rather than allocating a new one
+std::vector<SpatialHash::Entry>& SpatialHash::cellAt(uint64_t cellKey) {
+    auto cell = cells.find(cellKey);
+    if (cell != cells.end()) {
+        return cell->second;
+    }
+    if (spareCells.empty()) {
+        ownedCells++;
+        return cells[cellKey];
+    }
+    CellMap::node_type node = std::move(spareCells.back());
+    spareCells.pop_back();
+    node.key() = cellKey;
+    return cells.insert(std::move(node)).position->second;
+}
+
+// The node keeps its entry vector, and with it the capacity
+void SpatialHash::retire(CellMap::iterator cell) {
+    spareCells.push_back(cells.extract(cell));
+}
+
+// Remove a box from every cell it covers
+void SpatialHash::remove(int id, int x, int y, int width, int height) {
+    CellRange range = cellsOf(x, y, width, height);
+    for (int cy = range.minY; cy <= range.maxY; ++cy) {
+        for (int cx = range.minX; cx <= range.maxX; ++cx) {
+            removeFromCell(cx, cy, id);
+        }
+    }
+}
+
+// Move a box
+void SpatialHash::update(int id, int oldX, int oldY, int newX, int newY, int width, int height) {
+    CellRange from = cellsOf(oldX, oldY, width, height);
+    CellRange to = cellsOf(newX, newY, width, height);
+    if (from.minX == to.minX && from.minY == to.minY && from.maxX == to.maxX && from.maxY == to.maxY) {
+        return; // Still in the same cells
+    }
+    // The first covered cell is part of every entry, so re-list the box
+    remove(id, oldX, oldY, width, height);
+    insert(id, newX, newY, width, height);
+}
+
+// Remove everything, keeping the cells as spares for the boxes added next
+void SpatialHash::clear() {
+    reservedCells = 0;
+    while (!cells.empty()) {
+        auto cell = cells.begin();
+        cell->second.clear();
+        retire(cell);
+    }
+}
+
+// Collect candidate ids around a box
+void SpatialHash::query(int x, int y, int width, int height, std::vector<int>& out) const {
+    CellRange range = cellsOf(x, y, width, height);
+    for (int cy = range.minY; cy <= range.maxY; ++cy) {
+        for (int cx = range.minX; cx <= range.maxX; ++cx) {
+            auto cell = cells.find(key(cx, cy));
+            if (cell == cells.end()) {
+                continue;
+            }
+            for (const Entry& entry : cell->second) {
+                // A box spanning several cells is reported only from the first
+                // cell both it and the query cover, so no visited set is needed
+                if (cx == std::max(entry.firstCellX, range.minX) && cy == std::max(entry.firstCellY, range.minY)) {
+                    out.push_back(entry.id);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,147 @@
+#include "sprite_batch.h"
+#include "profiler.h"
+#include <algorithm>
+#include <iostream>
+
+// Constructor
+SpriteBatch::SpriteBatch(SDL_Renderer* renderer) : renderer(renderer) {
+    sprites.reserve(256);
+    vertices.reserve(1024);
+    indices.reserve(1536);
+}
+
+// Size of a texture; textures are few, so a flat list beats a map
+std::pair<int, int> SpriteBatch::textureSize(SDL_Texture* texture) {
+    for (const auto& entry : textureSizes) {
+        if (entry.first == texture) {
+            return entry.second;
+        }
+    }
+    int width = 0, height = 0;
+    SDL_QueryTexture(texture, nullptr, nullptr, &width, &height);
+    textureSizes.push_back({texture, {width, height}});
+    return {width, height};
+}
+
+// Forget a texture's cached size
+void SpriteBatch::forgetTexture(SDL_Texture* texture) {
+    textureSizes.erase(std::remove_if(textureSizes.begin(), textureSizes.end(),
+                                      [texture](const std::pair<SDL_Texture*, std::pair<int, int>>& entry) {
+                                          return entry.first == texture;
+                                      }),
+                       textureSizes.end());
+}
+
+// Queue one quad; nothing is drawn until flush()
+void SpriteBatch::draw(SDL_Texture* texture, const SDL_Rect* source, const SDL_FRect& destination, int layer,
+                       SDL_Color color) {
+    Sprite sprite;
+    sprite.layer = layer;
+    sprite.texture = texture;
+    sprite.order = static_cast<uint32_t>(sprites.size());
+    sprite.destination = destination;
+    sprite.color = color;
+    sprite.u0 = 0.0f;
+    sprite.v0 = 0.0f;
+    sprite.u1 = 1.0f;
+    sprite.v1 = 1.0f;
+    sprite.quadVertices = nullptr;
+    sprite.quadCount = 0;
+
+    if (texture && source) {
+        std::pair<int, int> size = textureSize(texture);
+        if (size.first > 0 && size.second > 0) {
+            sprite.u0 = static_cast<float>(source->x) / size.first;
+            sprite.v0 = static_cast<float>(source->y) / size.second;
+            sprite.u1 = static_cast<float>(source->x + source->w) / size.first;
+            sprite.v1 = static_cast<float>(source->y + source->h) / size.second;
+        }
+    }
+    sprites.push_back(sprite);
+}
+
+// Queue a prebuilt batch as one entry
+void SpriteBatch::drawQuads(SDL_Texture* texture, const SDL_Vertex* quadVertices, int quadCount, int layer) {
+    if (quadCount <= 0) {
+        return;
+    }
+    Sprite sprite;
+    sprite.layer = layer;
+    sprite.texture = texture;
+    sprite.order = static_cast<uint32_t>(sprites.size());
+    sprite.quadVertices = quadVertices;
+    sprite.quadCount = quadCount;
+    sprites.push_back(sprite);
+}
+
+// Sort by (layer, texture) and issue one draw call per group
+void SpriteBatch::flush() {
+    PROFILE_ZONE("Sprite batch flush");
+    stats = FrameStats();
+    stats.sprites = static_cast<int>(sprites.size());
+
+    std::sort(sprites.begin(), sprites.end(), [](const Sprite& a, const Sprite& b) {
+        if (a.layer != b.layer) return a.layer < b.layer;
+        if (a.texture != b.texture) return a.texture < b.texture;
+        return a.order < b.order;
+    });
+
+    size_t groupStart = 0;
+    while (groupStart < sprites.size()) {
+        // A prebuilt batch goes out on its own, with a shared index list
+        const Sprite& first = sprites[groupStart];
+        if (first.quadVertices) {
+            size_t needed = static_cast<size_t>(first.quadCount) * 6;
+            for (int quad = static_cast<int>(quadIndices.size() / 6); quadIndices.size() < needed; ++quad) {
+                int base = quad * 4;
+                quadIndices.insert(quadIndices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+            }
+            if (SDL_RenderGeometry(renderer, first.texture, first.quadVertices, first.quadCount * 4, quadIndices.data(),
+                                   static_cast<int>(needed)) < 0) {
+                std::cerr << "SDL_RenderGeometry failed: " << SDL_GetError() << std::endl;
+            }
+            stats.sprites += first.quadCount - 1;
+            stats.drawCalls++;
+            stats.vertices += first.quadCount * 4;
+            ++groupStart;
+            continue;
+        }
+
+        size_t groupEnd = groupStart;
+        vertices.clear();
+        indices.clear();
+
+        while (groupEnd < sprites.size() && sprites[groupEnd].layer == sprites[groupStart].layer &&
+               sprites[groupEnd].texture == sprites[groupStart].texture && !sprites[groupEnd].quadVertices) {
+            const Sprite& sprite = sprites[groupEnd];
+            float left = sprite.destination.x;
+            float top = sprite.destination.y;
+            float right = left + sprite.destination.w;
+            float bottom = top + sprite.destination.h;
+
+            int base = static_cast<int>(vertices.size());
+            vertices.push_back({{left, top}, sprite.color, {sprite.u0, sprite.v0}});
+            vertices.push_back({{right, top}, sprite.color, {sprite.u1, sprite.v0}});
+            vertices.push_back({{right, bottom}, sprite.color, {sprite.u1, sprite.v1}});
+            vertices.push_back({{left, bottom}, sprite.color, {sprite.u0, sprite.v1}});
+
+            indices.push_back(base);
+            indices.push_back(base + 1);
+            indices.push_back(base + 2);
+            indices.push_back(base);
+            indices.push_back(base + 2);
+            indices.push_back(base + 3);
+            ++groupEnd;
+        }
+
+        if (SDL_RenderGeometry(renderer, sprites[groupStart].texture, vertices.data(), static_cast<int>(vertices.size()),
+                               indices.data(), static_cast<int>(indices.size())) < 0) {
+            std::cerr << "SDL_RenderGeometry failed: " << SDL_GetError() << std::endl;
+        }
+        stats.drawCalls++;
+        stats.vertices += static_cast<int>(vertices.size());
+        groupStart = groupEnd;
+    }
+
+    sprites.clear();
+}
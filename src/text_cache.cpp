@@ -0,0 +1,252 @@
+#include "text_cache.h"
+#include "profiler.h"
+#include <iostream>
+
+// Constructor
+TextCache::TextCache(SDL_Renderer* renderer) : renderer(renderer) {
+    vertices.reserve(1024);
+    indices.reserve(1536);
+}
+
+// Destructor: the shared_ptr deleters close the fonts and the atlas texture
+TextCache::~TextCache() {}
+
+// Open a font and rasterize its printable glyphs once
+int TextCache::loadFont(const std::string& path, int pointSize) {
+    int existing = findFont(path, pointSize);
+    if (existing >= 0) {
+        return existing;
+    }
+
+    Font font;
+    if (!rasterizeFont(path, pointSize, font)) {
+        return -1;
+    }
+    return addFont(std::move(font));
+}
+
+// Id of a loaded (path, size) pair
+int TextCache::findFont(const std::string& path, int pointSize) const {
+    for (size_t i = 0; i < fonts.size(); ++i) {
+        if (fonts[i].path == path && fonts[i].pointSize == pointSize) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+// Open the font file and render every printable glyph to its own surface
+bool TextCache::rasterizeFont(const std::string& path, int pointSize, Font& font) {
+    PROFILE_ZONE("Rasterize font");
+    TTF_Font* opened = TTF_OpenFont(path.c_str(), pointSize);
+    if (!opened) {
+        std::cerr << "Failed to load font " << path << ": " << TTF_GetError() << std::endl;
+        return false;
+    }
+
+    font.path = path;
+    font.pointSize = pointSize;
+    font.handle = std::shared_ptr<TTF_Font>(opened, TTF_CloseFont);
+    font.height = TTF_FontHeight(opened);
+    font.surfaces.clear();
+
+    SDL_Color white = {255, 255, 255, 255};
+    for (int c = FIRST_GLYPH; c <= LAST_GLYPH; ++c) {
+        Glyph& glyph = font.glyphs[c - FIRST_GLYPH];
+        glyph.source = {0, 0, 0, 0};
+        glyph.advance = 0;
+
+        int minx, maxx, miny, maxy, advance;
+        if (TTF_GlyphMetrics(opened, static_cast<Uint16>(c), &minx, &maxx, &miny, &maxy, &advance) == 0) {
+            glyph.advance = advance;
+        }
+
+        SDL_Surface* surface = TTF_RenderGlyph_Blended(opened, static_cast<Uint16>(c), white);
+        if (surface) {
+            glyph.source.w = surface->w;
+            glyph.source.h = surface->h;
+        }
+        font.surfaces.emplace_back(surface, SDL_FreeSurface);
+    }
+    return true;
+}
+
+// Register a rasterized font; its glyphs join the atlas on the next draw
+int TextCache::addFont(Font font) {
+    if (externalAtlas) {
+        std::cerr << "Cannot add font " << font.path << " to a prebuilt glyph atlas" << std::endl;
+        return -1;
+    }
+    fonts.push_back(std::move(font));
+    atlasDirty = true;
+    return static_cast<int>(fonts.size() - 1);
+}
+
+// Register a font whose glyphs are already in a prebuilt atlas texture
+int TextCache::addPackedFont(const std::string& path, const PackedFont& packed,
+                             std::shared_ptr<SDL_Texture> packedAtlas, int width, int height) {
+    if ((!fonts.empty() && !externalAtlas) || (atlas && atlas != packedAtlas)) {
+        std::cerr << "Cannot mix font " << path << " with glyphs of another atlas" << std::endl;
+        return -1;
+    }
+
+    Font font;
+    font.path = path;
+    font.pointSize = static_cast<int>(packed.pointSize);
+    font.height = packed.height;
+    for (int c = FIRST_GLYPH; c <= LAST_GLYPH; ++c) {
+        const PackedGlyph& source = packed.glyphs[c - PackedFont::FIRST_GLYPH];
+        Glyph& glyph = font.glyphs[c - FIRST_GLYPH];
+        glyph.source = {source.x, source.y, source.w, source.h};
+        glyph.advance = source.advance;
+    }
+
+    fonts.push_back(std::move(font));
+    atlas = std::move(packedAtlas);
+    atlasWidth = width;
+    atlasHeight = height;
+    externalAtlas = true;
+    atlasDirty = false;
+    return static_cast<int>(fonts.size() - 1);
+}
+
+// Pack the glyphs of every loaded font into a single texture
+bool TextCache::buildAtlas() {
+    PROFILE_ZONE("Build glyph atlas");
+    // Shelf packing: glyphs are laid out left to right in rows of the font height
+    int penX = 0;
+    int penY = 0;
+    int rowHeight = 0;
+    for (auto& font : fonts) {
+        for (auto& glyph : font.glyphs) {
+            if (penX + glyph.source.w > atlasWidth) {
+                penX = 0;
+                penY += rowHeight;
+                rowHeight = 0;
+            }
+            glyph.source.x = penX;
+            glyph.source.y = penY;
+            penX += glyph.source.w;
+            if (glyph.source.h > rowHeight) rowHeight = glyph.source.h;
+        }
+    }
+    atlasHeight = penY + rowHeight;
+
+    std::shared_ptr<SDL_Surface> sheet(
+        SDL_CreateRGBSurfaceWithFormat(0, atlasWidth, atlasHeight, 32, SDL_PIXELFORMAT_RGBA32),
+        SDL_FreeSurface);
+    if (!sheet) {
+        std::cerr << "Unable to create glyph atlas surface! SDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    SDL_FillRect(sheet.get(), nullptr, 0);
+
+    for (auto& font : fonts) {
+        for (size_t i = 0; i < font.glyphs.size(); ++i) {
+            SDL_Surface* glyphSurface = font.surfaces[i].get();
+            if (!glyphSurface) continue;
+            SDL_SetSurfaceBlendMode(glyphSurface, SDL_BLENDMODE_NONE);
+            SDL_Rect dest = font.glyphs[i].source;
+            SDL_BlitSurface(glyphSurface, nullptr, sheet.get(), &dest);
+        }
+    }
+
+    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, sheet.get());
+    if (!texture) {
+        std::cerr << "Unable to create glyph atlas texture! SDL Error: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+    atlas = std::shared_ptr<SDL_Texture>(texture, SDL_DestroyTexture);
+    atlasDirty = false;
+    return true;
+}
+
+// Look up the atlas entry of a character, or nullptr if it has none
+const TextCache::Glyph* TextCache::findGlyph(const Font& font, char c) const {
+    int code = static_cast<unsigned char>(c);
+    if (code < FIRST_GLYPH || code > LAST_GLYPH) {
+        return nullptr;
+    }
+    return &font.glyphs[code - FIRST_GLYPH];
+}
+
+// Queue the quads of a string; nothing is drawn until flush()
+void TextCache::drawText(int fontId, int x, int y, const char* text, SDL_Color color) {
+    if (fontId < 0 || fontId >= static_cast<int>(fonts.size())) {
+        return;
+    }
+    if (atlasDirty && !buildAtlas()) {
+        return;
+    }
+
+    const Font& font = fonts[fontId];
+    float invWidth = 1.0f / atlasWidth;
+    float invHeight = 1.0f / atlasHeight;
+    int penX = x;
+
+    for (const char* c = text; *c; ++c) {
+        const Glyph* glyph = findGlyph(font, *c);
+        if (!glyph) continue;
+
+        if (glyph->source.w > 0) {
+            const SDL_Rect& src = glyph->source;
+            float left = static_cast<float>(penX);
+            float top = static_cast<float>(y);
+            float right = left + src.w;
+            float bottom = top + src.h;
+            float u0 = src.x * invWidth;
+            float v0 = src.y * invHeight;
+            float u1 = (src.x + src.w) * invWidth;
+            float v1 = (src.y + src.h) * invHeight;
+
+            int base = static_cast<int>(vertices.size());
+            vertices.push_back({{left, top}, color, {u0, v0}});
+            vertices.push_back({{right, top}, color, {u1, v0}});
+            vertices.push_back({{right, bottom}, color, {u1, v1}});
+            vertices.push_back({{left, bottom}, color, {u0, v1}});
+
+            indices.push_back(base);
+            indices.push_back(base + 1);
+            indices.push_back(base + 2);
+            indices.push_back(base);
+            indices.push_back(base + 2);
+            indices.push_back(base + 3);
+        }
+        penX += glyph->advance;
+    }
+}
+
+// Width of a string in pixels
+int TextCache::measureText(int fontId, const char* text) const {
+    if (fontId < 0 || fontId >= static_cast<int>(fonts.size())) {
+        return 0;
+    }
+    int width = 0;
+    for (const char* c = text; *c; ++c) {
+        const Glyph* glyph = findGlyph(fonts[fontId], *c);
+        if (glyph) width += glyph->advance;
+    }
+    return width;
+}
+
+// Height of one line of text
+int TextCache::lineHeight(int fontId) const {
+    if (fontId < 0 || fontId >= static_cast<int>(fonts.size())) {
+        return 0;
+    }
+    return fonts[fontId].height;
+}
+
+// Draw every queued glyph with one SDL_RenderGeometry call
+void TextCache::flush() {
+    PROFILE_ZONE("Text flush");
+    if (!indices.empty() && atlas) {
+        if (SDL_RenderGeometry(renderer, atlas.get(), vertices.data(), static_cast<int>(vertices.size()),
+                               indices.data(), static_cast<int>(indices.size())) < 0) {
+            std::cerr << "SDL_RenderGeometry failed: " << SDL_GetError() << std::endl;
+        }
+    }
+    vertices.clear();
+    indices.clear();
+}
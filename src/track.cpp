@@ -0,0 +1,270 @@
+#include "track.h"
+#include "state_buffer.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+
+// Where unused slots wait: far off every road, so no query ever finds them
+const int PARK_X = -100000;
+const int PARK_Y = 0;
+
+// Horizontal range of obstacle positions on each road
+struct RoadBounds {
+    int minX, maxX;
+};
+const RoadBounds ROAD_BOUNDS[Track::ROAD_COUNT] = {{340, 440}, {490, 620}};
+
+// Hand-placed layout of the chunk at the start line, as the game always had it
+const int START_XS[Track::ROAD_COUNT][TrackChunk::OBSTACLES] = {{350, 440, 420}, {620, 500, 540}};
+const int START_YS[Track::ROAD_COUNT][TrackChunk::OBSTACLES] = {{400, 250, 90}, {400, 260, 90}};
+
+// std::seed_seq over three values, without the heap: generate() is the
+// algorithm the standard specifies, so engines seeded from it start in the
+// same state as from std::seed_seq{a, b, c}. Chunks are generated while
+// stepping and when restoring keyframes, which rollback does many times a second.
+class SeedSequence3 {
+public:
+    using result_type = uint32_t;
+
+    SeedSequence3(uint32_t a, uint32_t b, uint32_t c) : values{a, b, c} {}
+
+    template <typename Iterator>
+    void generate(Iterator begin, Iterator end) const {
+        const size_t n = static_cast<size_t>(end - begin);
+        if (n == 0) {
+            return;
+        }
+        const size_t s = 3;
+        const size_t t = n >= 623 ? 11 : n >= 68 ? 7 : n >= 39 ? 5 : n >= 7 ? 3 : (n - 1) / 2;
+        const size_t p = (n - t) / 2;
+        const size_t q = p + t;
+        const size_t m = std::max(s + 1, n);
+        auto at = [begin, n](size_t k) -> decltype(begin[0]) { return begin[k % n]; };
+        auto mix = [](uint32_t x) { return x ^ (x >> 27); };
+
+        for (size_t k = 0; k < n; ++k) {
+            at(k) = 0x8b8b8b8bu;
+        }
+        for (size_t k = 0; k < m; ++k) {
+            uint32_t r1 = 1664525u * mix(at(k) ^ at(k + p) ^ at(k + n - 1));
+            uint32_t r2 = r1 + static_cast<uint32_t>(k == 0 ? s : k <= s ? k % n + values[k - 1] : k % n);
+            at(k + p) += r1;
+            at(k + q) += r2;
+            at(k) = r2;
+        }
+        for (size_t k = m; k < m + n; ++k) {
+            uint32_t r3 = 1566083941u * mix(at(k) + at(k + p) + at(k + n - 1));
+            uint32_t r4 = r3 - static_cast<uint32_t>(k % n);
+            at(k + p) ^= r3;
+            at(k + q) ^= r4;
+            at(k) = r4;
+        }
+    }
+
+private:
+    uint32_t values[3];
+};
+
+} // namespace
+
+// Constructor
+Track::Track(unsigned seed, JobSystem* jobs) : seed(seed), jobs(jobs) {
+    for (auto& stream : roads) {
+        stream.ring.fill(-1);
+    }
+}
+
+// Destructor
+Track::~Track() {
+    for (auto& stream : roads) {
+        waitPrefetch(stream);
+    }
+}
+
+// Contents of one chunk, from a generator seeded by (seed, road, index) alone
+TrackChunk Track::generateChunk(unsigned seed, int road, int index) {
+    SeedSequence3 sequence(seed, static_cast<uint32_t>(road), static_cast<uint32_t>(index));
+    std::mt19937 random(sequence);
+    return layoutChunk(road, index, random);
+}
+
+// Place the obstacles of one chunk
+template <typename Random>
+TrackChunk Track::layoutChunk(int road, int index, Random& random) {
+    TrackChunk chunk;
+    chunk.road = road;
+    chunk.index = index;
+
+    if (index == 0) {
+        // The start of the road keeps its familiar layout, nudged by the seed
+        std::uniform_int_distribution<int> jitterX(-10, 10);
+        std::uniform_int_distribution<int> jitterY(-20, 20);
+        for (int j = 0; j < TrackChunk::OBSTACLES; ++j) {
+            chunk.xs[j] = START_XS[road][j] + jitterX(random);
+            chunk.ys[j] = START_YS[road][j] + jitterY(random);
+        }
+        return chunk;
+    }
+
+    // Evenly spaced rows up the chunk, each shifted and placed anywhere across the road
+    const int spacing = CHUNK_LENGTH / TrackChunk::OBSTACLES;
+    std::uniform_int_distribution<int> positionX(ROAD_BOUNDS[road].minX, ROAD_BOUNDS[road].maxX);
+    std::uniform_int_distribution<int> jitterY(-spacing / 4, spacing / 4);
+    for (int j = 0; j < TrackChunk::OBSTACLES; ++j) {
+        chunk.xs[j] = positionX(random);
+        chunk.ys[j] = chunkBottom(index) - spacing / 2 - j * spacing + jitterY(random);
+    }
+    return chunk;
+}
+
+template TrackChunk Track::layoutChunk<std::mt19937>(int road, int index, std::mt19937& random);
+template TrackChunk Track::layoutChunk<SplitMix64>(int road, int index, SplitMix64& random);
+
+// Leftmost obstacle position on a road
+int Track::roadMinX(int road) {
+    return ROAD_BOUNDS[road].minX;
+}
+
+// Rightmost obstacle position on a road
+int Track::roadMaxX(int road) {
+    return ROAD_BOUNDS[road].maxX;
+}
+
+// Reserve the slots and lay the first chunks
+void Track::init(ObstacleField& field, int obstacleWidth, int obstacleHeight) {
+    firstSlot = field.size();
+    for (int road = 0; road < ROAD_COUNT; ++road) {
+        for (int slot = 0; slot < RING_CAPACITY * TrackChunk::OBSTACLES; ++slot) {
+            field.add(PARK_X, PARK_Y, obstacleWidth, obstacleHeight, road);
+        }
+    }
+    reset(field);
+}
+
+// Back to the start line
+void Track::reset(ObstacleField& field) {
+    chunksGenerated = 0;
+    for (int road = 0; road < ROAD_COUNT; ++road) {
+        RoadStream& stream = roads[road];
+        waitPrefetch(stream);
+        stream.prefetched = TrackChunk();
+        stream.nextChunk = 0;
+        for (int position = 0; position < RING_CAPACITY; ++position) {
+            stream.ring[position] = -1;
+            for (int j = 0; j < TrackChunk::OBSTACLES; ++j) {
+                size_t slot = slotOf(road, position, j);
+                field.setPosition(slot, PARK_X, PARK_Y);
+                field.setVisible(slot, false);
+            }
+        }
+        prefetch(road, 0);
+    }
+}
+
+// The prefetch tasks read the seed, so they finish before it changes
+void Track::reseed(unsigned newSeed) {
+    for (auto& stream : roads) {
+        waitPrefetch(stream);
+    }
+    seed = newSeed;
+}
+
+// Recycle chunks behind the trailing car, install chunks ahead of the leading car
+void Track::update(ObstacleField& field, int road, int leadingY, int trailingY, std::vector<int>& recycled) {
+    RoadStream& stream = roads[road];
+
+    for (int position = 0; position < RING_CAPACITY; ++position) {
+        int index = stream.ring[position];
+        if (index >= 0 && chunkTop(index) > trailingY + RECYCLE_MARGIN) {
+            stream.ring[position] = -1;
+        }
+    }
+
+    // Without a free position the leading car is a whole ring ahead of the
+    // trailing one; it keeps the road it has and more follows once the gap closes
+    while (chunkBottom(stream.nextChunk) > leadingY - LOOKAHEAD) {
+        int position = 0;
+        while (position < RING_CAPACITY && stream.ring[position] >= 0) ++position;
+        if (position == RING_CAPACITY) break;
+
+        TrackChunk chunk = takeChunk(road, stream.nextChunk);
+        install(field, road, position, chunk, recycled);
+        stream.ring[position] = chunk.index;
+        stream.nextChunk++;
+        chunksGenerated++;
+        prefetch(road, stream.nextChunk);
+    }
+}
+
+// Wait for the prefetched chunk if it is the one needed, otherwise generate it here
+TrackChunk Track::takeChunk(int road, int index) {
+    RoadStream& stream = roads[road];
+    waitPrefetch(stream);
+    if (stream.prefetched.index == index) {
+        return stream.prefetched;
+    }
+    return generateChunk(seed, road, index);
+}
+
+// Generate a chunk on the job system before it is needed
+void Track::prefetch(int road, int index) {
+    RoadStream& stream = roads[road];
+    if (!jobs) {
+        return;
+    }
+    stream.pending = true;
+    jobs->run(stream.prefetchGroup, "track.generate", [this, road, index]() {
+        roads[road].prefetched = generateChunk(seed, road, index);
+    });
+}
+
+// Only prefetch() starts tasks, so without a job system nothing is pending
+void Track::waitPrefetch(RoadStream& stream) {
+    if (stream.pending) {
+        jobs->wait(stream.prefetchGroup);
+        stream.pending = false;
+    }
+}
+
+// Move the slots of one ring position to a new chunk
+void Track::install(ObstacleField& field, int road, int position, const TrackChunk& chunk, std::vector<int>& recycled) {
+    for (int j = 0; j < TrackChunk::OBSTACLES; ++j) {
+        size_t slot = slotOf(road, position, j);
+        field.setPosition(slot, chunk.xs[j], chunk.ys[j]);
+        field.setVisible(slot, false);
+        recycled.push_back(static_cast<int>(slot));
+    }
+}
+
+// Field index of one obstacle of a ring position
+size_t Track::slotOf(int road, int position, int obstacle) const {
+    return firstSlot + static_cast<size_t>((road * RING_CAPACITY + position) * TrackChunk::OBSTACLES + obstacle);
+}
+
+// Keyframe state: what each ring holds and what comes next
+void Track::saveState(StateWriter& writer) const {
+    writer.i32(chunksGenerated);
+    for (const RoadStream& stream : roads) {
+        writer.i32(stream.nextChunk);
+        for (int index : stream.ring) {
+            writer.i32(index);
+        }
+    }
+}
+
+// Restore a keyframe; the prefetch restarts from the restored next chunk
+bool Track::loadState(StateReader& reader) {
+    chunksGenerated = reader.i32();
+    for (int road = 0; road < ROAD_COUNT; ++road) {
+        RoadStream& stream = roads[road];
+        waitPrefetch(stream);
+        stream.nextChunk = reader.i32();
+        for (int& index : stream.ring) {
+            index = reader.i32();
+        }
+        stream.prefetched = TrackChunk();
+        prefetch(road, stream.nextChunk);
+    }
+    return reader.ok();
+}
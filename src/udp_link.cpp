@@ -0,0 +1,156 @@
+#include "udp_link.h"
+#include <arpa/inet.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Constructor
+UdpLink::UdpLink() : delayed(DELAY_QUEUE) {
+}
+
+// Destructor
+UdpLink::~UdpLink() {
+    close();
+}
+
+// Resolve the peer, then bind a non-blocking socket
+bool UdpLink::open(int localPort, const std::string& peerHost, int peerPort, std::string& error) {
+    close();
+
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* found = nullptr;
+    int status = getaddrinfo(peerHost.c_str(), nullptr, &hints, &found);
+    if (status != 0 || !found) {
+        error = "cannot resolve " + peerHost + ": " + gai_strerror(status);
+        return false;
+    }
+    peerAddress = reinterpret_cast<const sockaddr_in*>(found->ai_addr)->sin_addr.s_addr;
+    this->peerPort = htons(static_cast<uint16_t>(peerPort));
+    freeaddrinfo(found);
+
+    socketHandle = socket(AF_INET, SOCK_DGRAM, 0);
+    if (socketHandle < 0) {
+        error = std::string("cannot create a UDP socket: ") + std::strerror(errno);
+        return false;
+    }
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(static_cast<uint16_t>(localPort));
+    if (bind(socketHandle, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) != 0) {
+        error = "cannot bind UDP port " + std::to_string(localPort) + ": " + std::strerror(errno);
+        close();
+        return false;
+    }
+    int flags = fcntl(socketHandle, F_GETFL, 0);
+    if (flags < 0 || fcntl(socketHandle, F_SETFL, flags | O_NONBLOCK) != 0) {
+        error = std::string("cannot make the socket non-blocking: ") + std::strerror(errno);
+        close();
+        return false;
+    }
+
+    stats = Stats();
+    delayedHead = 0;
+    delayedCount = 0;
+    return true;
+}
+
+// Close the socket; held-back datagrams are lost
+void UdpLink::close() {
+    if (socketHandle >= 0) {
+        ::close(socketHandle);
+        socketHandle = -1;
+    }
+    delayedCount = 0;
+}
+
+// Set the artificial latency
+void UdpLink::setSimulatedDelay(int millis) {
+    delay = std::chrono::milliseconds(millis > 0 ? millis : 0);
+}
+
+// Set the artificial loss
+void UdpLink::setSimulatedLoss(int percent, unsigned seed) {
+    lossPercent = percent < 0 ? 0 : percent > 100 ? 100 : percent;
+    lossRandom.seed(seed);
+}
+
+// Drop, hold back or send
+bool UdpLink::send(const uint8_t* data, size_t size) {
+    if (socketHandle < 0 || size > MAX_DATAGRAM) {
+        return false;
+    }
+    if (lossPercent > 0 && static_cast<int>(lossRandom() % 100) < lossPercent) {
+        stats.dropped++;
+        return false;
+    }
+    if (delay == Clock::duration::zero()) {
+        return sendNow(data, size);
+    }
+    flush();
+    if (delayedCount == DELAY_QUEUE) {
+        stats.dropped++;
+        return false;
+    }
+    Delayed& entry = delayed[(delayedHead + delayedCount) % DELAY_QUEUE];
+    entry.due = Clock::now() + delay;
+    entry.size = size;
+    std::memcpy(entry.data, data, size);
+    delayedCount++;
+    return true;
+}
+
+// Send what has waited long enough, oldest first
+void UdpLink::flush() {
+    Clock::time_point now = Clock::now();
+    while (delayedCount > 0 && delayed[delayedHead].due <= now) {
+        const Delayed& entry = delayed[delayedHead];
+        sendNow(entry.data, entry.size);
+        delayedHead = (delayedHead + 1) % DELAY_QUEUE;
+        delayedCount--;
+    }
+}
+
+// One sendto; a full socket buffer counts as loss
+bool UdpLink::sendNow(const uint8_t* data, size_t size) {
+    sockaddr_in peer{};
+    peer.sin_family = AF_INET;
+    peer.sin_addr.s_addr = peerAddress;
+    peer.sin_port = peerPort;
+    ssize_t written = sendto(socketHandle, data, size, 0, reinterpret_cast<const sockaddr*>(&peer), sizeof(peer));
+    if (written != static_cast<ssize_t>(size)) {
+        stats.dropped++;
+        return false;
+    }
+    stats.sent++;
+    stats.bytesSent += size;
+    return true;
+}
+
+// Read until a datagram from the peer turns up or the socket is empty
+size_t UdpLink::receive(uint8_t* buffer, size_t capacity) {
+    if (socketHandle < 0) {
+        return 0;
+    }
+    flush();
+    for (;;) {
+        sockaddr_in from{};
+        socklen_t fromSize = sizeof(from);
+        ssize_t size = recvfrom(socketHandle, buffer, capacity, 0, reinterpret_cast<sockaddr*>(&from), &fromSize);
+        if (size < 0) {
+            return 0;  // EWOULDBLOCK when empty; other errors (e.g. ICMP port unreachable) are treated the same
+        }
+        if (from.sin_addr.s_addr != peerAddress || from.sin_port != peerPort) {
+            continue;
+        }
+        stats.received++;
+        stats.bytesReceived += static_cast<uint64_t>(size);
+        return static_cast<size_t>(size);
+    }
+}
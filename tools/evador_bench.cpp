@@ -0,0 +1,566 @@
+// Benchmark suite: microbenchmarks of the simulation's hot functions over
+// growing obstacle and car counts and, when built with SDL, full frames under
+// the software renderer. Prints a table and writes JSON / CSV with percentiles
+// so runs can be compared; --baseline flags median regressions against an
+// earlier CSV. Steps that promise not to allocate are checked with a
+// counting operator new.
+
+#include "evador_bench.h"
+#include "batch_env.h"
+#include "car.h"
+#include "draw_list.h"
+#include "obstacle_field.h"
+#include "particle_system.h"
+#include "simulation.h"
+#include "simulation_thread.h"
+#include "tool_args.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <new>
+#include <random>
+#include <sstream>
+
+volatile long BenchRunner::sink = 0;
+
+namespace {
+std::atomic<unsigned long> heapAllocations{0};
+}
+
+// Count every heap allocation of the process, for checkAllocations
+void* operator new(std::size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory = std::malloc(size > 0 ? size : 1)) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+// Substring filter
+bool BenchRunner::enabled(const std::string& name) const {
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+// Nearest-rank percentiles of the samples
+void BenchRunner::addSamples(const std::string& name, long param, long iterations, std::vector<double> samplesNs) {
+    if (samplesNs.empty()) {
+        return;
+    }
+    std::sort(samplesNs.begin(), samplesNs.end());
+    auto percentile = [&samplesNs](double p) {
+        size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * samplesNs.size()));
+        return samplesNs[std::min(samplesNs.size() - 1, rank > 0 ? rank - 1 : 0)];
+    };
+
+    BenchResult result;
+    result.name = name;
+    result.param = param;
+    result.samples = static_cast<int>(samplesNs.size());
+    result.iterations = iterations;
+    for (double sample : samplesNs) {
+        result.meanNs += sample;
+    }
+    result.meanNs /= samplesNs.size();
+    result.minNs = samplesNs.front();
+    result.p50Ns = percentile(50);
+    result.p90Ns = percentile(90);
+    result.p99Ns = percentile(99);
+    result.maxNs = samplesNs.back();
+    results.push_back(result);
+
+    std::printf("%-32s %8ld %12.1f %12.1f %12.1f %12.1f\n", name.c_str(), param,
+                result.p50Ns, result.p90Ns, result.p99Ns, result.meanNs);
+    std::fflush(stdout);
+}
+
+#ifndef EVADOR_BENCH_SCENARIOS
+// Built without SDL: nothing to run
+void runScenarioBenchmarks(BenchRunner& runner) {
+    if (runner.enabled("scenario.")) {
+        std::printf("(scenario benchmarks need SDL2; skipped)\n");
+    }
+}
+#endif
+
+namespace {
+
+const int OBSTACLE_COUNTS[] = {36, 256, 1024, 4096, 16384};
+const int CAR_COUNTS[] = {2, 16, 128, 1024};
+
+// Obstacles scattered over both roads, about one every 30 px of track
+void fillField(ObstacleField& field, int count, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> road(0, 1);
+    std::uniform_int_distribution<int> lane(0, 150);
+    int length = count * 30;
+    std::uniform_int_distribution<int> y(550 - length, 550);
+    field.clear();
+    for (int i = 0; i < count; ++i) {
+        int r = road(random);
+        field.add((r == 0 ? 300 : 500) + lane(random), y(random),
+                  Simulation::OBSTACLE_WIDTH, Simulation::OBSTACLE_HEIGHT, r);
+    }
+}
+
+// Probe positions spread along the field, so queries do not always hit the same cells
+std::vector<std::pair<int, int>> probes(int count, unsigned seed) {
+    std::mt19937 random(seed);
+    std::uniform_int_distribution<int> x(300, 650);
+    std::uniform_int_distribution<int> y(550 - count * 30, 550);
+    std::vector<std::pair<int, int>> result(256);
+    for (auto& probe : result) {
+        probe = {x(random), y(random)};
+    }
+    return result;
+}
+
+void benchCollision(BenchRunner& runner) {
+    const float step = 1.0f / 120.0f;
+    for (int count : OBSTACLE_COUNTS) {
+        ObstacleField field;
+        fillField(field, count, 7);
+        std::vector<std::pair<int, int>> points = probes(count, 11);
+
+        // Simulation::detectCollision is this query on the simulation's own field
+        runner.run("detectCollision", count, [&](long iterations) {
+            long hits = 0;
+            for (long i = 0; i < iterations; ++i) {
+                const auto& p = points[i & 255];
+                hits += field.findFirstOverlap(p.first, p.second, 36, 65);
+            }
+            return hits;
+        });
+
+        // The continuous test over the same probes, each moving up 20 px (the
+        // player at full speed for one 120 Hz step)
+        runner.run("detectSweptCollision", count, [&](long iterations) {
+            long hits = 0;
+            float impact = 0.0f;
+            for (long i = 0; i < iterations; ++i) {
+                const auto& p = points[i & 255];
+                hits += field.findFirstSweptHit(p.first, p.second + 20, p.first, p.second, 36, 65, impact);
+            }
+            return hits;
+        });
+
+        // A full AI search from one probe: the planner is reset so every
+        // iteration plans instead of following the previous plan
+        ObstacleField visibleField;
+        fillField(visibleField, count, 7);
+        for (size_t i = 0; i < visibleField.size(); ++i) {
+            visibleField.setVisible(i, true);
+        }
+        AiPlanner planner(580, Track::roadMinX(Simulation::AI_ROAD),
+                          Track::roadMaxX(Simulation::AI_ROAD) + Simulation::OBSTACLE_WIDTH - 39);
+        runner.run("AiPlanner::plan", count, [&](long iterations) {
+            std::vector<int> nearby;
+            long moves = 0;
+            for (long i = 0; i < iterations; ++i) {
+                const auto& p = points[i & 255];
+                planner.reset();
+                moves += static_cast<long>(planner.update(visibleField, Simulation::AI_ROAD,
+                                                          planner.laneX(p.first % planner.getLaneCount()), p.second,
+                                                          39, 65, Car::MAX_SPEED, 0.0f, Car::MAX_SPEED, step, nearby));
+            }
+            return moves;
+        });
+
+        runner.run("updateObstacleVisibility", count, [&](long iterations) {
+            std::vector<int> nearby;
+            for (long i = 0; i < iterations; ++i) {
+                // Hide everything now and then so the reveal path keeps running
+                if ((i & 255) == 0) field.resetVisibility();
+                const auto& p = points[i & 255];
+                Simulation::updateObstacleVisibility(field, p.first, p.second, static_cast<int>(i & 1), nearby);
+            }
+            return static_cast<long>(nearby.size());
+        });
+    }
+}
+
+void benchCars(BenchRunner& runner) {
+    const float step = 1.0f / 120.0f;
+    for (int count : CAR_COUNTS) {
+        std::vector<Car> cars;
+        for (int i = 0; i < count; ++i) {
+            cars.emplace_back(300 + (i % 10) * 36, 550);
+            cars.back().setSpeed(Car::MAX_SPEED / 2);
+            cars.back().setFinishLine(-1000000000);
+        }
+
+        // One step of every car, per iteration
+        runner.run("Car::move", count, [&](long iterations) {
+            for (long i = 0; i < iterations; ++i) {
+                for (Car& car : cars) {
+                    car.savePreviousState();
+                    car.move(step);
+                }
+            }
+            return static_cast<long>(cars.front().getY());
+        });
+
+        // The two HUD lines of every car, formatted the way the recorder does
+        DrawList list;
+        runner.run("hud.format", count, [&](long iterations) {
+            char line[64];
+            for (long i = 0; i < iterations; ++i) {
+                list.clear();
+                for (int c = 0; c < count; ++c) {
+                    const Car& car = cars[c];
+                    std::snprintf(line, sizeof(line), "%s Speed: %.2f", c == 0 ? "You" : "Computer", car.getSpeed());
+                    list.addText(line, FontId::Normal, 200.0f, 64.0f);
+                    std::snprintf(line, sizeof(line), "%s Distance: %.2f", c == 0 ? "You" : "Computer", car.getDistanceCovered());
+                    list.addText(line, FontId::Normal, 200.0f, 64.0f).line = 1;
+                }
+            }
+            return static_cast<long>(list.text.size());
+        });
+    }
+}
+
+// Recording a whole world into a draw list, as the simulation thread does every tick
+void benchRecord(BenchRunner& runner) {
+    for (int count : OBSTACLE_COUNTS) {
+        WorldSnapshot world;
+        world.state = GameState::RUNNING;
+        world.player.x = 380.0f;
+        world.player.y = world.player.previousY = 550.0f;
+        world.aiCars.resize(1);
+        world.aiCars[0].x = 580.0f;
+        world.aiCars[0].y = world.aiCars[0].previousY = 550.0f;
+        ObstacleField field;
+        fillField(field, count, 3);
+        for (size_t i = 0; i < field.size(); ++i) {
+            world.obstacles.push_back({field.getX(i), field.getY(i), field.getWidth(i), field.getHeight(i), field.getRoad(i)});
+        }
+
+        DrawList list;
+        runner.run("recordWorld", count, [&](long iterations) {
+            for (long i = 0; i < iterations; ++i) {
+                SimulationThread::recordWorld(world, 1.0f, 1.0f, 0.0f, list);
+            }
+            return static_cast<long>(list.commands.size());
+        });
+    }
+}
+
+// A whole race step on the real track with growing numbers of AI cars:
+// inline, then spread over the job system. Per-car work is split across the
+// workers, so the threaded rows should grow with cars / cores.
+void benchStep(BenchRunner& runner) {
+    const int AI_COUNTS[] = {1, 16, 128, 1024};
+    JobSystem jobs;
+    for (JobSystem* pool : {static_cast<JobSystem*>(nullptr), &jobs}) {
+        const char* name = pool ? "Simulation::step.jobs" : "Simulation::step";
+        for (int count : AI_COUNTS) {
+            Simulation simulation(5, pool, Simulation::DEFAULT_RACE_LENGTH, count);
+            runner.run(name, count, [&](long iterations) {
+                PlayerInput input;
+                input.accelerate = true;
+                for (long i = 0; i < iterations; ++i) {
+                    if (simulation.getState() != GameState::RUNNING) {
+                        simulation.reset();
+                        simulation.start();
+                    }
+                    simulation.applyInput(input);
+                    simulation.step(1.0f / 120.0f);
+                }
+                return static_cast<long>(simulation.getRaceTime());
+            });
+        }
+    }
+}
+
+// One step of every environment of a training batch, inline then on the job
+// system; divide by the environment count for the cost of one environment step
+void benchBatchEnv(BenchRunner& runner) {
+    const int ENV_COUNTS[] = {1024, 16384, 65536};
+    JobSystem jobs;
+    for (JobSystem* pool : {static_cast<JobSystem*>(nullptr), &jobs}) {
+        const char* name = pool ? "BatchEnv::step.jobs" : "BatchEnv::step";
+        for (int count : ENV_COUNTS) {
+            BatchEnv env(count, 7, BatchEnvConfig(), pool);
+            std::vector<int8_t> actions(count);
+            std::mt19937 random(11);
+            for (int8_t& action : actions) {
+                action = static_cast<int8_t>(static_cast<int>(random() % 3) - 1);
+            }
+            runner.run(name, count, [&](long iterations) {
+                for (long i = 0; i < iterations; ++i) {
+                    env.step(actions.data());
+                }
+                return static_cast<long>(env.dones()[0]);
+            });
+        }
+    }
+}
+
+// One rendered frame of effects at 144 Hz with a steady number of live
+// particles split over the three kinds: refill what died, integrate, and
+// (for the .frame row) build the quads of every kind
+void benchParticles(BenchRunner& runner) {
+    const int LIVE_COUNTS[] = {1000, 10000, 100000};
+    const float FRAME_SECONDS = 1.0f / 144.0f;
+    const float VIEW_HEIGHT = 634.0f;
+    for (bool build : {false, true}) {
+        const char* name = build ? "ParticleSystem.frame" : "ParticleSystem::update";
+        for (int live : LIVE_COUNTS) {
+            ParticleSystem particles(static_cast<size_t>(live / PARTICLE_KIND_COUNT + 1), 5);
+            std::vector<ParticleVertex> vertices(particles.getCapacity() * 4);
+            std::mt19937 random(13);
+            auto refill = [&]() {
+                for (int kind = 0; kind < PARTICLE_KIND_COUNT; ++kind) {
+                    ParticleKind particleKind = static_cast<ParticleKind>(kind);
+                    int missing = live / PARTICLE_KIND_COUNT - static_cast<int>(particles.size(particleKind));
+                    particles.spawn(particleKind, missing, 340.0f + static_cast<float>(random() % 280),
+                                    static_cast<float>(random() % 634), 0.0f, 60.0f, 120.0f);
+                }
+            };
+            refill();
+            runner.run(name, live, [&](long iterations) {
+                long quads = 0;
+                for (long i = 0; i < iterations; ++i) {
+                    refill();
+                    particles.update(FRAME_SECONDS);
+                    if (build) {
+                        for (int kind = 0; kind < PARTICLE_KIND_COUNT; ++kind) {
+                            quads += static_cast<long>(particles.buildQuads(static_cast<ParticleKind>(kind), 0.0f,
+                                                                            VIEW_HEIGHT, 0.0f, 0.0f, 1.0f, 1.0f,
+                                                                            vertices.data()));
+                        }
+                    }
+                }
+                return quads + static_cast<long>(particles.getStats().live);
+            });
+        }
+    }
+}
+
+// Heap allocations per call of work, after warming up
+template <typename Work>
+double allocationsPerCall(int warmup, int calls, Work work) {
+    for (int i = 0; i < warmup; ++i) {
+        work();
+    }
+    unsigned long before = heapAllocations.load(std::memory_order_relaxed);
+    for (int i = 0; i < calls; ++i) {
+        work();
+    }
+    return static_cast<double>(heapAllocations.load(std::memory_order_relaxed) - before) / calls;
+}
+
+// Steps documented as allocation-free, inline and on the job system (whose
+// workers count too), and a netplay rollback; returns how many allocated
+int checkAllocations(BenchRunner& runner) {
+    const int ENV_COUNT = 16384;  // Several ranges, so the job system really splits the step
+    int failures = 0;
+    auto report = [&failures](const char* name, long param, double perCall) {
+        std::printf("%-32s %8ld %12.2f allocations per call%s\n", name, param, perCall, perCall > 0.0 ? "  FAILED" : "");
+        failures += perCall > 0.0 ? 1 : 0;
+    };
+
+    JobSystem jobs;
+    for (JobSystem* pool : {static_cast<JobSystem*>(nullptr), &jobs}) {
+        const char* name = pool ? "alloc.BatchEnv::step.jobs" : "alloc.BatchEnv::step";
+        if (!runner.enabled(name)) {
+            continue;
+        }
+        BatchEnv env(ENV_COUNT, 7, BatchEnvConfig(), pool);
+        std::vector<int8_t> actions(ENV_COUNT, BatchEnv::Right);
+        report(name, ENV_COUNT, allocationsPerCall(100, 500, [&]() { env.step(actions.data()); }));
+    }
+
+    // Inline race steps, as RollbackSession runs them
+    const int AI_CARS = 16;
+    if (runner.enabled("alloc.Simulation::step")) {
+        Simulation simulation(5, nullptr, Simulation::DEFAULT_RACE_LENGTH, AI_CARS);
+        PlayerInput input;
+        input.accelerate = true;
+        report("alloc.Simulation::step", AI_CARS, allocationsPerCall(4000, 4000, [&]() {
+            if (simulation.getState() != GameState::RUNNING) {
+                simulation.reset();
+                simulation.start();
+            }
+            simulation.setHeldControls(input);
+            simulation.step(1.0f / 120.0f);
+        }));
+    }
+
+    // One rollback of a head-to-head race: snapshot, run ahead, restore and
+    // re-run the same frames with the rival steering the other way
+    if (runner.enabled("alloc.Simulation.rollback")) {
+        const int FRAMES = 16;
+        Simulation simulation(5, nullptr, Simulation::DEFAULT_RACE_LENGTH, 1);
+        simulation.setHeadToHead(true);
+        std::vector<uint8_t> snapshot;
+        PlayerInput held;
+        held.accelerate = true;
+        PlayerInput steering = held;
+        steering.steerLeft = true;
+        bool flip = false;
+        report("alloc.Simulation.rollback", FRAMES, allocationsPerCall(200, 1000, [&]() {
+            if (simulation.getState() != GameState::RUNNING) {
+                simulation.reset();
+                simulation.start();
+            }
+            snapshot.clear();
+            simulation.saveState(snapshot);
+            simulation.setHeldControls(held);
+            simulation.setRivalControls(flip ? steering : held);
+            for (int i = 0; i < FRAMES; ++i) {
+                simulation.step(1.0f / 120.0f);
+            }
+            simulation.loadState(snapshot.data(), snapshot.size());
+            simulation.setRivalControls(flip ? held : steering);
+            for (int i = 0; i < FRAMES; ++i) {
+                simulation.step(1.0f / 120.0f);
+            }
+            flip = !flip;
+        }));
+    }
+    return failures;
+}
+
+void writeJson(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    out << "{\n  \"suite\": \"evador_bench\",\n  \"unit\": \"ns\",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        char line[512];
+        std::snprintf(line, sizeof(line),
+                      "    {\"name\": \"%s\", \"param\": %ld, \"samples\": %d, \"iterations\": %ld, "
+                      "\"mean\": %.2f, \"min\": %.2f, \"p50\": %.2f, \"p90\": %.2f, \"p99\": %.2f, \"max\": %.2f}%s\n",
+                      r.name.c_str(), r.param, r.samples, r.iterations, r.meanNs, r.minNs,
+                      r.p50Ns, r.p90Ns, r.p99Ns, r.maxNs, i + 1 < results.size() ? "," : "");
+        out << line;
+    }
+    out << "  ]\n}\n";
+    if (!out) {
+        std::fprintf(stderr, "Could not write %s\n", path.c_str());
+    }
+}
+
+const char* CSV_HEADER = "name,param,samples,iterations,mean_ns,min_ns,p50_ns,p90_ns,p99_ns,max_ns";
+
+void writeCsv(const std::string& path, const std::vector<BenchResult>& results) {
+    std::ofstream out(path);
+    out << CSV_HEADER << "\n";
+    for (const BenchResult& r : results) {
+        char line[256];
+        std::snprintf(line, sizeof(line), "%s,%ld,%d,%ld,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                      r.name.c_str(), r.param, r.samples, r.iterations, r.meanNs, r.minNs,
+                      r.p50Ns, r.p90Ns, r.p99Ns, r.maxNs);
+        out << line;
+    }
+    if (!out) {
+        std::fprintf(stderr, "Could not write %s\n", path.c_str());
+    }
+}
+
+// Compare medians with a CSV written by an earlier run; returns the number of regressions
+int compareBaseline(const BenchOptions& options, const std::vector<BenchResult>& results) {
+    std::ifstream in(options.baselinePath);
+    if (!in) {
+        std::fprintf(stderr, "Could not read baseline %s\n", options.baselinePath.c_str());
+        return 0;
+    }
+    std::map<std::pair<std::string, long>, double> baseline;
+    std::string line;
+    std::getline(in, line); // Header
+    while (std::getline(in, line)) {
+        std::stringstream fields(line);
+        std::string name, param, column;
+        std::getline(fields, name, ',');
+        std::getline(fields, param, ',');
+        for (int i = 0; i < 5; ++i) std::getline(fields, column, ','); // samples .. min_ns, then p50_ns
+        baseline[{name, std::atol(param.c_str())}] = std::atof(column.c_str());
+    }
+
+    std::printf("\n%-32s %8s %12s %12s %8s\n", "compared to baseline", "param", "base p50", "p50", "change");
+    int regressions = 0;
+    for (const BenchResult& r : results) {
+        auto found = baseline.find({r.name, r.param});
+        if (found == baseline.end() || found->second <= 0.0) {
+            continue;
+        }
+        double change = 100.0 * (r.p50Ns - found->second) / found->second;
+        bool regressed = change > options.regressionPercent;
+        regressions += regressed ? 1 : 0;
+        std::printf("%-32s %8ld %12.1f %12.1f %+7.1f%%%s\n", r.name.c_str(), r.param, found->second, r.p50Ns,
+                    change, regressed ? "  REGRESSION" : "");
+    }
+    return regressions;
+}
+
+BenchOptions parseOptions(int argc, char* args[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(args[i], "--filter") == 0) {
+            options.filter = flagValue(argc, args, i);
+        } else if (std::strcmp(args[i], "--samples") == 0) {
+            options.samples = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--min-sample-ms") == 0) {
+            options.minSampleSeconds = std::atof(flagValue(argc, args, i)) / 1000.0;
+        } else if (std::strcmp(args[i], "--frames") == 0) {
+            options.scenarioFrames = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--json") == 0) {
+            options.jsonPath = flagValue(argc, args, i);
+        } else if (std::strcmp(args[i], "--csv") == 0) {
+            options.csvPath = flagValue(argc, args, i);
+        } else if (std::strcmp(args[i], "--baseline") == 0) {
+            options.baselinePath = flagValue(argc, args, i);
+        } else if (std::strcmp(args[i], "--threshold") == 0) {
+            options.regressionPercent = std::atof(flagValue(argc, args, i));
+        } else {
+            std::printf("Usage: evador_bench [--filter TEXT] [--samples N] [--min-sample-ms MS] [--frames N]\n"
+                        "                    [--json FILE] [--csv FILE] [--baseline CSV] [--threshold PERCENT]\n");
+            std::exit(std::strcmp(args[i], "--help") == 0 ? 0 : 1);
+        }
+    }
+    if (options.samples < 1 || options.scenarioFrames < 1) {
+        std::fprintf(stderr, "--samples and --frames must be positive\n");
+        std::exit(1);
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char* args[]) {
+    BenchOptions options = parseOptions(argc, args);
+    BenchRunner runner(options);
+
+    std::printf("%-32s %8s %12s %12s %12s %12s\n", "benchmark (ns per op)", "param", "p50", "p90", "p99", "mean");
+    benchCollision(runner);
+    benchCars(runner);
+    benchRecord(runner);
+    benchStep(runner);
+    benchBatchEnv(runner);
+    benchParticles(runner);
+    runScenarioBenchmarks(runner);
+    int allocationFailures = checkAllocations(runner);
+
+    if (!options.jsonPath.empty()) {
+        writeJson(options.jsonPath, runner.getResults());
+    }
+    if (!options.csvPath.empty()) {
+        writeCsv(options.csvPath, runner.getResults());
+    }
+    if (!options.baselinePath.empty() && compareBaseline(options, runner.getResults()) > 0) {
+        return 2;
+    }
+    return allocationFailures > 0 ? 3 : 0;
+}
@@ -0,0 +1,87 @@
+#ifndef EVADOR_BENCH_H
+#define EVADOR_BENCH_H
+
+// Shared by the microbenchmarks (evador_bench.cpp) and the SDL scenario
+// benchmarks (evador_bench_scenarios.cpp)
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Settings of one suite run
+struct BenchOptions {
+    std::string filter;            // Only benchmarks whose name contains this
+    int samples = 30;              // Timed samples per benchmark
+    double minSampleSeconds = 0.002; // Each microbenchmark sample repeats its body for at least this long
+    int scenarioFrames = 600;      // Frames timed per scenario
+    std::string jsonPath;
+    std::string csvPath;
+    std::string baselinePath;      // CSV of an earlier run to compare against
+    double regressionPercent = 10.0; // Median slowdown reported as a regression
+};
+
+// Distribution of the per-operation time of one benchmark, in nanoseconds
+struct BenchResult {
+    std::string name;
+    long param = 0;             // Size swept by the benchmark (obstacles, cars, frames)
+    int samples = 0;
+    long iterations = 0;        // Operations per sample
+    double meanNs = 0.0;
+    double minNs = 0.0;
+    double p50Ns = 0.0;
+    double p90Ns = 0.0;
+    double p99Ns = 0.0;
+    double maxNs = 0.0;
+};
+
+// Times benchmark bodies and collects their results
+class BenchRunner {
+public:
+    explicit BenchRunner(const BenchOptions& options) : options(options) {}
+
+    // Whether the filter selects this benchmark
+    bool enabled(const std::string& name) const;
+
+    // Time body(iterations), which performs the operation iterations times and
+    // returns a value derived from the work so it cannot be optimized away.
+    // The iteration count is calibrated so one sample lasts minSampleSeconds.
+    template <typename Body>
+    void run(const std::string& name, long param, Body body) {
+        if (!enabled(name)) {
+            return;
+        }
+        using Clock = std::chrono::steady_clock;
+        auto timeOnce = [&body](long iterations) {
+            Clock::time_point start = Clock::now();
+            sink += body(iterations);
+            return std::chrono::duration<double>(Clock::now() - start).count();
+        };
+
+        long iterations = 1;
+        while (timeOnce(iterations) < options.minSampleSeconds && iterations < (1L << 30)) {
+            iterations *= 2;
+        }
+        std::vector<double> samples;
+        samples.reserve(options.samples);
+        for (int i = 0; i < options.samples; ++i) {
+            samples.push_back(timeOnce(iterations) * 1.0e9 / iterations);
+        }
+        addSamples(name, param, iterations, samples);
+    }
+
+    // Add a result from per-operation times measured by the caller
+    void addSamples(const std::string& name, long param, long iterations, std::vector<double> samplesNs);
+
+    const BenchOptions& getOptions() const { return options; }
+    const std::vector<BenchResult>& getResults() const { return results; }
+
+private:
+    BenchOptions options;
+    std::vector<BenchResult> results;
+    static volatile long sink;
+};
+
+// Full frames under SDL's software renderer; defined only when built with SDL
+void runScenarioBenchmarks(BenchRunner& runner);
+
+#endif // EVADOR_BENCH_H
@@ -0,0 +1,202 @@
+// Scenario benchmarks: whole frames of the game pipeline (simulation steps,
+// draw list recording, replay, batching and present) under SDL's software
+// renderer and the dummy video driver, so they run on headless machines.
+
+#include "evador_bench.h"
+#include "asset_manager.h"
+#include "draw_list_renderer.h"
+#include "particle_renderer.h"
+#include "particle_system.h"
+#include "simulation.h"
+#include "simulation_thread.h"
+#include "sprite_batch.h"
+#include "text_cache.h"
+#include <SDL.h>
+#include <SDL_ttf.h>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+
+namespace {
+
+const float STEP_SECONDS = 1.0f / 120.0f;
+const int STEPS_PER_FRAME = 2; // 120 Hz simulation under a 60 Hz display
+
+// Window, renderer and loaded assets shared by every scenario
+struct ScenarioContext {
+    std::shared_ptr<SDL_Window> window;
+    std::shared_ptr<SDL_Renderer> renderer;
+    std::unique_ptr<SpriteBatch> batch;
+    std::unique_ptr<TextCache> textCache;
+    std::unique_ptr<AssetManager> assets;
+    std::unique_ptr<DrawListRenderer> drawListRenderer;
+};
+
+// Same assets as the game; false when SDL or the assets are unavailable
+bool initContext(ScenarioContext& context) {
+    setenv("SDL_VIDEODRIVER", "dummy", 0);
+    if (SDL_Init(SDL_INIT_VIDEO) < 0 || TTF_Init() == -1) {
+        std::fprintf(stderr, "SDL could not initialize: %s\n", SDL_GetError());
+        return false;
+    }
+    context.window = std::shared_ptr<SDL_Window>(
+        SDL_CreateWindow("evador_bench", 0, 0, 1000, 634, SDL_WINDOW_HIDDEN), SDL_DestroyWindow);
+    if (!context.window) {
+        std::fprintf(stderr, "Window could not be created: %s\n", SDL_GetError());
+        return false;
+    }
+    context.renderer = std::shared_ptr<SDL_Renderer>(
+        SDL_CreateRenderer(context.window.get(), -1, SDL_RENDERER_SOFTWARE), SDL_DestroyRenderer);
+    if (!context.renderer) {
+        std::fprintf(stderr, "Software renderer could not be created: %s\n", SDL_GetError());
+        return false;
+    }
+
+    context.batch = std::make_unique<SpriteBatch>(context.renderer.get());
+    context.textCache = std::make_unique<TextCache>(context.renderer.get());
+    context.assets = std::make_unique<AssetManager>(context.renderer.get(), context.textCache.get());
+    AssetManager& assets = *context.assets;
+    assets.loadPack("assets/evador.pack");
+    const char* font = "assets/fonts/open_sans/OpenSans-VariableFont_wdth,wght.ttf";
+    AssetHandle normalFont = assets.requestFont(font, 24);
+    AssetHandle largeFont = assets.requestFont(font, 34);
+
+    context.drawListRenderer = std::make_unique<DrawListRenderer>(*context.batch, *context.textCache, assets);
+    DrawListRenderer& drawListRenderer = *context.drawListRenderer;
+    drawListRenderer.setSprite(SpriteId::Background, assets.requestTexture("assets/evador.png"));
+    drawListRenderer.setSprite(SpriteId::PlayerCar, assets.requestTexture("assets/car_1.png"));
+    drawListRenderer.setSprite(SpriteId::AiCar, assets.requestTexture("assets/car_2.png"));
+    drawListRenderer.setSprite(SpriteId::Obstacle, assets.requestTexture("assets/obstacle.png"));
+
+    // Load everything before timing anything
+    Uint32 deadline = SDL_GetTicks() + 10000;
+    while (!assets.isFinished() && SDL_GetTicks() < deadline) {
+        assets.uploadPending();
+        SDL_Delay(1);
+    }
+    assets.uploadPending();
+    drawListRenderer.setFonts(assets.getFontId(normalFont), assets.getFontId(largeFont));
+    if (!assets.isFinished()) {
+        std::fprintf(stderr, "Assets did not finish loading\n");
+        return false;
+    }
+    return true;
+}
+
+// Draw one list and present it, as Game::render does
+void renderFrame(ScenarioContext& context, const DrawList& list) {
+    SDL_SetRenderDrawColor(context.renderer.get(), 0x00, 0x00, 0x00, 0xFF);
+    SDL_RenderClear(context.renderer.get());
+    context.drawListRenderer->render(list, 1.0f, true);
+    context.batch->flush();
+    context.textCache->flush();
+    SDL_RenderPresent(context.renderer.get());
+}
+
+// Advance a race by one frame's worth of steps, restarting it when it ends
+void stepFrame(Simulation& simulation) {
+    PlayerInput input;
+    input.accelerate = true;
+    for (int i = 0; i < STEPS_PER_FRAME; ++i) {
+        if (simulation.getState() != GameState::RUNNING) {
+            simulation.reset();
+            simulation.start();
+        }
+        simulation.applyInput(input);
+        simulation.step(STEP_SECONDS);
+    }
+}
+
+// Time frames one by one, after a short warm-up
+template <typename Frame>
+void timeFrames(BenchRunner& runner, const std::string& name, Frame frame) {
+    if (!runner.enabled(name)) {
+        return;
+    }
+    int frames = runner.getOptions().scenarioFrames;
+    for (int i = 0; i < 30; ++i) {
+        frame();
+    }
+    std::vector<double> samples;
+    samples.reserve(frames);
+    for (int i = 0; i < frames; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        frame();
+        samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    runner.addSamples(name, frames, 1, samples);
+}
+
+} // namespace
+
+void runScenarioBenchmarks(BenchRunner& runner) {
+    if (!runner.enabled("scenario.")) {
+        return;
+    }
+    ScenarioContext context;
+    if (!initContext(context)) {
+        std::printf("(scenario benchmarks skipped)\n");
+        return;
+    }
+
+    {
+        // Simulation and recording only: the simulation thread's share of a frame
+        JobSystem jobs;
+        Simulation simulation(9, &jobs);
+        simulation.start();
+        DrawList list;
+        timeFrames(runner, "scenario.step_record", [&]() {
+            stepFrame(simulation);
+            SimulationThread::recordWorld(simulation.acquireSnapshot(), 1.0f, 1.0f, 0.0f, list);
+        });
+
+        // Replay and present only: the render thread's share
+        timeFrames(runner, "scenario.render", [&]() { renderFrame(context, list); });
+
+        // Both, back to back on one thread
+        timeFrames(runner, "scenario.full_frame", [&]() {
+            stepFrame(simulation);
+            SimulationThread::recordWorld(simulation.acquireSnapshot(), 1.0f, 1.0f, 0.0f, list);
+            renderFrame(context, list);
+        });
+    }
+
+    {
+        // Effects alone: keep a steady number of particles alive over the
+        // screen, move them and draw them in one batch per kind
+        ParticleSystem particles;
+        ParticleRenderer particleRenderer(context.renderer.get(), particles);
+        for (int live : {10000, 100000}) {
+            particles.clear();
+            char name[64];
+            std::snprintf(name, sizeof(name), "scenario.particles_%dk", live / 1000);
+            timeFrames(runner, name, [&]() {
+                for (int kind = 0; kind < PARTICLE_KIND_COUNT; ++kind) {
+                    ParticleKind particleKind = static_cast<ParticleKind>(kind);
+                    int missing = live / PARTICLE_KIND_COUNT - static_cast<int>(particles.size(particleKind));
+                    particles.spawn(particleKind, missing, 340.0f + static_cast<float>(std::rand() % 280),
+                                    static_cast<float>(std::rand() % 634), 0.0f, 60.0f, 120.0f);
+                }
+                particles.update(STEP_SECONDS * STEPS_PER_FRAME);
+                SDL_SetRenderDrawColor(context.renderer.get(), 0x00, 0x00, 0x00, 0xFF);
+                SDL_RenderClear(context.renderer.get());
+                particleRenderer.draw(*context.batch, 0.0f, DrawListRenderer::SCREEN_HEIGHT);
+                context.batch->flush();
+                SDL_RenderPresent(context.renderer.get());
+            });
+        }
+        for (int kind = 0; kind < PARTICLE_KIND_COUNT; ++kind) {
+            context.batch->forgetTexture(particleRenderer.getTexture(static_cast<ParticleKind>(kind)));
+        }
+    }
+
+    // Textures and fonts go before the renderer that owns them
+    context.drawListRenderer.reset();
+    context.assets.reset();
+    context.textCache.reset();
+    context.batch.reset();
+    context.renderer.reset();
+    context.window.reset();
+    TTF_Quit();
+    SDL_Quit();
+}
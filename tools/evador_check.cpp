@@ -0,0 +1,104 @@
+// Consistency check of the obstacle overlap kernels: runs the scalar, SSE2 and
+// AVX2 kernels (those the CPU supports) on the same randomized fields and
+// ranges and reports any query where their first-hit indices differ. Field
+// sizes and ranges deliberately miss multiples of 4 and 8 so the tail loops
+// run too. Exits 1 on a mismatch; run by ctest.
+
+#include "obstacle_field.h"
+#include "simd_dispatch.h"
+#include "tool_args.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace {
+
+const SimdLevel LEVELS[] = {SimdLevel::Scalar, SimdLevel::Sse2, SimdLevel::Avx2};
+
+// Fill a field with random obstacles packed into a small area, so queries hit often
+void fillField(ObstacleField& field, size_t count, std::mt19937& rng) {
+    std::uniform_int_distribution<int> position(-100, 100);
+    std::uniform_int_distribution<int> extent(1, 40);
+    field.clear();
+    for (size_t i = 0; i < count; ++i) {
+        field.add(position(rng), position(rng), extent(rng), extent(rng));
+    }
+}
+
+} // namespace
+
+int main(int argc, char* args[]) {
+    int queries = 200;
+    unsigned seed = 1;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(args[i], "--queries") == 0) {
+            queries = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--seed") == 0) {
+            seed = static_cast<unsigned>(std::strtoul(flagValue(argc, args, i), nullptr, 10));
+        } else {
+            std::fprintf(stderr, "Usage: %s [--queries N] [--seed N]\n", args[0]);
+            return 1;
+        }
+    }
+
+    std::vector<SimdLevel> levels;
+    for (SimdLevel level : LEVELS) {
+        if (simdLevelSupported(level)) levels.push_back(level);
+    }
+    std::printf("Kernels:");
+    for (SimdLevel level : levels) std::printf(" %s", simdLevelName(level));
+    std::printf("\n");
+
+    // Every size up to a few vectors, then some large odd ones
+    std::vector<size_t> counts;
+    for (size_t count = 0; count <= 70; ++count) counts.push_back(count);
+    for (size_t count : {127u, 255u, 1001u, 4099u}) counts.push_back(count);
+
+    std::mt19937 rng(seed);
+    ObstacleField field;
+    long checked = 0;
+    long hits = 0;
+    int mismatches = 0;
+    for (size_t count : counts) {
+        fillField(field, count, rng);
+        std::uniform_int_distribution<int> position(-120, 120);
+        std::uniform_int_distribution<int> extent(1, 60);
+        std::uniform_int_distribution<size_t> offset(0, count + 2);
+        for (int q = 0; q < queries; ++q) {
+            int x = position(rng);
+            int y = position(rng);
+            int width = extent(rng);
+            int height = extent(rng);
+            // The whole field first, then random ranges (end may pass the size)
+            size_t begin = q == 0 ? 0 : offset(rng);
+            size_t end = q == 0 ? count : offset(rng);
+
+            int expected = field.findFirstOverlap(levels[0], x, y, width, height, begin, end);
+            for (size_t k = 1; k < levels.size(); ++k) {
+                int found = field.findFirstOverlap(levels[k], x, y, width, height, begin, end);
+                if (found != expected) {
+                    if (mismatches < 10) {
+                        std::fprintf(stderr,
+                                     "Mismatch: %zu obstacles, range [%zu, %zu), box (%d, %d, %d, %d): "
+                                     "%s %d, %s %d\n",
+                                     count, begin, end, x, y, width, height, simdLevelName(levels[0]), expected,
+                                     simdLevelName(levels[k]), found);
+                    }
+                    ++mismatches;
+                }
+            }
+            ++checked;
+            if (expected >= 0) ++hits;
+        }
+    }
+
+    std::printf("Queries: %ld over %zu field sizes, %ld with a hit\n", checked, counts.size(), hits);
+    if (mismatches > 0) {
+        std::fprintf(stderr, "%d mismatches\n", mismatches);
+        return 1;
+    }
+    std::printf("All kernels agree\n");
+    return 0;
+}
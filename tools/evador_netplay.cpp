@@ -0,0 +1,265 @@
+// Headless netplay peer: races one scripted driver against another process
+// over UDP with rollback, in real time, and reports how often predictions
+// were corrected and what resimulating cost. Run two of them (players 1 and
+// 2) against each other over loopback, optionally with simulated latency and
+// loss. Needs no display, SDL or assets.
+
+#include "rollback_session.h"
+#include "simulation.h"
+#include "tool_args.h"
+#include "udp_link.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+
+// Settings of one peer
+struct NetplayOptions {
+    int player = 1;            // 1 drives the player's car, 2 the rival
+    int port = 0;              // Local UDP port; 7777 for player 1, 7778 for player 2 by default
+    std::string peerHost = "127.0.0.1";
+    int peerPort = 0;          // The other player's default port unless set
+    unsigned seed = 1;
+    int raceLength = Simulation::DEFAULT_RACE_LENGTH;
+    int tickRate = 120;
+    int delayMillis = 0;       // Simulated one-way latency of what this peer sends
+    int lossPercent = 0;       // Simulated loss of what this peer sends
+    float maxSeconds = 120.0f; // Give up after this long
+};
+
+// Scripted driver: holds a seeded cruising speed, swerves around obstacles
+// ahead and now and then drifts across its road for no reason, so the
+// peer's predictions are regularly wrong
+class DriverBot {
+public:
+    DriverBot(unsigned seed, int road) : random(seed), road(road) {
+        targetSpeed = std::uniform_real_distribution<float>(4.0f, 10.0f)(random);
+    }
+
+    // Controls for the next tick, for the car this peer drives
+    PlayerInput decide(const Simulation& simulation, const Car& car, float deltaTime) {
+        PlayerInput input;
+        input.accelerate = car.getSpeed() < targetSpeed;
+        input.decelerate = car.getSpeed() > targetSpeed + 2.0f;
+
+        // Head for the nearest lane position clear of everything up to
+        // `lookahead` ahead, reachable without brushing what is beside the car
+        const int lookahead = 160;
+        const int beside = 30;
+        const int margin = 6;
+        const ObstacleField& obstacles = simulation.getObstacles();
+        auto isClear = [&](int x, int window) {
+            for (size_t i = 0; i < obstacles.size(); ++i) {
+                Obstacle obstacle = obstacles.get(i);
+                int gap = car.getY() - (obstacle.positiony + obstacle.screenHeight);
+                int spare = gap >= beside ? margin : 3;  // Less beside the car, where it cannot be helped
+                if (gap >= -(obstacle.screenHeight + car.getHeight()) && gap < window &&
+                    x - spare < obstacle.positionx + obstacle.screenWidth &&
+                    x + car.getWidth() + spare > obstacle.positionx) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        // When there is no way past everything in view, settle for what is nearer
+        for (int window = lookahead; !isClear(car.getX(), window); window -= lookahead / 4) {
+            drift = 0.0f;
+            if (window <= beside) {
+                // Boxed in: creep on and hope
+                input.accelerate = car.getSpeed() < 2.0f;
+                input.decelerate = car.getSpeed() > 3.0f;
+                return input;
+            }
+            int roadLeft = Track::roadMinX(road);
+            int roadRight = Track::roadMaxX(road) + Simulation::OBSTACLE_WIDTH - car.getWidth();
+            int left = car.getX();
+            while (left > roadLeft && isClear(left - 1, beside) && !isClear(left, window)) {
+                left--;
+            }
+            int right = car.getX();
+            while (right < roadRight && isClear(right + 1, beside) && !isClear(right, window)) {
+                right++;
+            }
+            bool leftFree = isClear(left, window);
+            bool rightFree = isClear(right, window);
+            if (leftFree || rightFree) {
+                bool goLeft = leftFree && (!rightFree || car.getX() - left <= right - car.getX());
+                input.steerLeft = goLeft;
+                input.steerRight = !goLeft;
+                return input;
+            }
+        }
+        int carLeft = car.getX();
+
+        // Otherwise drift for a moment at random, back towards the middle of the road
+        drift -= deltaTime;
+        if (drift <= 0.0f && std::uniform_int_distribution<int>(0, 59)(random) == 0) {
+            drift = std::uniform_real_distribution<float>(0.03f, 0.12f)(random);
+            int middle = (Track::roadMinX(road) + Track::roadMaxX(road) + Simulation::OBSTACLE_WIDTH) / 2;
+            driftLeft = carLeft + car.getWidth() / 2 > middle;
+        }
+        if (drift > 0.0f) {
+            input.steerLeft = driftLeft;
+            input.steerRight = !driftLeft;
+        }
+        return input;
+    }
+
+private:
+    std::mt19937 random;
+    int road;
+    float targetSpeed;
+    float drift = 0.0f;
+    bool driftLeft = false;
+};
+
+NetplayOptions parseOptions(int argc, char* args[]) {
+    NetplayOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(args[i], "--player") == 0) {
+            options.player = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--port") == 0) {
+            options.port = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--peer") == 0) {
+            std::string peer = flagValue(argc, args, i);
+            size_t colon = peer.rfind(':');
+            options.peerHost = colon == std::string::npos ? peer : peer.substr(0, colon);
+            options.peerPort = colon == std::string::npos ? 0 : std::atoi(peer.c_str() + colon + 1);
+        } else if (std::strcmp(args[i], "--seed") == 0) {
+            options.seed = static_cast<unsigned>(std::strtoul(flagValue(argc, args, i), nullptr, 10));
+        } else if (std::strcmp(args[i], "--race-length") == 0) {
+            options.raceLength = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--tick-rate") == 0) {
+            options.tickRate = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--delay") == 0) {
+            options.delayMillis = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--loss") == 0) {
+            options.lossPercent = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--max-seconds") == 0) {
+            options.maxSeconds = static_cast<float>(std::atof(flagValue(argc, args, i)));
+        } else {
+            std::printf("Usage: evador_netplay [--player 1|2] [--port PORT] [--peer HOST[:PORT]] [--seed S] [--race-length PIXELS] [--tick-rate HZ] [--delay MS] [--loss PERCENT] [--max-seconds S]\n");
+            std::exit(std::strcmp(args[i], "--help") == 0 ? 0 : 1);
+        }
+    }
+    if ((options.player != 1 && options.player != 2) || options.tickRate < 1 || options.raceLength < 1) {
+        std::fprintf(stderr, "--player must be 1 or 2; --tick-rate and --race-length must be positive\n");
+        std::exit(1);
+    }
+    if (options.port == 0) options.port = options.player == 1 ? 7777 : 7778;
+    if (options.peerPort == 0) options.peerPort = options.player == 1 ? 7778 : 7777;
+    return options;
+}
+
+// One line of the running report: counters since the previous line
+void printProgress(const RollbackSession& session, const RollbackStats& previous, double seconds) {
+    const RollbackStats& stats = session.getStats();
+    uint64_t rollbacks = stats.rollbacks - previous.rollbacks;
+    uint64_t frames = stats.frames - previous.frames;
+    double resimMicros = stats.totalResimMicros - previous.totalResimMicros;
+    std::printf("%6.1f s  frame %6d (confirmed %6d)  rtt %2d frames  %3llu rollbacks, avg %4.1f frames  "
+                "resim %6.1f us per frame, %7.1f us max  %llu stalls\n",
+                seconds, session.getFrame(), session.getConfirmedFrame(), stats.roundTripFrames,
+                static_cast<unsigned long long>(rollbacks),
+                rollbacks > 0 ? static_cast<double>(stats.resimulatedFrames - previous.resimulatedFrames) / rollbacks : 0.0,
+                frames > 0 ? resimMicros / frames : 0.0, stats.maxResimMicros,
+                static_cast<unsigned long long>(stats.stalls - previous.stalls));
+}
+
+} // namespace
+
+int main(int argc, char* args[]) {
+    NetplayOptions options = parseOptions(argc, args);
+    Simulation simulation(options.seed, nullptr, options.raceLength, 1);
+
+    UdpLink link;
+    std::string error;
+    if (!link.open(options.port, options.peerHost, options.peerPort, error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 1;
+    }
+    link.setSimulatedDelay(options.delayMillis);
+    link.setSimulatedLoss(options.lossPercent, options.seed + static_cast<unsigned>(options.player));
+
+    const float stepSeconds = 1.0f / options.tickRate;
+    RollbackSession session(simulation, link, options.player - 1, stepSeconds);
+    DriverBot bot(options.seed * 2654435761u + static_cast<unsigned>(options.player),
+                  options.player == 1 ? Simulation::PLAYER_ROAD : Simulation::AI_ROAD);
+    std::printf("player %d on port %d, peer %s:%d, seed %u, %d Hz, %d ms delay, %d %% loss\n", options.player,
+                options.port, options.peerHost.c_str(), options.peerPort, options.seed, options.tickRate,
+                options.delayMillis, options.lossPercent);
+
+    using Clock = std::chrono::steady_clock;
+    const auto period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(stepSeconds));
+    Clock::time_point start = Clock::now();
+    Clock::time_point nextTick = start;
+    Clock::time_point nextReport = start + std::chrono::seconds(1);
+    Clock::time_point finishedAt;
+    bool finished = false;
+    RollbackStats previous;
+
+    while (!session.hasFailed()) {
+        std::this_thread::sleep_until(nextTick);
+        nextTick += period;
+        Clock::time_point now = Clock::now();
+        double seconds = std::chrono::duration<double>(now - start).count();
+        if (seconds > options.maxSeconds) {
+            std::fprintf(stderr, "Gave up after %.0f s\n", seconds);
+            break;
+        }
+
+        const Car& car = options.player == 1 ? simulation.player() : simulation.ai();
+        session.setLocalControls(bot.decide(simulation, car, stepSeconds));
+        session.tick();
+
+        if (now >= nextReport && session.isConnected()) {
+            printProgress(session, previous, seconds);
+            previous = session.getStats();
+            nextReport += std::chrono::seconds(1);
+        }
+
+        // The result stands once every frame up to the end has confirmed
+        // input; keep answering a little longer so the peer gets there too
+        if (!finished && simulation.getState() == GameState::GAMEOVER &&
+            session.getConfirmedFrame() >= static_cast<int>(simulation.getTick())) {
+            finished = true;
+            finishedAt = now;
+        }
+        if (finished && now - finishedAt > std::chrono::seconds(1)) {
+            break;
+        }
+    }
+    if (session.hasFailed()) {
+        std::fprintf(stderr, "Netplay failed: %s\n", session.getError().c_str());
+        return 1;
+    }
+
+    const RollbackStats& stats = session.getStats();
+    const char* outcome = simulation.getWinner() == RaceWinner::None ? "draw"
+                          : (simulation.getWinner() == RaceWinner::Player) == (options.player == 1) ? "won" : "lost";
+    std::printf("race %s after %.2f s (%s), seed %u\n", finished ? outcome : "unfinished", simulation.getRaceTime(),
+                simulation.playerCollided() || simulation.getAiCollisions() > 0 ? "crash" : "finish line",
+                simulation.getSeed());
+    std::printf("frames %llu, rollbacks %llu (%.2f per second), %llu frames resimulated, longest %d frames\n",
+                static_cast<unsigned long long>(stats.frames), static_cast<unsigned long long>(stats.rollbacks),
+                stats.rollbacks * static_cast<double>(options.tickRate) / std::max<uint64_t>(1, stats.frames),
+                static_cast<unsigned long long>(stats.resimulatedFrames), stats.maxRollbackFrames);
+    std::printf("resimulation %.2f us per rollback, %.2f us per frame, %.1f us max (tick is %.0f us)\n",
+                stats.rollbacks > 0 ? stats.totalResimMicros / stats.rollbacks : 0.0,
+                stats.totalResimMicros / std::max<uint64_t>(1, stats.frames), stats.maxResimMicros, stepSeconds * 1e6);
+    std::printf("stalls %llu, sync waits %llu, round trip %d frames\n", static_cast<unsigned long long>(stats.stalls),
+                static_cast<unsigned long long>(stats.syncWaits), stats.roundTripFrames);
+    const UdpLink::Stats& traffic = link.getStats();
+    std::printf("datagrams sent %llu (%llu bytes), received %llu, dropped %llu\n",
+                static_cast<unsigned long long>(traffic.sent), static_cast<unsigned long long>(traffic.bytesSent),
+                static_cast<unsigned long long>(traffic.received), static_cast<unsigned long long>(traffic.dropped));
+    std::printf("checksums compared %llu, desyncs %llu\n", static_cast<unsigned long long>(stats.checksums),
+                static_cast<unsigned long long>(stats.desyncs));
+    return stats.desyncs > 0 || !finished ? 1 : 0;
+}
@@ -0,0 +1,245 @@
+// Build-time asset packer: decodes the game's sprites and rasterizes its
+// fonts once, packs everything into one RGBA32 atlas and writes
+//   - the pack file the game memory-maps at startup, and
+//   - a header of constexpr sprite rectangles inside that atlas.
+// Usage: evador_pack --root DIR --out PACK --header HEADER
+//                    [--image RELATIVE_PATH]... [--font RELATIVE_PATH:SIZE]...
+
+#include "asset_pack.h"
+#include <SDL.h>
+#include <SDL_image.h>
+#include <SDL_ttf.h>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+const int ATLAS_WIDTH = 1024;
+const int PADDING = 1;  // Transparent gap between rectangles so filtering never bleeds
+
+using SurfacePtr = std::shared_ptr<SDL_Surface>;
+
+// One rectangle to place in the atlas
+struct Item {
+    SurfacePtr surface;  // Null for empty glyphs such as the space
+    int x = 0, y = 0;
+    int width = 0, height = 0;
+};
+
+struct ImageInput {
+    std::string key;
+    size_t item;
+};
+
+struct FontInput {
+    std::string key;
+    int pointSize;
+    int height;
+    int advances[PackedFont::GLYPH_COUNT];
+    size_t firstItem;
+};
+
+[[noreturn]] void fail(const std::string& message) {
+    std::fprintf(stderr, "evador_pack: %s\n", message.c_str());
+    std::exit(1);
+}
+
+// Every surface is converted to the atlas format up front
+SurfacePtr toRgba(SDL_Surface* surface) {
+    if (!surface) return nullptr;
+    SDL_Surface* converted = SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+    SDL_FreeSurface(surface);
+    if (!converted) fail(std::string("surface conversion failed: ") + SDL_GetError());
+    return SurfacePtr(converted, SDL_FreeSurface);
+}
+
+// Shelf packing, tallest items first; returns the atlas height
+int packItems(std::vector<Item>& items) {
+    std::vector<size_t> order(items.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return items[a].height > items[b].height; });
+
+    int penX = 0, penY = 0, shelfHeight = 0;
+    for (size_t index : order) {
+        Item& item = items[index];
+        if (item.width == 0 || item.height == 0) continue;
+        if (item.width > ATLAS_WIDTH) fail("an image is wider than the atlas");
+        if (penX + item.width > ATLAS_WIDTH) {
+            penX = 0;
+            penY += shelfHeight + PADDING;
+            shelfHeight = 0;
+        }
+        item.x = penX;
+        item.y = penY;
+        penX += item.width + PADDING;
+        shelfHeight = std::max(shelfHeight, item.height);
+    }
+    return penY + shelfHeight;
+}
+
+// Upper-case identifier from a file name: assets/car_1.png -> CAR_1
+std::string constantName(const std::string& key) {
+    size_t slash = key.find_last_of('/');
+    std::string stem = key.substr(slash == std::string::npos ? 0 : slash + 1);
+    stem = stem.substr(0, stem.find('.'));
+    std::string name;
+    for (char c : stem) {
+        name += std::isalnum(static_cast<unsigned char>(c)) ? static_cast<char>(std::toupper(static_cast<unsigned char>(c))) : '_';
+    }
+    return name;
+}
+
+size_t alignUp(size_t value) {
+    return (value + AssetPack::ALIGNMENT - 1) / AssetPack::ALIGNMENT * AssetPack::ALIGNMENT;
+}
+
+} // namespace
+
+int main(int argc, char* args[]) {
+    std::string root = ".", packPath, headerPath;
+    std::vector<std::string> imageKeys;
+    std::vector<std::pair<std::string, int>> fontKeys;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = args[i];
+        if (i + 1 >= argc) fail("missing value for " + flag);
+        std::string value = args[++i];
+        if (flag == "--root") {
+            root = value;
+        } else if (flag == "--out") {
+            packPath = value;
+        } else if (flag == "--header") {
+            headerPath = value;
+        } else if (flag == "--image") {
+            imageKeys.push_back(value);
+        } else if (flag == "--font") {
+            size_t colon = value.find_last_of(':');
+            if (colon == std::string::npos) fail("--font expects PATH:SIZE");
+            fontKeys.push_back({value.substr(0, colon), std::atoi(value.c_str() + colon + 1)});
+        } else {
+            fail("unknown option " + flag);
+        }
+    }
+    if (packPath.empty() || headerPath.empty()) fail("--out and --header are required");
+    if (TTF_Init() != 0) fail(std::string("TTF_Init failed: ") + TTF_GetError());
+
+    std::vector<Item> items;
+    std::vector<ImageInput> images;
+    std::vector<FontInput> fonts;
+
+    for (const auto& key : imageKeys) {
+        std::string path = root + "/" + key;
+        SurfacePtr surface = toRgba(IMG_Load(path.c_str()));
+        if (!surface) fail("cannot load " + path + ": " + IMG_GetError());
+        Item item;
+        item.surface = surface;
+        item.width = surface->w;
+        item.height = surface->h;
+        images.push_back({key, items.size()});
+        items.push_back(item);
+    }
+
+    SDL_Color white = {255, 255, 255, 255};
+    for (const auto& key : fontKeys) {
+        std::string path = root + "/" + key.first;
+        std::shared_ptr<TTF_Font> font(TTF_OpenFont(path.c_str(), key.second), TTF_CloseFont);
+        if (!font) fail("cannot open " + path + ": " + TTF_GetError());
+
+        FontInput input;
+        input.key = key.first;
+        input.pointSize = key.second;
+        input.height = TTF_FontHeight(font.get());
+        input.firstItem = items.size();
+        for (int g = 0; g < PackedFont::GLYPH_COUNT; ++g) {
+            Uint16 c = static_cast<Uint16>(PackedFont::FIRST_GLYPH + g);
+            int minx, maxx, miny, maxy, advance = 0;
+            TTF_GlyphMetrics(font.get(), c, &minx, &maxx, &miny, &maxy, &advance);
+            input.advances[g] = advance;
+
+            Item item;
+            item.surface = toRgba(TTF_RenderGlyph_Blended(font.get(), c, white));
+            if (item.surface) {
+                item.width = item.surface->w;
+                item.height = item.surface->h;
+            }
+            items.push_back(item);
+        }
+        fonts.push_back(input);
+    }
+
+    // Lay out and fill the atlas
+    int atlasHeight = packItems(items);
+    std::vector<unsigned char> pixels(static_cast<size_t>(ATLAS_WIDTH) * atlasHeight * 4, 0);
+    for (const auto& item : items) {
+        if (!item.surface || item.width == 0) continue;
+        SDL_LockSurface(item.surface.get());
+        for (int row = 0; row < item.height; ++row) {
+            const unsigned char* source = static_cast<const unsigned char*>(item.surface->pixels) + row * item.surface->pitch;
+            unsigned char* destination = pixels.data() + (static_cast<size_t>(item.y + row) * ATLAS_WIDTH + item.x) * 4;
+            std::memcpy(destination, source, static_cast<size_t>(item.width) * 4);
+        }
+        SDL_UnlockSurface(item.surface.get());
+    }
+
+    // Pack file: header, font records, pixels
+    PackHeader header = {};
+    std::memcpy(header.magic, "EVPK", 4);
+    header.version = AssetPack::VERSION;
+    header.atlasWidth = ATLAS_WIDTH;
+    header.atlasHeight = static_cast<uint32_t>(atlasHeight);
+    header.fontCount = static_cast<uint32_t>(fonts.size());
+    header.fontOffset = static_cast<uint32_t>(alignUp(sizeof(PackHeader)));
+    header.atlasOffset = static_cast<uint32_t>(alignUp(header.fontOffset + fonts.size() * sizeof(PackedFont)));
+
+    std::vector<unsigned char> file(header.atlasOffset + pixels.size(), 0);
+    std::memcpy(file.data(), &header, sizeof(header));
+    for (size_t f = 0; f < fonts.size(); ++f) {
+        PackedFont record = {};
+        record.pointSize = static_cast<uint32_t>(fonts[f].pointSize);
+        record.height = fonts[f].height;
+        for (int g = 0; g < PackedFont::GLYPH_COUNT; ++g) {
+            const Item& item = items[fonts[f].firstItem + g];
+            record.glyphs[g] = {item.x, item.y, item.width, item.height, fonts[f].advances[g]};
+        }
+        std::memcpy(file.data() + header.fontOffset + f * sizeof(PackedFont), &record, sizeof(record));
+    }
+    std::memcpy(file.data() + header.atlasOffset, pixels.data(), pixels.size());
+
+    FILE* out = std::fopen(packPath.c_str(), "wb");
+    if (!out || std::fwrite(file.data(), 1, file.size(), out) != file.size()) fail("cannot write " + packPath);
+    std::fclose(out);
+
+    // Generated header: sprite rectangles known at compile time
+    out = std::fopen(headerPath.c_str(), "w");
+    if (!out) fail("cannot write " + headerPath);
+    std::fprintf(out, "// Generated by evador_pack from the assets listed in CMakeLists.txt; do not edit\n");
+    std::fprintf(out, "#ifndef ASSET_PACK_LAYOUT_H\n#define ASSET_PACK_LAYOUT_H\n\n#include \"asset_pack.h\"\n\n");
+    std::fprintf(out, "namespace PackLayout {\n\n");
+    std::fprintf(out, "constexpr uint32_t ATLAS_WIDTH = %d;\nconstexpr uint32_t ATLAS_HEIGHT = %d;\n\n", ATLAS_WIDTH, atlasHeight);
+    for (const auto& image : images) {
+        const Item& item = items[image.item];
+        std::fprintf(out, "constexpr PackedSprite %s = {\"%s\", %d, %d, %d, %d};\n",
+                     constantName(image.key).c_str(), image.key.c_str(), item.x, item.y, item.width, item.height);
+    }
+    std::fprintf(out, "\nconstexpr PackedSprite SPRITES[] = {");
+    for (size_t i = 0; i < images.size(); ++i) {
+        std::fprintf(out, "%s%s", i ? ", " : "", constantName(images[i].key).c_str());
+    }
+    std::fprintf(out, "};\n\n// In the order of the font records of the pack\nconstexpr PackedFontKey FONTS[] = {");
+    for (size_t i = 0; i < fonts.size(); ++i) {
+        std::fprintf(out, "%s{\"%s\", %d}", i ? ", " : "", fonts[i].key.c_str(), fonts[i].pointSize);
+    }
+    std::fprintf(out, "};\n\n} // namespace PackLayout\n\n#endif // ASSET_PACK_LAYOUT_H\n");
+    std::fclose(out);
+
+    std::printf("evador_pack: %zu sprites, %zu fonts, %dx%d atlas, %zu bytes\n",
+                images.size(), fonts.size(), ATLAS_WIDTH, atlasHeight, file.size());
+    TTF_Quit();
+    return 0;
+}
@@ -0,0 +1,135 @@
+// Headless replay runner: re-runs a recording made by the game (--record) or
+// by evador_sim (--record) as fast as possible, optionally from a seek point,
+// and checks it against the recorded keyframes. Needs no display, SDL or assets.
+
+#include "job_system.h"
+#include "replay.h"
+#include "simulation.h"
+#include "tool_args.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace {
+
+// Settings of one run
+struct ReplayOptions {
+    std::string path;
+    uint64_t seek = 0;        // Step to start from
+    uint64_t steps = 0;       // 0 = play to the end
+    int repeat = 1;           // Play the same range this many times, for timing
+    bool verify = false;      // Compare against every keyframe passed
+    int threads = -1;         // -1 = inline, 0 = one per hardware thread
+};
+
+ReplayOptions parseOptions(int argc, char* args[]) {
+    ReplayOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(args[i], "--seek") == 0) {
+            options.seek = std::strtoull(flagValue(argc, args, i), nullptr, 10);
+        } else if (std::strcmp(args[i], "--steps") == 0) {
+            options.steps = std::strtoull(flagValue(argc, args, i), nullptr, 10);
+        } else if (std::strcmp(args[i], "--repeat") == 0) {
+            options.repeat = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--verify") == 0) {
+            options.verify = true;
+        } else if (std::strcmp(args[i], "--threads") == 0) {
+            options.threads = std::atoi(flagValue(argc, args, i));
+        } else if (args[i][0] != '-' && options.path.empty()) {
+            options.path = args[i];
+        } else {
+            std::printf("Usage: evador_replay FILE [--seek STEP] [--steps N] [--repeat N] [--verify] [--threads N]\n");
+            std::exit(std::strcmp(args[i], "--help") == 0 ? 0 : 1);
+        }
+    }
+    if (options.path.empty() || options.repeat < 1) {
+        std::fprintf(stderr, "A replay file is required and --repeat must be positive\n");
+        std::exit(1);
+    }
+    return options;
+}
+
+const char* stateName(GameState state) {
+    switch (state) {
+        case GameState::STARTED: return "started";
+        case GameState::STOPPED: return "stopped";
+        case GameState::PAUSED: return "paused";
+        case GameState::RESET: return "reset";
+        case GameState::RUNNING: return "running";
+        case GameState::QUIT: return "quit";
+        case GameState::GAMEOVER: return "game over";
+    }
+    return "?";
+}
+
+const char* winnerName(RaceWinner winner) {
+    switch (winner) {
+        case RaceWinner::None: return "none";
+        case RaceWinner::Player: return "player";
+        case RaceWinner::AI: return "AI";
+    }
+    return "?";
+}
+
+} // namespace
+
+int main(int argc, char* args[]) {
+    ReplayOptions options = parseOptions(argc, args);
+
+    ReplayFile file;
+    std::string error;
+    if (!file.load(options.path, error)) {
+        std::fprintf(stderr, "%s: %s\n", options.path.c_str(), error.c_str());
+        return 1;
+    }
+    const ReplayHeader& header = file.header;
+    std::printf("recording          %s: seed %u, %u Hz, race length %u, %u AI cars, %llu steps, %zu commands, %zu keyframes%s\n",
+                options.path.c_str(), header.seed, header.tickRate, header.raceLength, header.aiCars,
+                static_cast<unsigned long long>(file.endTick), file.events.size(), file.keyframes.size(),
+                file.complete ? "" : " (cut short)");
+
+    std::unique_ptr<JobSystem> jobs;
+    if (options.threads >= 0) {
+        jobs = std::make_unique<JobSystem>(static_cast<unsigned>(options.threads));
+    }
+    Simulation simulation(header.seed, jobs.get(), static_cast<int>(header.raceLength), static_cast<int>(header.aiCars));
+    ReplayPlayer player(file, simulation);
+    player.setVerify(options.verify);
+
+    uint64_t end = options.steps > 0 ? options.seek + options.steps : file.endTick;
+    uint64_t totalSteps = 0;
+    double seekSeconds = 0.0, playSeconds = 0.0;
+    for (int run = 0; run < options.repeat; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        if (!player.seek(options.seek)) {
+            std::fprintf(stderr, "Could not seek to step %llu\n", static_cast<unsigned long long>(options.seek));
+            return 1;
+        }
+        auto sought = std::chrono::steady_clock::now();
+        totalSteps += player.runTo(end);
+        auto done = std::chrono::steady_clock::now();
+        seekSeconds += std::chrono::duration<double>(sought - start).count();
+        playSeconds += std::chrono::duration<double>(done - sought).count();
+    }
+
+    double simulated = totalSteps * static_cast<double>(header.stepSeconds);
+    std::printf("final state        step %llu, %s, winner %s, race time %.3f s, player (%.1f, %.1f), AI (%.1f, %.1f)\n",
+                static_cast<unsigned long long>(player.getTick()), stateName(simulation.getState()),
+                winnerName(simulation.getWinner()), simulation.getRaceTime(),
+                simulation.player().getPositionX(), simulation.player().getPositionY(),
+                simulation.ai().getPositionX(), simulation.ai().getPositionY());
+    std::printf("seek               %.3f ms per seek to step %llu\n", 1000.0 * seekSeconds / options.repeat,
+                static_cast<unsigned long long>(options.seek));
+    std::printf("playback           %llu steps in %.3f s: %.0f steps/s, %.0fx real time\n",
+                static_cast<unsigned long long>(totalSteps), playSeconds,
+                playSeconds > 0.0 ? totalSteps / playSeconds : 0.0, playSeconds > 0.0 ? simulated / playSeconds : 0.0);
+    if (options.verify) {
+        std::printf("verify             %d keyframes checked, %d mismatched\n",
+                    player.getKeyframesChecked(), player.getMismatches());
+        return player.getMismatches() == 0 ? 0 : 2;
+    }
+    return 0;
+}
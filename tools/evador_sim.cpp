@@ -0,0 +1,274 @@
+// Headless batch race runner: plays N seeded races between the AI car and a
+// scripted player as fast as possible on all cores, then reports statistics
+// useful for tuning the AI. Needs no display, SDL or assets.
+
+#include "job_system.h"
+#include "profiler.h"
+#include "replay.h"
+#include "simulation.h"
+#include "tool_args.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Settings of one batch run
+struct BatchOptions {
+    int races = 1000;
+    unsigned seed = 1;
+    int tickRate = 120;
+    float maxRaceTime = 120.0f; // Races still undecided after this many seconds count as timeouts
+    int raceLength = Simulation::DEFAULT_RACE_LENGTH;
+    unsigned threads = 0;      // Racing threads, the main one included; 0 = one per hardware thread
+    int aiBudgetMicros = AiPlanner::DEFAULT_BUDGET_MICROS;
+    int aiCars = 1;
+    std::string tracePath;     // Chrome trace of the last events of every thread, if set
+    std::string recordPath;    // Replay of the first race, if set
+};
+
+// Outcome of one race
+struct RaceResult {
+    RaceWinner winner = RaceWinner::None;
+    bool playerCollided = false;
+    int aiCollisions = 0;
+    float raceTime = 0.0f;
+    bool timedOut = false;
+    int chunksGenerated = 0;
+    PlannerStats planner;
+};
+
+// Scripted stand-in for the human player: cruises at a seeded target speed
+// and sidesteps obstacles ahead, reacting no faster than a seeded delay
+class PlayerBot {
+public:
+    explicit PlayerBot(unsigned seed) : random(seed) {
+        targetSpeed = std::uniform_real_distribution<float>(3.0f, 9.0f)(random);
+        reactionTime = std::uniform_real_distribution<float>(0.05f, 0.2f)(random);
+    }
+
+    // Controls for the next step of deltaTime seconds
+    PlayerInput decide(const Simulation& simulation, float deltaTime) {
+        PlayerInput input;
+        cooldown -= deltaTime;
+        if (cooldown > 0.0f) {
+            return input;
+        }
+
+        const Car& car = simulation.player();
+        input.accelerate = car.getSpeed() < targetSpeed;
+
+        const int lookahead = 120;
+        int carLeft = car.getX();
+        int carRight = carLeft + car.getWidth();
+        const ObstacleField& obstacles = simulation.getObstacles();
+        for (size_t i = 0; i < obstacles.size(); ++i) {
+            Obstacle obstacle = obstacles.get(i);
+            int gap = car.getY() - (obstacle.positiony + obstacle.screenHeight);
+            bool ahead = gap >= 0 && gap < lookahead;
+            bool inPath = carLeft < obstacle.positionx + obstacle.screenWidth && carRight > obstacle.positionx;
+            if (ahead && inPath) {
+                // Dodge towards the side the car is already leaning to
+                int carCenter = carLeft + car.getWidth() / 2;
+                int obstacleCenter = obstacle.positionx + obstacle.screenWidth / 2;
+                if (carCenter < obstacleCenter) {
+                    input.steerLeft = true;
+                } else {
+                    input.steerRight = true;
+                }
+                break;
+            }
+        }
+
+        cooldown = reactionTime;
+        return input;
+    }
+
+private:
+    std::mt19937 random;
+    float targetSpeed;
+    float reactionTime;
+    float cooldown = 0.0f;
+};
+
+// Play one race to the end (or the time limit), optionally recording it
+RaceResult runRace(unsigned seed, const BatchOptions& options, ReplayRecorder* recorder = nullptr) {
+    Simulation simulation(seed, nullptr, options.raceLength, options.aiCars);
+    simulation.setAiBudgetMicros(options.aiBudgetMicros);
+    PlayerBot bot(seed * 2654435761u);
+    const float stepSeconds = 1.0f / options.tickRate;
+
+    SimulationCommand command;
+    command.type = SimulationCommandType::Start;
+    if (recorder) recorder->recordCommand(command);
+    simulation.apply(command);
+    while (simulation.getState() == GameState::RUNNING && simulation.getRaceTime() < options.maxRaceTime) {
+        command.type = SimulationCommandType::Input;
+        command.input = bot.decide(simulation, stepSeconds);
+        // Idle steps need no record
+        bool any = command.input.accelerate || command.input.decelerate || command.input.steerLeft || command.input.steerRight;
+        if (recorder && any) recorder->recordCommand(command);
+        simulation.apply(command);
+        simulation.step(stepSeconds);
+        if (recorder) recorder->recordStep(simulation);
+    }
+
+    RaceResult result;
+    result.winner = simulation.getWinner();
+    result.playerCollided = simulation.playerCollided();
+    result.aiCollisions = simulation.getAiCollisions();
+    result.raceTime = simulation.getRaceTime();
+    result.timedOut = simulation.getState() == GameState::RUNNING;
+    result.chunksGenerated = simulation.getTrack().getChunksGenerated();
+    result.planner = simulation.getAiPlannerStats();
+    return result;
+}
+
+BatchOptions parseOptions(int argc, char* args[]) {
+    BatchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(args[i], "--races") == 0) {
+            options.races = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--seed") == 0) {
+            options.seed = static_cast<unsigned>(std::strtoul(flagValue(argc, args, i), nullptr, 10));
+        } else if (std::strcmp(args[i], "--tick-rate") == 0) {
+            options.tickRate = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--max-race-time") == 0) {
+            options.maxRaceTime = static_cast<float>(std::atof(flagValue(argc, args, i)));
+        } else if (std::strcmp(args[i], "--race-length") == 0) {
+            options.raceLength = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--threads") == 0) {
+            options.threads = static_cast<unsigned>(std::atoi(flagValue(argc, args, i)));
+        } else if (std::strcmp(args[i], "--ai-cars") == 0) {
+            options.aiCars = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--ai-budget") == 0) {
+            options.aiBudgetMicros = std::atoi(flagValue(argc, args, i));
+        } else if (std::strcmp(args[i], "--record") == 0) {
+            options.recordPath = flagValue(argc, args, i);
+        } else if (std::strcmp(args[i], "--trace") == 0) {
+            options.tracePath = flagValue(argc, args, i);
+        } else {
+            std::printf("Usage: evador_sim [--races N] [--seed S] [--tick-rate HZ] [--max-race-time SECONDS] [--race-length PIXELS] [--threads N] [--ai-cars N] [--ai-budget MICROSECONDS] [--trace FILE] [--record FILE]\n");
+            std::exit(std::strcmp(args[i], "--help") == 0 ? 0 : 1);
+        }
+    }
+    if (options.races < 1 || options.tickRate < 1 || options.maxRaceTime <= 0.0f || options.raceLength < 1 ||
+        options.aiCars < 1) {
+        std::fprintf(stderr, "--races, --tick-rate, --max-race-time, --race-length and --ai-cars must be positive\n");
+        std::exit(1);
+    }
+    // The game and replays accept no more than this either
+    if (options.raceLength < Simulation::MIN_RACE_LENGTH || options.raceLength > Simulation::MAX_RACE_LENGTH ||
+        options.aiCars > Simulation::MAX_AI_CARS) {
+        std::fprintf(stderr, "--race-length must be %d to %d and --ai-cars at most %d\n", Simulation::MIN_RACE_LENGTH,
+                     Simulation::MAX_RACE_LENGTH, Simulation::MAX_AI_CARS);
+        std::exit(1);
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char* args[]) {
+    BatchOptions options = parseOptions(argc, args);
+    // The main thread races too, so N threads take N - 1 workers; one runs without a job system
+    std::unique_ptr<JobSystem> jobs;
+    if (options.threads != 1) {
+        jobs = std::make_unique<JobSystem>(options.threads > 1 ? options.threads - 1 : 0);
+    }
+    unsigned threadCount = jobs ? jobs->workerCount() + 1 : 1;
+    std::vector<RaceResult> results(options.races);
+
+    // A few chunks per thread keeps the cores busy even when races differ in length
+    int chunk = options.races / static_cast<int>(threadCount * 8);
+    if (chunk < 1) chunk = 1;
+
+    // The first race doubles as a reproducible workload for evador_replay
+    ReplayRecorder recorder;
+    if (!options.recordPath.empty()) {
+        Simulation initial(options.seed, nullptr, options.raceLength, options.aiCars);
+        initial.setAiBudgetMicros(options.aiBudgetMicros);
+        if (!recorder.open(options.recordPath, initial, 1.0f / options.tickRate)) {
+            std::fprintf(stderr, "Could not create %s\n", options.recordPath.c_str());
+            return 1;
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto raceRange = [&](int first, int last) {
+        for (int i = first; i < last; ++i) {
+            results[i] = runRace(options.seed + static_cast<unsigned>(i), options, i == 0 && recorder.isOpen() ? &recorder : nullptr);
+        }
+    };
+    if (jobs) {
+        jobs->parallelFor("race", 0, options.races, chunk, raceRange);
+    } else {
+        raceRange(0, options.races);
+    }
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    int aiWins = 0, playerWins = 0, timeouts = 0, playerCrashes = 0, aiCrashRaces = 0, aiCrashes = 0;
+    double totalRaceTime = 0.0, chunks = 0.0;
+    float longestRace = 0.0f;
+    PlannerStats planner;
+    for (const auto& result : results) {
+        if (result.winner == RaceWinner::AI) aiWins++;
+        if (result.winner == RaceWinner::Player) playerWins++;
+        if (result.timedOut) timeouts++;
+        if (result.playerCollided) playerCrashes++;
+        if (result.aiCollisions > 0) aiCrashRaces++;
+        aiCrashes += result.aiCollisions;
+        totalRaceTime += result.raceTime;
+        chunks += result.chunksGenerated;
+        if (result.raceTime > longestRace) longestRace = result.raceTime;
+        planner.plans += result.planner.plans;
+        planner.reuses += result.planner.reuses;
+        planner.totalNodes += result.planner.totalNodes;
+        planner.totalMicros += result.planner.totalMicros;
+        planner.maxMicros = std::max(planner.maxMicros, result.planner.maxMicros);
+    }
+
+    double races = options.races;
+    std::printf("races              %d (seeds %u..%u, %d Hz, %d AI cars, %u threads)\n", options.races, options.seed,
+                options.seed + options.races - 1, options.tickRate, options.aiCars, threadCount);
+    std::printf("AI win rate        %6.2f %%\n", 100.0 * aiWins / races);
+    std::printf("player win rate    %6.2f %%\n", 100.0 * playerWins / races);
+    std::printf("timeouts           %6.2f %%\n", 100.0 * timeouts / races);
+    std::printf("player crash rate  %6.2f %%\n", 100.0 * playerCrashes / races);
+    std::printf("AI collision rate  %6.2f %% of races (%.3f obstacles hit per race)\n",
+                100.0 * aiCrashRaces / races, aiCrashes / races);
+    double plans = planner.plans > 0 ? static_cast<double>(planner.plans) : 1.0;
+    std::printf("AI planner         %.1f %% of steps replanned, %.0f nodes and %.2f us per plan (max %.2f us, budget %d us)\n",
+                100.0 * planner.plans / std::max<double>(1.0, static_cast<double>(planner.plans + planner.reuses)),
+                planner.totalNodes / plans, planner.totalMicros / plans, planner.maxMicros, options.aiBudgetMicros);
+    std::printf("chunks generated   %.1f per race\n", chunks / races);
+    std::printf("race duration      mean %.3f s, max %.3f s (simulated)\n", totalRaceTime / races, longestRace);
+    std::printf("throughput         %.0f races/s (%.3f s wall)\n", races / wallSeconds, wallSeconds);
+
+    if (recorder.isOpen()) {
+        std::printf("recorded           %s (%llu steps, %llu bytes)\n", options.recordPath.c_str(),
+                    static_cast<unsigned long long>(recorder.getTicks()),
+                    static_cast<unsigned long long>(recorder.getBytesWritten()));
+        recorder.close();
+    }
+
+    if (!options.tracePath.empty()) {
+#if EVADOR_PROFILING
+        if (!Profiler::writeChromeTrace(options.tracePath)) {
+            std::fprintf(stderr, "Could not write %s\n", options.tracePath.c_str());
+            return 1;
+        }
+        std::printf("trace              %s\n", options.tracePath.c_str());
+#else
+        std::fprintf(stderr, "Built without EVADOR_PROFILING, no trace written\n");
+#endif
+    }
+    return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef TOOL_ARGS_H
+#define TOOL_ARGS_H
+
+#include <cstdio>
+#include <cstdlib>
+
+// Command line helpers shared by the headless tools
+
+// Read the value following a flag; exits with a message when it is missing
+inline const char* flagValue(int argc, char* args[], int& i) {
+    if (i + 1 >= argc) {
+        std::fprintf(stderr, "Missing value for %s\n", args[i]);
+        std::exit(1);
+    }
+    return args[++i];
+}
+
+#endif // TOOL_ARGS_H